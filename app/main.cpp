@@ -1,6 +1,11 @@
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <utility>
 #include <vector>
 #include "Leaderboard.h"
 
@@ -11,12 +16,19 @@ static void print_help() {
   cout << "Commands:\n";
   cout << "  help      - show this help\n";
   cout << "  print     - show full leaderboard\n";
-  cout << "  validate  - check red-black tree invariants\n";
+  cout << "  validate  - check red-black tree invariants on the whole tree\n";
+  cout << "  mem       - show score tree node memory\n";
+  cout << "  range <lo> <hi> - count players scoring lo..hi and list the first few\n";
+  cout << "  save <f>  - write a binary snapshot to file f\n";
+  cout << "  load <f>  - open the snapshot in file f (replaces the board)\n";
   cout << "  exit      - quit\n\n";
   cout << "You can enter either:\n";
   cout << "  <name> <score>   (one line)\n";
   cout << "or:\n";
-  cout << "  <name>           (then I'll prompt for score)\n";
+  cout << "  <name>           (then I'll prompt for score)\n\n";
+  cout << "Batch mode (no prompts, for piped or large update files):\n";
+  cout << "  app --batch [--rank] [--neighbors] [--validate] [--snapshot f] [input]\n";
+  cout << "reads '<name> <score>' lines and the commands above from input (or stdin).\n";
 }
 
 static void print_neighbors(const vector<Player>& rows, const string& who) {
@@ -32,6 +44,14 @@ static void print_neighbors(const vector<Player>& rows, const string& who) {
   }
 }
 
+// command words; they are never taken as player names
+static bool is_command(const string& word) {
+  return word == "help" || word == "print" ||
+         word == "validate" || word == "mem" ||
+         word == "save" || word == "load" || word == "range" ||
+         word == "exit" || word == "quit";
+}
+
 // parse "<name> <score>" from a line.
 // returns true and fills name/score if successful.
 static bool parse_name_score_line(const string& line, string& name, int& score) {
@@ -40,8 +60,7 @@ static bool parse_name_score_line(const string& line, string& name, int& score)
   int maybeScore;
   if (!(iss >> maybeName)){
     return false;}          // nothing on the line
-  if (maybeName == "help" || maybeName == "print" ||
-      maybeName == "validate" || maybeName == "exit" || maybeName == "quit") {
+  if (is_command(maybeName)) {
     return false; // it's a command, not a name+score
   }
   if (iss >> maybeScore) {
@@ -52,9 +71,307 @@ static bool parse_name_score_line(const string& line, string& name, int& score)
   return false;                                     // only a name (no score here)
 }
 
-int main() {
-  Leaderboard lb;
+// parse "range <lo> <hi>" from the trimmed line [p, end).
+// returns true and fills lo/hi if successful.
+static bool parse_range(const char* p, const char* end, int& lo, int& hi) {
+  if (end - p < 6 || memcmp(p, "range", 5) != 0 || (p[5] != ' ' && p[5] != '\t')) return false;
+  p += 5;
+  while (p < end && (*p == ' ' || *p == '\t')) p++;
+  from_chars_result r = from_chars(p, end, lo);
+  if (r.ec != errc() || r.ptr == end || (*r.ptr != ' ' && *r.ptr != '\t')) return false;
+  p = r.ptr;
+  while (p < end && (*p == ' ' || *p == '\t')) p++;
+  r = from_chars(p, end, hi);
+  return r.ec == errc() && r.ptr == end;
+}
+
+// how many rows a range command lists after the count
+static const int kRangeRows = 10;
+
+// ------------------------------------------------------------ batch mode
+
+// BatchWriter collects output in one buffer and writes it out in large
+// chunks, instead of one small write (and flush) per result line
+class BatchWriter {
+public:
+  explicit BatchWriter(FILE* f) : out(f) { buf.reserve(kChunk + 256); }
+  ~BatchWriter() { flush(); }
+
+  void put(const char* p, size_t n) {
+    buf.append(p, n);
+    if (buf.size() >= kChunk) flush();
+  }
+  void put(const char* s) { put(s, strlen(s)); }
+  void put(const string& s) { put(s.data(), s.size()); }
+  void put(long v) {
+    char tmp[24];
+    to_chars_result r = to_chars(tmp, tmp + sizeof(tmp), v);
+    put(tmp, (size_t)(r.ptr - tmp));
+  }
+  void flush() {
+    if (!buf.empty()) fwrite(buf.data(), 1, buf.size(), out);
+    buf.clear();
+    fflush(out);
+  }
+
+private:
+  static const size_t kChunk = 1 << 16;
+  FILE* out;
+  string buf;
+};
+
+// what to report per update; by default batch mode only applies them
+struct BatchOptions {
+  bool rank = false;        // "<name> <score> <rank> <of> <tied>" per update
+  bool neighbors = false;   // the 2-above / 2-below window per update
+  bool validate = false;    // check the nodes each write changed (LeaderboardOptions::checkUpdates)
+};
+
+struct BatchStats {
+  long lines = 0;
+  long updates = 0;
+  long errors = 0;
+};
+
+// batch mode: pending updates are applied together through applyBatch
+static const size_t kBatchUpdates = 1 << 16;
+
+static void apply_pending(Leaderboard& lb, vector<pair<string, int> >& pending) {
+  if (pending.empty()) return;
+  lb.applyBatch(pending);
+  pending.clear();
+}
+
+// one update with the per-line output asked for in opts
+static void apply_reported(Leaderboard& lb, const string& name, int score, const BatchOptions& opts,
+                           BatchWriter& out) {
+  lb.addOrUpdate(name, score);
+  if (opts.rank) {
+    RankInfo info;
+    if (lb.computeRank(name, info)) {
+      out.put(name);
+      out.put(" ");
+      out.put((long)info.score);
+      out.put(" ");
+      out.put((long)info.rank);
+      out.put(" ");
+      out.put((long)info.totalPlayers);
+      out.put(" ");
+      out.put((long)info.sameScoreCount);
+      out.put("\n");
+    }
+  }
+  if (opts.neighbors) {
+    vector<Player> around = lb.neighborsAround(name, 2);
+    for (size_t i = 0; i < around.size(); i++) {
+      out.put(around[i].name == name ? " -> " : "    ");
+      out.put(around[i].name);
+      out.put(" : ");
+      out.put((long)around[i].score);
+      out.put("\n");
+    }
+  }
+}
+
+// batch_line handles one trimmed, non-empty input line. Returns false on exit.
+static bool batch_line(Leaderboard& lb, const char* p, const char* end, const BatchOptions& opts,
+                       vector<pair<string, int> >& pending, BatchWriter& out, BatchStats& st) {
+  const char* nameEnd = p;
+  while (nameEnd < end && *nameEnd != ' ' && *nameEnd != '\t') nameEnd++;
+  const char* arg = nameEnd;
+  while (arg < end && (*arg == ' ' || *arg == '\t')) arg++;
+
+  string cmd(p, nameEnd);
+  if (!is_command(cmd)) {
+    int score = 0;
+    from_chars_result r = from_chars(arg, end, score);
+    if (arg < end && r.ec == errc() && (r.ptr == end || *r.ptr == ' ' || *r.ptr == '\t')) {
+      st.updates++;
+      if (opts.rank || opts.neighbors) {
+        apply_pending(lb, pending);
+        apply_reported(lb, cmd, score, opts, out);
+      } else {
+        pending.emplace_back(cmd, score);
+        if (pending.size() >= kBatchUpdates) apply_pending(lb, pending);
+      }
+      return true;
+    }
+  }
+
+  // a command sees every update before it
+  apply_pending(lb, pending);
+  bool bare = arg == end;   // no argument after the command word
+  string file(arg, end);
+  int lo = 0;
+  int hi = 0;
+  if ((cmd == "exit" || cmd == "quit") && bare) return false;
+  if (cmd == "print" && bare) {
+    out.flush();   // printAll writes to cout directly
+    lb.printAll();
+    cout << flush;
+  } else if (cmd == "validate" && bare) {
+    out.put(lb.validateTree() ? "VALID\n" : "INVALID\n");
+  } else if (cmd == "mem" && bare) {
+    rb_mem_stats m = lb.treeMemory();
+    out.put("Tree nodes: ");
+    out.put((long)m.live_nodes);
+    out.put(" live (");
+    out.put((long)m.live_bytes);
+    out.put(" bytes), ");
+    out.put((long)m.peak_nodes);
+    out.put(" peak (");
+    out.put((long)m.peak_bytes);
+    out.put(" bytes), ");
+    out.put((long)m.reserved_bytes);
+    out.put(" bytes reserved\n");
+  } else if ((cmd == "save" || cmd == "load") && !bare) {
+    bool ok = cmd == "save" ? lb.saveSnapshot(file) : lb.openSnapshot(file);
+    out.put(ok ? (cmd == "save" ? "Saved " : "Opened ") : (cmd == "save" ? "Could not save " : "Could not open "));
+    out.put(file);
+    out.put("\n");
+  } else if (cmd == "range" && parse_range(p, end, lo, hi)) {
+    // the count, then the first rows in the range
+    out.put((long)lb.countInRange(lo, hi));
+    out.put(" players\n");
+    vector<Player> rows = lb.playersInRange(lo, hi, kRangeRows);
+    for (size_t i = 0; i < rows.size(); i++) {
+      out.put("    ");
+      out.put(rows[i].name);
+      out.put(" : ");
+      out.put((long)rows[i].score);
+      out.put("\n");
+    }
+  } else if (!(cmd == "help" && bare)) {
+    // not an update, and a command word with missing or extra arguments
+    st.errors++;
+    out.put("line ");
+    out.put(st.lines);
+    if (is_command(cmd)) {
+      out.put(": bad arguments for '");
+      out.put(cmd);
+      out.put("'\n");
+    } else {
+      out.put(": expected '<name> <score>' or a command\n");
+    }
+  }
+  return true;
+}
+
+// run_batch reads in in large blocks and splits them into lines itself,
+// so there is no per-line getline, prompt or flush
+static BatchStats run_batch(Leaderboard& lb, FILE* in, const BatchOptions& opts, BatchWriter& out) {
+  BatchStats st;
+  vector<pair<string, int> > pending;
+  pending.reserve(kBatchUpdates);
+  vector<char> buf(1 << 20);
+  size_t have = 0;   // bytes in buf, starting with a partial line
+  bool more = true;
+  bool eof = false;
+  while (more && !eof) {
+    if (have == buf.size()) buf.resize(buf.size() * 2);  // one very long line
+    size_t got = fread(buf.data() + have, 1, buf.size() - have, in);
+    if (got == 0) {
+      eof = true;
+      if (have == 0) break;
+      buf.resize(have + 1);
+      buf[have++] = '\n';  // last line without a newline
+    }
+    have += got;
+
+    const char* p = buf.data();
+    const char* stop = buf.data() + have;
+    while (more) {
+      const char* nl = (const char*)memchr(p, '\n', (size_t)(stop - p));
+      if (nl == NULL) break;
+      const char* b = p;
+      const char* e = nl;
+      p = nl + 1;
+      st.lines++;
+      while (b < e && (*b == ' ' || *b == '\t')) b++;
+      while (e > b && (e[-1] == ' ' || e[-1] == '\t' || e[-1] == '\r')) e--;
+      if (b < e) more = batch_line(lb, b, e, opts, pending, out, st);
+    }
+    have = (size_t)(stop - p);
+    memmove(buf.data(), p, have);
+  }
+  apply_pending(lb, pending);
+  return st;
+}
+
+static int batch_main(int argc, char** argv) {
+  BatchOptions opts;
+  const char* input = NULL;
+  const char* snapshot = NULL;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--batch") == 0) continue;
+    if (strcmp(argv[i], "--rank") == 0) {
+      opts.rank = true;
+    } else if (strcmp(argv[i], "--neighbors") == 0) {
+      opts.neighbors = true;
+    } else if (strcmp(argv[i], "--validate") == 0) {
+      opts.validate = true;
+    } else if (strcmp(argv[i], "--snapshot") == 0 && i + 1 < argc) {
+      snapshot = argv[++i];
+    } else if (argv[i][0] != '-' || strcmp(argv[i], "-") == 0) {
+      input = argv[i];
+    } else {
+      fprintf(stderr, "usage: %s --batch [--rank] [--neighbors] [--validate] [--snapshot f] [input]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+
+  LeaderboardOptions lo;
+  lo.checkUpdates = opts.validate;
+  Leaderboard lb(lo);
+  if (snapshot != NULL && !lb.openSnapshot(snapshot)) {
+    fprintf(stderr, "Could not open snapshot %s\n", snapshot);
+    return 1;
+  }
+  FILE* in = stdin;
+  if (input != NULL && strcmp(input, "-") != 0) {
+    in = fopen(input, "rb");
+    if (in == NULL) {
+      fprintf(stderr, "Could not open %s\n", input);
+      return 1;
+    }
+  }
+
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  BatchStats st;
+  {
+    BatchWriter out(stdout);
+    st = run_batch(lb, in, opts, out);
+  }
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  if (in != stdin) fclose(in);
+
+  fprintf(stderr, "%ld lines, %ld updates, %ld errors in %.3f s (%.0f updates/s)\n", st.lines, st.updates,
+          st.errors, seconds, seconds > 0 ? (double)st.updates / seconds : 0.0);
+  bool valid = !opts.validate || lb.updatesValid();
+  if (opts.validate) fprintf(stderr, "Tree check: %s\n", valid ? "VALID" : "INVALID");
+  return st.errors == 0 && valid ? 0 : 1;
+}
+
+// usage: app [snapshot-file]   (start from a saved snapshot)
+//        app --batch ...       (see print_help)
+int main(int argc, char** argv) {
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--batch") == 0) return batch_main(argc, argv);
+  }
+
+  // every update re-checks the nodes it changed; 'validate' checks them all
+  LeaderboardOptions lo;
+  lo.checkUpdates = true;
+  Leaderboard lb(lo);
   cout << "RBT Leaderboard. Type 'help' for help.\n";
+  if (argc > 1) {
+    if (lb.openSnapshot(argv[1])) {
+      cout << "Opened snapshot " << argv[1] << "\n";
+    } else {
+      cout << "Could not open snapshot " << argv[1] << "\n";
+    }
+  }
 
   string line;
   while (true) {
@@ -90,9 +407,43 @@ int main() {
       cout << (lb.validateTree() ? "VALID\n" : "INVALID\n"); 
       continue; 
     }
+    if (line == "mem"){
+      rb_mem_stats m = lb.treeMemory();
+      cout << "Tree nodes: " << m.live_nodes << " live (" << m.live_bytes << " bytes), "
+           << m.peak_nodes << " peak (" << m.peak_bytes << " bytes), "
+           << m.reserved_bytes << " bytes reserved\n";
+      continue;
+    }
+    if (line.compare(0, 5, "save ") == 0 || line.compare(0, 5, "load ") == 0) {
+      string file = line.substr(5);
+      if (line[0] == 's') {
+        cout << (lb.saveSnapshot(file) ? "Saved " : "Could not save ") << file << "\n";
+      } else {
+        cout << (lb.openSnapshot(file) ? "Opened " : "Could not open ") << file << "\n";
+      }
+      continue;
+    }
+    int lo = 0;
+    int hi = 0;
+    if (parse_range(line.data(), line.data() + line.size(), lo, hi)) {
+      int count = lb.countInRange(lo, hi);
+      cout << count << " players with a score from " << lo << " to " << hi << "\n";
+      vector<Player> rows = lb.playersInRange(lo, hi, kRangeRows);
+      for (size_t i = 0; i < rows.size(); i++) {
+        cout << "    " << rows[i].name << " : " << rows[i].score << "\n";
+      }
+      if (count > (int)rows.size()) cout << "    ...\n";
+      continue;
+    }
     if (line == "exit" || line == "quit"){
       break;
     }
+    // any other line starting with a command word is a malformed command
+    string word = line.substr(0, line.find_first_of(" \t"));
+    if (is_command(word)) {
+      cout << "Bad arguments for '" << word << "'. Type 'help' for usage.\n";
+      continue;
+    }
 
     // Try one-line "<name> <score>"
     string name;
@@ -136,8 +487,8 @@ int main() {
       print_neighbors(around, name);
     }
 
-    // Optional: verify the RB tree after each change
-    bool valid = lb.validateTree();
+    // verify the RB tree around this change, O(log n)
+    bool valid = lb.updatesValid();
     cout << "\nTree check: " << (valid ? "VALID" : "INVALID") << "\n";
   }
 
@@ -0,0 +1,533 @@
+// Benchmark suite for the tree and leaderboard operations.
+//
+// usage: bench [--max N] [--sizes a,b,...] [--filter text] [--json file]
+//
+// Sizes default to 1e3, 1e4, ..., 1e7 (--max trims the list). Every case
+// prints ns/op, p50/p99 latency and the process peak RSS; --json also writes
+// the results as a JSON array so runs can be diffed. Build in Release mode.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include "bench_util.h"
+#include "BST.h"
+#include "RBT.h"
+#include "CompactRBT.h"
+#include "Leaderboard.h"
+#include "WindowedLeaderboard.h"
+#include "ShardedLeaderboard.h"
+#include "ScoreScan.h"
+
+using namespace std;
+
+// sorted-input BST inserts are O(n^2); larger sizes would take hours
+static const size_t kMaxSortedBst = 20000;
+
+static vector<int> random_keys(size_t n, unsigned seed) {
+  mt19937 rng(seed);
+  vector<int> keys(n);
+  for (size_t i = 0; i < n; i++) keys[i] = (int)(rng() % (n * 4 + 1));
+  return keys;
+}
+
+static size_t capped(size_t n, size_t cap) {
+  return n < cap ? n : cap;
+}
+
+// ---------------------------------------------------------------- RBT<int>
+static void bench_rbt(BenchContext& ctx, size_t n) {
+  vector<int> keys = random_keys(n, 1);
+  vector<int> probes = random_keys(capped(n, 1000000), 2);
+  RBT<int> t;
+  long sink = 0;
+
+  ctx.run("rbt/insert_data", n, n, [&](size_t i) { t.insert_data(keys[i]); });
+  if (t.size(t.get_root()) == 0) {
+    for (size_t i = 0; i < n; i++) t.insert_data(keys[i]);  // filtered out above
+  }
+  ctx.run("rbt/contains", n, probes.size(), [&](size_t i) {
+    sink += t.contains(t.get_root(), probes[i]);
+  });
+  size_t whole = capped(10000000 / n, 50);  // whole-tree passes per size
+  if (whole == 0) whole = 1;
+  ctx.run("rbt/to_vector", n, whole, [&](size_t) {
+    vector<int> v;
+    t.to_vector(t.get_root(), v);
+    sink += (long)v.size();
+  });
+  ctx.run("rbt/iterate", n, whole, [&](size_t) {
+    for (const RBT<int>::node_type& node : t) sink += node.data;   // streamed, nothing copied
+  });
+  ctx.run("rbt/lower_bound_scan_100", n, probes.size() / 10, [&](size_t i) {
+    int k = 0;
+    for (RBT<int>::const_iterator it = t.lower_bound(probes[i]); it != t.end() && k < 100; ++it, k++) {
+      sink += it->data;
+    }
+  });
+  ctx.run("rbt/validate", n, whole, [&](size_t) { sink += t.validate(); });
+
+  // remove every key in a different random order
+  vector<int> order = keys;
+  shuffle(order.begin(), order.end(), mt19937(3));
+  ctx.run("rbt/remove", n, n, [&](size_t i) { t.remove(order[i]); });
+
+  // heavily tied keys (1000 distinct values): a node per copy vs counted nodes
+  RBT<int> per_copy;
+  RBT<int> counted(less<int>(), RBDuplicates::Counted);
+  ctx.run("rbt/insert_tied", n, n, [&](size_t i) { per_copy.insert_data(keys[i] % 1000); });
+  ctx.run("rbt/insert_tied_counted", n, n, [&](size_t i) { counted.insert_data(keys[i] % 1000); });
+
+  // merging 1000 keys into n and taking them out again: unite + difference
+  // vs. one insert_data and one remove per key; then carving off the top 1%
+  // with split_at and gluing it back with join. Even keys in the tree, odd
+  // ones merged, so the tree is the same after every op.
+  RBT<int> base;
+  base.build_from_sorted((int)n, [](int i) { return 2 * i; }, [](int) { return rb_no_value(); });
+  vector<vector<int> > batches(8);
+  for (size_t b = 0; b < batches.size(); b++) {
+    vector<int> odd = random_keys(1000, (unsigned)(10 + b));
+    for (size_t i = 0; i < odd.size(); i++) odd[i] = 2 * (int)((size_t)odd[i] % n) + 1;
+    sort(odd.begin(), odd.end());
+    odd.erase(unique(odd.begin(), odd.end()), odd.end());
+    batches[b] = odd;
+  }
+  size_t rounds = capped(200000000 / (n + 100000), 2000);
+  ctx.run("rbt/unite_difference_1000", n, rounds, [&](size_t i) {
+    const vector<int>& odd = batches[i % batches.size()];
+    RBT<int> add;
+    add.build_from_sorted(odd);
+    RBT<int> drop;
+    drop.build_from_sorted(odd);
+    base.unite(add);
+    base.difference(drop);
+  });
+  // the same with add built on base's pool: unite relinks its nodes as they are
+  ctx.run("rbt/unite_difference_1000_shared", n, rounds, [&](size_t i) {
+    const vector<int>& odd = batches[i % batches.size()];
+    RBT<int> add(base.node_pool());
+    add.build_from_sorted(odd);
+    RBT<int> drop;
+    drop.build_from_sorted(odd);
+    base.unite(add);
+    base.difference(drop);
+  });
+  ctx.run("rbt/insert_remove_1000", n, rounds, [&](size_t i) {
+    const vector<int>& odd = batches[i % batches.size()];
+    for (size_t j = 0; j < odd.size(); j++) base.insert_data(odd[j]);
+    for (size_t j = 0; j < odd.size(); j++) base.remove(odd[j]);
+  });
+  int tier = 2 * (int)(n - n / 100) - 1;
+  RBT<int> top_tier;
+  ctx.run("rbt/split_at_join_top_1pct", n, rounds, [&](size_t) {
+    base.split_at(tier, top_tier);
+    base.join(tier, top_tier);
+    base.remove(tier);
+  });
+  RBT<int> shared_tier(base.node_pool());
+  ctx.run("rbt/split_at_join_top_1pct_shared", n, rounds, [&](size_t) {
+    base.split_at(tier, shared_tier);
+    base.join(tier, shared_tier);
+    base.remove(tier);
+  });
+  sink += base.validate();
+  if (sink == 42) printf(" ");
+}
+
+// ------------------------------------------------------ CompactRBT<int>
+// the same workload on the compact layout (16-byte nodes in one array)
+static void bench_compact_rbt(BenchContext& ctx, size_t n) {
+  vector<int> keys = random_keys(n, 1);
+  vector<int> probes = random_keys(capped(n, 1000000), 2);
+  CompactRBT<int> t;
+  long sink = 0;
+
+  ctx.run("rbt_compact/insert_data", n, n, [&](size_t i) { t.insert_data(keys[i]); });
+  if (t.size() == 0) {
+    for (size_t i = 0; i < n; i++) t.insert_data(keys[i]);  // filtered out above
+  }
+  ctx.run("rbt_compact/contains", n, probes.size(), [&](size_t i) { sink += t.contains(probes[i]); });
+  ctx.run("rbt_compact/rank", n, probes.size(), [&](size_t i) { sink += t.rank(probes[i]).less; });
+  size_t whole = capped(10000000 / n, 50);
+  if (whole == 0) whole = 1;
+  ctx.run("rbt_compact/iterate", n, whole, [&](size_t) {
+    for (CompactRBT<int>::const_iterator it = t.begin(); it != t.end(); ++it) sink += it.key();
+  });
+  ctx.run("rbt_compact/validate", n, whole, [&](size_t) { sink += t.validate(); });
+
+  vector<int> order = keys;
+  shuffle(order.begin(), order.end(), mt19937(3));
+  ctx.run("rbt_compact/remove", n, n, [&](size_t i) { t.remove(order[i]); });
+  if (sink == 42) printf(" ");
+}
+
+// --------------------------------------------------------------------- BST
+static void bench_bst(BenchContext& ctx, size_t n) {
+  vector<int> keys = random_keys(n, 4);
+  BST random_tree;
+  ctx.run("bst/insert_random", n, n, [&](size_t i) { random_tree.insert_data(keys[i]); });
+
+  if (n <= kMaxSortedBst) {
+    BST sorted_tree;
+    ctx.run("bst/insert_sorted", n, n, [&](size_t i) { sorted_tree.insert_data((int)i); });
+  }
+}
+
+// ------------------------------------------------------------ score index
+// the leaderboard's (score, name) index, red-black tree vs. B+ tree, through
+// the ScoreIndex interface Leaderboard uses
+static void bench_score_index(BenchContext& ctx, size_t n) {
+  mt19937 rng(9);
+  vector<ScoreKey> keys(n);
+  for (size_t i = 0; i < n; i++) {
+    keys[i].score = (int)(rng() % 100000);
+    keys[i].name = "player_" + to_string(i);
+  }
+  size_t ops = capped(n, 1000000);
+  vector<size_t> who(ops);
+  for (size_t i = 0; i < ops; i++) who[i] = rng() % n;
+  vector<size_t> order(n);
+  for (size_t i = 0; i < n; i++) order[i] = i;
+  shuffle(order.begin(), order.end(), rng);
+
+  const ScoreIndexKind kinds[] = {ScoreIndexKind::RedBlack, ScoreIndexKind::BTree, ScoreIndexKind::Compact};
+  for (ScoreIndexKind kind : kinds) {
+    string prefix = kind == ScoreIndexKind::BTree ? "index/btree/"
+                  : kind == ScoreIndexKind::Compact ? "index/compact/" : "index/rbt/";
+    unique_ptr<ScoreIndex> index = ScoreIndex::create(kind);
+    long sink = 0;
+    ctx.run(prefix + "insert", n, n, [&](size_t i) { index->insert(keys[i], (int)i); });
+    if (!ctx.wants(prefix + "insert")) {
+      for (size_t i = 0; i < n; i++) index->insert(keys[i], (int)i);
+    }
+    ctx.run(prefix + "position", n, ops, [&](size_t i) { sink += index->position(keys[who[i]]); });
+    ctx.run(prefix + "range_100", n, capped(ops, 200000), [&](size_t i) {
+      ScoreCursor c = index->seek((int)(who[i] % n));
+      for (int k = 0; k < 100 && c.node != NULL; k++, index->next(c)) sink += index->key(c).score;
+    });
+    ctx.run(prefix + "walk", n, capped(10000000 / n, 50), [&](size_t) {
+      for (ScoreCursor c = index->seek(0); c.node != NULL; index->next(c)) sink += index->slot(c);
+    });
+    ctx.run(prefix + "remove", n, n, [&](size_t i) { index->remove(keys[order[i]]); });
+    if (sink == 42) printf(" ");
+  }
+}
+
+// ------------------------------------------------------ approximate rank
+// a board keeping a 0.1% ApproxRank: updates (histogram kept in step) and
+// estimated rank / percentile, next to the exact computeRank
+static void bench_approx(BenchContext& ctx, size_t n) {
+  mt19937 rng(17);
+  vector<string> names(n);
+  for (size_t i = 0; i < n; i++) names[i] = "player_" + to_string(i);
+  size_t ops = capped(n, 1000000);
+  vector<size_t> who(ops);
+  vector<int> new_scores(ops);
+  for (size_t i = 0; i < ops; i++) {
+    who[i] = rng() % n;
+    new_scores[i] = (int)(rng() % 100000);
+  }
+
+  LeaderboardOptions opts;
+  opts.approxRankError = 0.001;
+  Leaderboard lb(opts);
+  for (size_t i = 0; i < n; i++) lb.addOrUpdate(names[i], (int)(rng() % 100000));
+  long sink = 0;
+  ctx.run("approx/addOrUpdate_update", n, ops, [&](size_t i) { lb.addOrUpdate(names[who[i]], new_scores[i]); });
+  ctx.run("approx/approxRankOf", n, ops, [&](size_t i) {
+    int rank = 0;
+    sink += lb.approxRankOf(names[who[i]], rank) ? rank : 0;
+  });
+  ctx.run("approx/approxPercentileOf", n, ops, [&](size_t i) {
+    double pct = 0;
+    sink += lb.approxPercentileOf(names[who[i]], pct) ? (long)pct : 0;
+  });
+  RankInfo info;
+  ctx.run("approx/computeRank_exact", n, ops, [&](size_t i) {
+    sink += lb.computeRank(names[who[i]], info) ? info.rank : 0;
+  });
+  if (sink == 42) printf(" ");
+}
+
+// ------------------------------------------------------------ score scans
+// one pass over n int32 scores per op with each kernel the CPU supports.
+// bytes / (ns/op) = GB/s: at n = 1e7 (40 MB, past the caches) the SIMD
+// kernels should sit near memory bandwidth, scalar well below it.
+static void bench_scan(BenchContext& ctx, size_t n) {
+  mt19937 rng(19);
+  vector<int32_t> column(n);
+  for (size_t i = 0; i < n; i++) column[i] = (int32_t)(rng() % 100000);
+  size_t ops = capped(100000000 / n, 2000);
+  const ScanKernel kernels[] = {ScanKernel::Scalar, ScanKernel::SSE4, ScanKernel::AVX2};
+  const char* names[] = {"scalar", "sse4", "avx2"};
+  size_t sink = 0;
+  for (int k = 0; k < 3; k++) {
+    if (!scan_kernel_supported(kernels[k])) continue;
+    string prefix = string("scan/") + names[k] + "/";
+    ctx.run(prefix + "count_greater", n, ops, [&](size_t i) {
+      sink += scan_count_greater(column.data(), n, (int32_t)(i % 100000), kernels[k]);
+    });
+    ctx.run(prefix + "count_in_range", n, ops, [&](size_t i) {
+      sink += scan_count_in_range(column.data(), n, (int32_t)(i % 50000), (int32_t)(i % 50000) + 25000, kernels[k]);
+    });
+    ctx.run(prefix + "min_max", n, ops, [&](size_t) {
+      int32_t lo = 0, hi = 0;
+      scan_min_max(column.data(), n, lo, hi, kernels[k]);
+      sink += (size_t)(hi - lo);
+    });
+  }
+  if (sink == 42) printf(" ");
+}
+
+// ---------------------------------------------------------- sharded boards
+// 8 shards: global rank from summed per-shard counts and global top-K from
+// the k-way merge, against the same queries on one board holding everyone
+static void bench_sharded(BenchContext& ctx, size_t n) {
+  const int kShards = 8;
+  mt19937 rng(13);
+  vector<string> names(n);
+  vector<int> scores(n);
+  for (size_t i = 0; i < n; i++) {
+    names[i] = "player_" + to_string(i);
+    scores[i] = (int)(rng() % 100000);
+  }
+  size_t ops = capped(n, 200000);
+  vector<size_t> who(ops);
+  for (size_t i = 0; i < ops; i++) who[i] = rng() % n;
+
+  ShardedLeaderboard sharded(kShards);
+  Leaderboard single;
+  for (size_t i = 0; i < n; i++) {
+    sharded.addOrUpdate((int)(i % kShards), names[i], scores[i]);
+    single.addOrUpdate(names[i], scores[i]);
+  }
+  long sink = 0;
+  RankInfo info;
+  ctx.run("sharded/computeGlobalRank", n, ops, [&](size_t i) {
+    sink += sharded.computeGlobalRank(names[who[i]], info) ? info.rank : 0;
+  });
+  ctx.run("sharded/computeRank_one_board", n, ops, [&](size_t i) {
+    sink += single.computeRank(names[who[i]], info) ? info.rank : 0;
+  });
+  ctx.run("sharded/topK_100", n, capped(ops, 20000), [&](size_t) { sink += (long)sharded.topK(100).size(); });
+  ctx.run("sharded/topK_100_one_board", n, capped(ops, 20000), [&](size_t) { sink += (long)single.rows(0, 100).size(); });
+  if (sink == 42) printf(" ");
+}
+
+// ------------------------------------------------------- windowed boards
+// daily / weekly / all-time: one WindowedLeaderboard vs. three Leaderboards,
+// and a daily rollover (fresh index swapped in) vs. replacing the board
+static void bench_windowed(BenchContext& ctx, size_t n) {
+  mt19937 rng(11);
+  vector<string> names(n);
+  vector<int> scores(n);
+  for (size_t i = 0; i < n; i++) {
+    names[i] = "player_" + to_string(i);
+    scores[i] = (int)(rng() % 100000);
+  }
+
+  WindowedLeaderboard win;
+  ctx.run("windowed/addOrUpdate_new", n, n, [&](size_t i) { win.addOrUpdate(names[i], scores[i]); });
+  if (!ctx.wants("windowed/addOrUpdate_new")) {
+    for (size_t i = 0; i < n; i++) win.addOrUpdate(names[i], scores[i]);
+  }
+  ctx.run("windowed/rollover_daily", n, 1, [&](size_t) { win.rollover(LeaderboardWindow::Daily); });
+
+  unique_ptr<Leaderboard> boards[3];
+  for (int w = 0; w < 3; w++) boards[w] = make_unique<Leaderboard>();
+  ctx.run("windowed/addOrUpdate_new_3_boards", n, n, [&](size_t i) {
+    for (int w = 0; w < 3; w++) boards[w]->addOrUpdate(names[i], scores[i]);
+  });
+  if (!ctx.wants("windowed/addOrUpdate_new_3_boards")) {
+    for (size_t i = 0; i < n; i++) boards[0]->addOrUpdate(names[i], scores[i]);
+  }
+  ctx.run("windowed/rollover_daily_new_board", n, 1, [&](size_t) { boards[0] = make_unique<Leaderboard>(); });
+}
+
+// ------------------------------------------------------------- Leaderboard
+static void bench_leaderboard(BenchContext& ctx, size_t n) {
+  mt19937 rng(5);
+  vector<string> names(n);
+  vector<int> scores(n);
+  for (size_t i = 0; i < n; i++) {
+    names[i] = "player_" + to_string(i);
+    scores[i] = (int)(rng() % 100000);
+  }
+  size_t ops = capped(n, 1000000);
+  vector<size_t> who(ops);
+  vector<int> new_scores(ops);
+  for (size_t i = 0; i < ops; i++) {
+    who[i] = rng() % n;
+    new_scores[i] = (int)(rng() % 100000);
+  }
+
+  Leaderboard lb;
+  ctx.run("leaderboard/addOrUpdate_new", n, n, [&](size_t i) { lb.addOrUpdate(names[i], scores[i]); });
+  if (!ctx.wants("leaderboard/addOrUpdate_new")) {
+    for (size_t i = 0; i < n; i++) lb.addOrUpdate(names[i], scores[i]);
+  }
+  ctx.run("leaderboard/addOrUpdate_update", n, ops, [&](size_t i) {
+    lb.addOrUpdate(names[who[i]], new_scores[i]);
+  });
+  if (ctx.wants("leaderboard/addOrUpdate_checked")) {
+    // the same score changes with the per-update invariant check on
+    LeaderboardOptions checkedOpts;
+    checkedOpts.checkUpdates = true;
+    Leaderboard checked(checkedOpts);
+    vector<Player> rows(n);
+    for (size_t i = 0; i < n; i++) rows[i] = Player{names[i], scores[i]};
+    checked.bulkLoad(rows);
+    ctx.run("leaderboard/addOrUpdate_checked", n, ops, [&](size_t i) {
+      checked.addOrUpdate(names[who[i]], new_scores[i]);
+    });
+  }
+
+  long sink = 0;
+  RankInfo info;
+  // reading the first 100 rows: a walk of the tree into a new list each
+  // time, vs. a board keeping them materialized (and what that costs its
+  // updates)
+  ctx.run("leaderboard/topK_100_walk", n, capped(ops, 200000), [&](size_t) {
+    for (const Player& p : lb.topK(100)) sink += p.score;
+  });
+  if (ctx.wants("leaderboard/addOrUpdate_top100") || ctx.wants("leaderboard/topK_100")) {
+    LeaderboardOptions topOpts;
+    topOpts.topRows = 100;
+    Leaderboard listed(topOpts);
+    vector<Player> rows(n);
+    for (size_t i = 0; i < n; i++) rows[i] = Player{names[i], scores[i]};
+    listed.bulkLoad(rows);
+    ctx.run("leaderboard/addOrUpdate_top100", n, ops, [&](size_t i) {
+      listed.addOrUpdate(names[who[i]], new_scores[i]);
+    });
+    ctx.run("leaderboard/topK_100", n, ops, [&](size_t) {
+      for (const Player& p : listed.topK(100)) sink += p.score;
+    });
+  }
+  ctx.run("leaderboard/computeRank", n, ops, [&](size_t i) {
+    lb.computeRank(names[who[i]], info);
+    sink += info.rank;
+  });
+  ctx.run("leaderboard/neighborsAround", n, capped(ops, 200000), [&](size_t i) {
+    sink += (long)lb.neighborsAround(names[who[i]], 2).size();
+  });
+  // score ranges about 1% of the score space wide
+  ctx.run("leaderboard/countInRange", n, ops, [&](size_t i) {
+    sink += lb.countInRange(new_scores[i], new_scores[i] + 1000);
+  });
+  ctx.run("leaderboard/playersInRange_100", n, capped(ops, 200000), [&](size_t i) {
+    sink += (long)lb.playersInRange(new_scores[i], new_scores[i] + 1000, 100).size();
+  });
+
+  // percentiles and histograms from the score counts, against the linear
+  // way: a pass over every player's score (kept here in board order)
+  vector<int> board(scores);
+  if (ctx.wants("leaderboard/addOrUpdate_update")) {
+    for (size_t i = 0; i < ops; i++) board[who[i]] = new_scores[i];
+  }
+  size_t scans = capped(ops, capped(100000000 / n, 2000));  // linear passes per size
+  vector<int> edges;
+  for (int e = 0; e <= 100000; e += 10000) edges.push_back(e);
+  double pct = 0;
+  ctx.run("leaderboard/percentileOf", n, ops, [&](size_t i) {
+    lb.percentileOf(names[who[i]], pct);
+    sink += (long)pct;
+  });
+  ctx.run("leaderboard/percentileOf_linear", n, scans, [&](size_t i) {
+    int mine = board[who[i]];
+    long below = 0;
+    long tied = 0;
+    for (size_t j = 0; j < n; j++) {
+      below += board[j] < mine;
+      tied += board[j] == mine;
+    }
+    sink += (long)(100.0 * ((double)below + 0.5 * (double)tied) / (double)n);
+  });
+  ctx.run("leaderboard/scoreAtPercentile", n, ops, [&](size_t i) {
+    int at = 0;
+    lb.scoreAtPercentile((double)(i % 101), at);
+    sink += at;
+  });
+  ctx.run("leaderboard/scoreAtPercentile_linear", n, scans, [&](size_t i) {
+    vector<int> copy(board);
+    size_t r = (size_t)ceil((double)(i % 101) / 100.0 * (double)n);
+    if (r < 1) r = 1;
+    nth_element(copy.begin(), copy.begin() + (long)(r - 1), copy.end());
+    sink += copy[r - 1];
+  });
+  ctx.run("leaderboard/histogram_10", n, ops, [&](size_t) {
+    sink += lb.histogram(edges)[0];
+  });
+  ctx.run("leaderboard/histogram_10_linear", n, scans, [&](size_t) {
+    vector<int> hist(edges.size() - 1, 0);
+    for (size_t j = 0; j < n; j++) {
+      size_t b = (size_t)(upper_bound(edges.begin(), edges.end(), board[j]) - edges.begin());
+      if (b >= 1 && b < edges.size()) hist[b - 1]++;
+    }
+    sink += hist[0];
+  });
+
+  // restart from a binary snapshot: open (mmap + header) and the first rank
+  const char* snap = "bench_snapshot.lbs";
+  ctx.run("leaderboard/saveSnapshot", n, 1, [&](size_t) { sink += lb.saveSnapshot(snap); });
+  if (!ctx.wants("leaderboard/saveSnapshot")) lb.saveSnapshot(snap);
+  ctx.run("leaderboard/openSnapshot_first_rank", n, 20, [&](size_t i) {
+    Leaderboard restarted;
+    restarted.openSnapshot(snap);
+    restarted.computeRank(names[who[i]], info);
+    sink += info.rank;
+  });
+  remove(snap);
+  if (sink == 42) printf(" ");
+}
+
+int main(int argc, char** argv) {
+  BenchContext ctx;
+  string json;
+  size_t max_n = 10000000;
+  vector<size_t> sizes;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--max") == 0 && i + 1 < argc) {
+      max_n = (size_t)strtod(argv[++i], NULL);
+    } else if (strcmp(argv[i], "--sizes") == 0 && i + 1 < argc) {
+      char* p = argv[++i];
+      while (*p != '\0') {
+        sizes.push_back((size_t)strtod(p, &p));
+        if (*p == ',') p++;
+      }
+    } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+      ctx.filter = argv[++i];
+    } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+      json = argv[++i];
+    } else {
+      fprintf(stderr, "usage: %s [--max N] [--sizes a,b,...] [--filter text] [--json file]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (sizes.empty()) {
+    for (size_t n = 1000; n <= max_n; n *= 10) sizes.push_back(n);
+  }
+
+  bench_print_header();
+  for (size_t s = 0; s < sizes.size(); s++) {
+    size_t n = sizes[s];
+    bench_rbt(ctx, n);
+    bench_compact_rbt(ctx, n);
+    bench_bst(ctx, n);
+    bench_score_index(ctx, n);
+    bench_leaderboard(ctx, n);
+    bench_windowed(ctx, n);
+    bench_sharded(ctx, n);
+    bench_approx(ctx, n);
+    bench_scan(ctx, n);
+  }
+
+  if (!json.empty() && !bench_write_json(json, ctx.results)) {
+    fprintf(stderr, "could not write %s\n", json.c_str());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,129 @@
+// Multi-threaded read throughput on a shared Leaderboard.
+//
+// usage: bench_concurrent [--players N] [--threads a,b,...] [--ms T] [--writers W]
+//
+// Each run starts `threads` reader threads doing computeRank / getScore /
+// neighborsAround on random players for T ms, while W writer threads keep
+// calling addOrUpdate. It is run twice per thread count:
+//   external-mutex  the old setup: every call behind one std::mutex
+//   concurrent      LeaderboardOptions::concurrent (shared reader lock)
+// and prints total reader operations per second.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Leaderboard.h"
+
+using namespace std;
+
+struct Workload {
+  vector<string> names;
+  int ms;
+  int writers;
+};
+
+// run_once returns reader ops/second. lock_all = wrap every call in one mutex.
+static double run_once(Leaderboard& lb, const Workload& w, int readers, bool lock_all) {
+  mutex big;
+  atomic<bool> stop(false);
+  atomic<long> reads(0);
+  vector<thread> pool;
+
+  for (int t = 0; t < readers; t++) {
+    pool.push_back(thread([&, t]() {
+      mt19937 rng((unsigned)t + 11);
+      long local = 0;
+      RankInfo info;
+      int sc = 0;
+      while (!stop.load(memory_order_relaxed)) {
+        const string& name = w.names[rng() % w.names.size()];
+        int kind = (int)(rng() % 8);
+        unique_lock<mutex> g(big, defer_lock);
+        if (lock_all) g.lock();
+        if (kind < 5) lb.computeRank(name, info);
+        else if (kind < 7) lb.getScore(name, sc);
+        else lb.neighborsAround(name, 2);
+        local++;
+      }
+      reads += local;
+    }));
+  }
+  for (int t = 0; t < w.writers; t++) {
+    pool.push_back(thread([&, t]() {
+      mt19937 rng((unsigned)t + 101);
+      while (!stop.load(memory_order_relaxed)) {
+        unique_lock<mutex> g(big, defer_lock);
+        if (lock_all) g.lock();
+        lb.addOrUpdate(w.names[rng() % w.names.size()], (int)(rng() % 100000));
+      }
+    }));
+  }
+
+  this_thread::sleep_for(chrono::milliseconds(w.ms));
+  stop = true;
+  for (size_t i = 0; i < pool.size(); i++) pool[i].join();
+  return (double)reads.load() * 1000.0 / (double)w.ms;
+}
+
+int main(int argc, char** argv) {
+  size_t players = 1000000;
+  Workload w;
+  w.ms = 1000;
+  w.writers = 1;
+  vector<int> threads;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--players") == 0 && i + 1 < argc) {
+      players = (size_t)strtod(argv[++i], NULL);
+    } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      char* p = argv[++i];
+      while (*p != '\0') {
+        threads.push_back((int)strtol(p, &p, 10));
+        if (*p == ',') p++;
+      }
+    } else if (strcmp(argv[i], "--ms") == 0 && i + 1 < argc) {
+      w.ms = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--writers") == 0 && i + 1 < argc) {
+      w.writers = atoi(argv[++i]);
+    } else {
+      fprintf(stderr, "usage: %s [--players N] [--threads a,b,...] [--ms T] [--writers W]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (threads.empty()) {
+    int hw = (int)thread::hardware_concurrency();
+    if (hw < 1) hw = 1;
+    for (int t = 1; t < hw; t *= 2) threads.push_back(t);
+    threads.push_back(hw);
+  }
+
+  mt19937 rng(5);
+  vector<Player> rows(players);
+  for (size_t i = 0; i < players; i++) {
+    rows[i].name = "player_" + to_string(i);
+    rows[i].score = (int)(rng() % 100000);
+    w.names.push_back(rows[i].name);
+  }
+  Leaderboard plain;
+  LeaderboardOptions opts;
+  opts.concurrent = true;
+  Leaderboard shared(opts);
+  plain.bulkLoad(rows);
+  shared.bulkLoad(rows);
+
+  printf("%zu players, %d writer thread(s), %d ms per run, %u hardware threads\n",
+         players, w.writers, w.ms, thread::hardware_concurrency());
+  printf("%8s %22s %22s\n", "readers", "external-mutex ops/s", "concurrent ops/s");
+  for (size_t i = 0; i < threads.size(); i++) {
+    double a = run_once(plain, w, threads[i], true);
+    double b = run_once(shared, w, threads[i], false);
+    printf("%8d %22.0f %22.0f\n", threads[i], a, b);
+  }
+  return 0;
+}
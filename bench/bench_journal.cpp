@@ -0,0 +1,154 @@
+// Cost of logging Leaderboard updates to a Journal.
+//
+// usage: bench_journal [--players N] [--updates U] [--durable D] [--windows a,b,...]
+//                      [--threads T] [--file path]
+//
+// For each group-commit window (in microseconds) it runs:
+//   queued    one thread, U updates, addOrUpdate returns once the record is queued
+//   durable   T threads, D updates, addOrUpdate returns once the record is synced
+// and prints the addOrUpdate latency (mean, p50, p99), how many bytes each
+// update added to the journal and how many updates shared one fdatasync.
+// The first line is the same workload without a journal.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Leaderboard.h"
+#include "bench_util.h"
+
+using namespace std;
+
+struct Workload {
+  vector<Player> rows;      // starting board
+  vector<size_t> who;       // updates[i] changes rows[who[i]]
+  vector<int> scores;
+  string file;
+};
+
+static void print_row(const char* mode, long window_us, int threads, vector<double>& samples,
+                      double seconds, const JournalStats* st) {
+  sort(samples.begin(), samples.end());
+  double sum = 0;
+  for (size_t i = 0; i < samples.size(); i++) sum += samples[i];
+  double mean = samples.empty() ? 0 : sum / (double)samples.size();
+  double p50 = samples.empty() ? 0 : samples[samples.size() / 2];
+  double p99 = samples.empty() ? 0 : samples[(size_t)((double)samples.size() * 0.99)];
+  printf("%-8s %9ld %7d %12.0f %10.0f %10.0f %10.0f", mode, window_us, threads,
+         (double)samples.size() / seconds, mean, p50, p99);
+  if (st != NULL && st->records > 0 && st->frames > 0) {
+    printf(" %9.1f %10.1f\n", (double)st->bytes / (double)st->records,
+           (double)st->records / (double)st->frames);
+  } else {
+    printf(" %9s %10s\n", "-", "-");
+  }
+}
+
+// run times every addOrUpdate of the workload, split over `threads` threads
+static void run(const Workload& w, size_t count, const char* mode, long window_us, int threads,
+                bool durable, bool journaled) {
+  remove(w.file.c_str());
+  JournalOptions jo;
+  jo.commitWindow = chrono::microseconds(window_us);
+  jo.waitDurable = durable;
+  Journal wal(w.file, jo);
+  LeaderboardOptions lo;
+  lo.concurrent = threads > 1;
+  Leaderboard lb(lo);
+  lb.bulkLoad(w.rows);
+  if (journaled) lb.attachJournal(&wal);
+
+  double overhead = bench_timer_overhead_ns();
+  vector<vector<double> > per(threads);
+  vector<thread> pool;
+  bench_clock::time_point start = bench_clock::now();
+  for (int t = 0; t < threads; t++) {
+    pool.push_back(thread([&, t]() {
+      for (size_t i = (size_t)t; i < count; i += (size_t)threads) {
+        bench_clock::time_point t0 = bench_clock::now();
+        lb.addOrUpdate(w.rows[w.who[i]].name, w.scores[i]);
+        bench_clock::time_point t1 = bench_clock::now();
+        double ns = (double)chrono::duration_cast<chrono::nanoseconds>(t1 - t0).count() - overhead;
+        per[(size_t)t].push_back(ns < 0 ? 0 : ns);
+      }
+    }));
+  }
+  for (size_t i = 0; i < pool.size(); i++) pool[i].join();
+  double seconds = chrono::duration<double>(bench_clock::now() - start).count();
+  lb.attachJournal(NULL);
+  wal.flush();
+
+  vector<double> samples;
+  for (size_t t = 0; t < per.size(); t++) samples.insert(samples.end(), per[t].begin(), per[t].end());
+  JournalStats st = wal.stats();
+  print_row(mode, window_us, threads, samples, seconds, journaled ? &st : NULL);
+}
+
+int main(int argc, char** argv) {
+  size_t players = 100000;
+  size_t updates = 200000;
+  size_t durableUpdates = 10000;   // each one waits up to a window for its sync
+  int threads = 8;
+  vector<long> windows;
+  Workload w;
+  w.file = "bench_journal.wal";
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--players") == 0 && i + 1 < argc) {
+      players = (size_t)strtod(argv[++i], NULL);
+    } else if (strcmp(argv[i], "--updates") == 0 && i + 1 < argc) {
+      updates = (size_t)strtod(argv[++i], NULL);
+    } else if (strcmp(argv[i], "--durable") == 0 && i + 1 < argc) {
+      durableUpdates = (size_t)strtod(argv[++i], NULL);
+    } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      threads = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--windows") == 0 && i + 1 < argc) {
+      char* p = argv[++i];
+      while (*p != '\0') {
+        windows.push_back(strtol(p, &p, 10));
+        if (*p == ',') p++;
+      }
+    } else if (strcmp(argv[i], "--file") == 0 && i + 1 < argc) {
+      w.file = argv[++i];
+    } else {
+      fprintf(stderr, "usage: %s [--players N] [--updates U] [--durable D] [--windows a,b,...] "
+              "[--threads T] [--file path]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (windows.empty()) {
+    windows.push_back(0);
+    windows.push_back(1000);
+    windows.push_back(5000);
+  }
+  if (threads < 1) threads = 1;
+  if (durableUpdates > updates) durableUpdates = updates;
+
+  mt19937 rng(5);
+  w.rows.resize(players);
+  for (size_t i = 0; i < players; i++) {
+    w.rows[i].name = "player_" + to_string(i);
+    w.rows[i].score = (int)(rng() % 100000);
+  }
+  w.who.resize(updates);
+  w.scores.resize(updates);
+  for (size_t i = 0; i < updates; i++) {
+    w.who[i] = rng() % players;
+    w.scores[i] = (int)(rng() % 100000);
+  }
+
+  printf("%zu players, %zu updates, journal file %s\n", players, updates, w.file.c_str());
+  printf("%-8s %9s %7s %12s %10s %10s %10s %9s %10s\n", "mode", "window_us", "threads", "updates/s",
+         "mean_ns", "p50_ns", "p99_ns", "bytes/upd", "upd/fsync");
+  run(w, updates, "none", 0, 1, false, false);
+  for (size_t i = 0; i < windows.size(); i++) {
+    run(w, updates, "queued", windows[i], 1, false, true);
+    run(w, durableUpdates, "durable", windows[i], threads, true, true);
+  }
+  remove(w.file.c_str());
+  return 0;
+}
@@ -0,0 +1,74 @@
+// Name lookup benchmark: hash index (NameIndex) vs the old linear scan
+// over the player array. Usage: bench_lookup [n1 n2 ...]
+// (defaults to 100k, 1M and 10M players).
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include "Leaderboard.h"
+
+using namespace std;
+
+typedef chrono::steady_clock bench_clock;
+
+// the lookup Leaderboard::findIndexByName used before the hash index
+static int linear_find(const vector<Player>& players, const string& name) {
+  for (size_t i = 0; i < players.size(); i++) {
+    if (players[i].name == name) return (int)i;
+  }
+  return -1;
+}
+
+static double ns_since(bench_clock::time_point t0, size_t ops) {
+  double ns = (double)chrono::duration_cast<chrono::nanoseconds>(bench_clock::now() - t0).count();
+  return ns / (double)ops;
+}
+
+int main(int argc, char** argv) {
+  vector<size_t> sizes;
+  for (int i = 1; i < argc; i++) sizes.push_back((size_t)strtoull(argv[i], NULL, 10));
+  if (sizes.empty()) {
+    sizes.push_back(100000);
+    sizes.push_back(1000000);
+    sizes.push_back(10000000);
+  }
+
+  printf("%12s %16s %16s %10s\n", "players", "linear ns/op", "hash ns/op", "speedup");
+  for (size_t s = 0; s < sizes.size(); s++) {
+    size_t n = sizes[s];
+    vector<Player> players(n);
+    NameIndex index;
+    index.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+      players[i].name = "player_" + to_string(i);
+      players[i].score = (int)i;
+      index.insert(players[i].name, (int)i);
+    }
+    auto name_at = [&players](int slot) -> const string& { return players[(size_t)slot].name; };
+
+    // lookups hit random players; the linear scan gets fewer probes so the
+    // 10M case finishes in seconds
+    mt19937 rng(42);
+    size_t hash_ops = 1000000;
+    size_t linear_ops = 200000000 / n;
+    if (linear_ops < 5) linear_ops = 5;
+    vector<string> probes;
+    for (size_t i = 0; i < hash_ops; i++) probes.push_back(players[rng() % n].name);
+
+    long sink = 0;
+    bench_clock::time_point t0 = bench_clock::now();
+    for (size_t i = 0; i < linear_ops; i++) sink += linear_find(players, probes[i]);
+    double linear_ns = ns_since(t0, linear_ops);
+
+    t0 = bench_clock::now();
+    for (size_t i = 0; i < hash_ops; i++) sink += index.find(probes[i], name_at);
+    double hash_ns = ns_since(t0, hash_ops);
+
+    printf("%12zu %16.1f %16.1f %9.0fx\n", n, linear_ns, hash_ns, linear_ns / hash_ns);
+    if (sink == 42) printf(" ");  // keep the loops from being optimised away
+  }
+  return 0;
+}
@@ -0,0 +1,141 @@
+#ifndef BENCH_UTIL_H__
+#define BENCH_UTIL_H__
+
+// Small timing harness shared by the benchmark programs.
+//
+// Each case times every operation on its own with steady_clock, subtracts the
+// measured cost of an empty timed region, and reports mean ns/op plus the
+// p50 / p99 latency. Peak RSS is the process high-water mark (getrusage) after
+// the case, so run sizes in increasing order to read it per size.
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+struct BenchResult {
+  string name;       // "<structure>/<operation>"
+  size_t n;          // elements in the structure
+  size_t ops;        // timed operations
+  double ns_per_op;
+  double p50_ns;
+  double p99_ns;
+  long peak_rss_kb;
+};
+
+typedef chrono::steady_clock bench_clock;
+
+// peak resident set size of this process so far, in KiB
+inline long bench_peak_rss_kb() {
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  return ru.ru_maxrss;  // Linux reports KiB
+}
+
+// cost of an empty timed region, subtracted from every sample
+inline double bench_timer_overhead_ns() {
+  static double overhead = -1;
+  if (overhead >= 0) return overhead;
+  vector<int64_t> s(10000);
+  for (size_t i = 0; i < s.size(); i++) {
+    bench_clock::time_point t0 = bench_clock::now();
+    bench_clock::time_point t1 = bench_clock::now();
+    s[i] = chrono::duration_cast<chrono::nanoseconds>(t1 - t0).count();
+  }
+  sort(s.begin(), s.end());
+  overhead = (double)s[s.size() / 2];
+  return overhead;
+}
+
+// bench_run times op(i) for i in [0, ops) and summarises the samples.
+template <class Op>
+BenchResult bench_run(const string& name, size_t n, size_t ops, Op op) {
+  double overhead = bench_timer_overhead_ns();
+  vector<double> samples(ops);
+  double total = 0;
+  for (size_t i = 0; i < ops; i++) {
+    bench_clock::time_point t0 = bench_clock::now();
+    op(i);
+    bench_clock::time_point t1 = bench_clock::now();
+    double ns = (double)chrono::duration_cast<chrono::nanoseconds>(t1 - t0).count() - overhead;
+    if (ns < 0) ns = 0;
+    samples[i] = ns;
+    total += ns;
+  }
+
+  BenchResult r;
+  r.name = name;
+  r.n = n;
+  r.ops = ops;
+  r.ns_per_op = ops > 0 ? total / (double)ops : 0;
+  r.p50_ns = 0;
+  r.p99_ns = 0;
+  if (ops > 0) {
+    size_t k50 = ops / 2;
+    size_t k99 = (size_t)((double)(ops - 1) * 0.99);
+    nth_element(samples.begin(), samples.begin() + (long)k50, samples.end());
+    r.p50_ns = samples[k50];
+    nth_element(samples.begin(), samples.begin() + (long)k99, samples.end());
+    r.p99_ns = samples[k99];
+  }
+  r.peak_rss_kb = bench_peak_rss_kb();
+  return r;
+}
+
+// one line per result, aligned for the terminal
+inline void bench_print_header() {
+  printf("%-34s %10s %10s %12s %10s %10s %12s\n",
+         "case", "n", "ops", "ns/op", "p50", "p99", "peakRSS(KB)");
+}
+
+inline void bench_print(const BenchResult& r) {
+  printf("%-34s %10zu %10zu %12.1f %10.0f %10.0f %12ld\n",
+         r.name.c_str(), r.n, r.ops, r.ns_per_op, r.p50_ns, r.p99_ns, r.peak_rss_kb);
+  fflush(stdout);
+}
+
+// bench_write_json writes all results as a JSON array, one object per case,
+// so two runs can be diffed or compared by a script.
+inline bool bench_write_json(const string& path, const vector<BenchResult>& rs) {
+  FILE* f = fopen(path.c_str(), "w");
+  if (f == NULL) return false;
+  fprintf(f, "[\n");
+  for (size_t i = 0; i < rs.size(); i++) {
+    const BenchResult& r = rs[i];
+    fprintf(f,
+            "  {\"name\": \"%s\", \"n\": %zu, \"ops\": %zu, \"ns_per_op\": %.2f, "
+            "\"p50_ns\": %.1f, \"p99_ns\": %.1f, \"peak_rss_kb\": %ld}%s\n",
+            r.name.c_str(), r.n, r.ops, r.ns_per_op, r.p50_ns, r.p99_ns, r.peak_rss_kb,
+            i + 1 < rs.size() ? "," : "");
+  }
+  fprintf(f, "]\n");
+  fclose(f);
+  return true;
+}
+
+// BenchContext runs the cases a program asks for, skipping names that do not
+// contain the --filter text, and keeps every result for the JSON report.
+struct BenchContext {
+  string filter;
+  vector<BenchResult> results;
+
+  bool wants(const string& name) const {
+    return filter.empty() || name.find(filter) != string::npos;
+  }
+
+  template <class Op>
+  void run(const string& name, size_t n, size_t ops, Op op) {
+    if (!wants(name)) return;
+    BenchResult r = bench_run(name, n, ops, op);
+    bench_print(r);
+    results.push_back(r);
+  }
+};
+
+#endif // BENCH_UTIL_H__
@@ -0,0 +1,103 @@
+/* Please refer to the header file (ApproxRank.h) for documentation of each method. */
+
+#include "ApproxRank.h"
+#include <climits>
+
+ApproxRank::ApproxRank(double error)
+  : eps(error), buckets(), fenwick(), total(0), built(0), limit(1), isStale(false) {
+  if (eps < 0.0001) eps = 0.0001;
+  if (eps > 0.5) eps = 0.5;
+  finish(1);
+}
+
+// finish sets up the Fenwick tree over the bucket counts and the limit a
+// multi-score bucket may grow to: its build size plus half the error
+// allowance, so the estimate (off by half a bucket) stays within error * n.
+void ApproxRank::finish(int target) {
+  if (buckets.empty()) {
+    // an empty board: one bucket that takes every score
+    bucket b;
+    b.low = INT_MAX;
+    b.high = INT_MIN;
+    b.count = 0;
+    buckets.push_back(b);
+  }
+  size_t m = buckets.size();
+  fenwick.assign(m + 1, 0);
+  for (size_t i = 1; i <= m; i++) {
+    fenwick[i] += buckets[i - 1].count;
+    size_t up = i + (i & (~i + 1));
+    if (up <= m) fenwick[up] += fenwick[i];
+  }
+  int slack = (int)(0.5 * eps * (double)built);
+  limit = target + (slack > 1 ? slack : 1);
+  isStale = false;
+}
+
+size_t ApproxRank::memoryBytes() const {
+  return buckets.capacity() * sizeof(bucket) + fenwick.capacity() * sizeof(int);
+}
+
+// binary search for the first bucket whose low is <= score (lows decrease);
+// a score below every low belongs to the last bucket
+size_t ApproxRank::find(int score) const {
+  size_t lo = 0;
+  size_t hi = buckets.size() - 1;
+  while (lo < hi) {
+    size_t mid = (lo + hi) / 2;
+    if (buckets[mid].low <= score) hi = mid;
+    else lo = mid + 1;
+  }
+  return lo;
+}
+
+void ApproxRank::bump(size_t i, int delta) {
+  buckets[i].count += delta;
+  for (size_t j = i + 1; j < fenwick.size(); j += j & (~j + 1)) fenwick[j] += delta;
+}
+
+int ApproxRank::countBefore(size_t i) const {
+  int s = 0;
+  for (size_t j = i; j > 0; j -= j & (~j + 1)) s += fenwick[j];
+  return s;
+}
+
+// a board that shrank by a quarter has a smaller error allowance than the
+// limits were set for
+void ApproxRank::checkSize() {
+  if (4 * (long long)total < 3 * (long long)built) isStale = true;
+}
+
+void ApproxRank::add(int score) {
+  size_t i = find(score);
+  bucket& b = buckets[i];
+  // widen the bucket's range; the last bucket's low moves down with it
+  if (score > b.high) b.high = score;
+  if (score < b.low) b.low = score;
+  bump(i, 1);
+  total++;
+  if (b.count > limit && b.low != b.high) isStale = true;
+}
+
+void ApproxRank::remove(int score) {
+  bump(find(score), -1);
+  total--;
+  checkSize();
+}
+
+int ApproxRank::above(int score) const {
+  size_t i = find(score);
+  int a = countBefore(i);
+  const bucket& b = buckets[i];
+  if (b.low == b.high) return a;   // one score: exact
+  return a + b.count / 2;
+}
+
+double ApproxRank::percentile(int score) const {
+  if (total <= 0) return 0.0;
+  // below + half the ties = everyone not above minus half the ties; with a
+  // whole bucket unknown, half of it is the middle of the possible answers
+  size_t i = find(score);
+  double notBelow = (double)countBefore(i) + 0.5 * (double)buckets[i].count;
+  return 100.0 * ((double)total - notBelow) / (double)total;
+}
@@ -0,0 +1,117 @@
+#ifndef APPROX_RANK_H__
+#define APPROX_RANK_H__
+
+#include <cstddef>
+#include <vector>
+
+using namespace std;
+
+// ApproxRank estimates ranks and percentiles from a small equi-depth
+// histogram of the scores, within a configured error, in memory that does
+// not grow with the number of players.
+//
+// The scores are cut into about 1/error buckets of consecutive scores, each
+// holding about error * n players when built. A bucket keeps its lowest and
+// highest score and how many players are in it; a Fenwick tree over the
+// bucket counts gives the players in all higher buckets in O(log buckets).
+// A score's rank is estimated as everyone in the higher buckets plus half of
+// its own bucket, which is off by at most half the bucket. A bucket holding
+// a single score is exact; ties are never split between buckets, so a score
+// shared by many players is one exact bucket however big it gets.
+//
+// add / remove adjust one bucket: O(log buckets) and no allocation. Once a
+// bucket grows past its limit or the board shrinks by a quarter, stale()
+// turns true and the owner calls rebuild() with the exact data, O(buckets
+// log n). A rebuild leaves every bucket at least error * n / 2 updates away
+// from its limit, so the amortized cost per update stays constant.
+//
+// While not stale the rank error is at most max(error * n, 1) players.
+// Memory is 16 bytes per bucket: about 16 KB for a 0.1% error, 1.6 KB for 1%.
+class ApproxRank {
+public:
+  // error: the largest rank error, as a fraction of the players (0.001 for
+  // 0.1%). Clipped to [0.0001, 0.5].
+  explicit ApproxRank(double error);
+
+  double error() const { return eps; }
+
+  // a player joins with score / leaves with score
+  void add(int score);
+  void remove(int score);
+
+  // true once the error bound can no longer be kept without a rebuild
+  bool stale() const { return isStale; }
+
+  // rebuild the buckets for n players. scoreAt(p) is the score at 0-based
+  // position p in leaderboard order (highest first); countAround(s, above,
+  // tied) gives the players above s and on s, as Leaderboard::countAround.
+  template <class ScoreAt, class CountAround>
+  void rebuild(int n, ScoreAt scoreAt, CountAround countAround);
+
+  // estimated number of players scoring above score (rank - 1)
+  int above(int score) const;
+
+  // estimated percentile of a player on score, as Leaderboard::percentileOf:
+  // the share below them counting half of their ties. 0 on an empty board.
+  double percentile(int score) const;
+
+  int size() const { return total; }
+  size_t bucketCount() const { return buckets.size(); }
+  size_t memoryBytes() const;
+
+private:
+  // scores in [low, high]; bucket i holds every score below bucket i - 1's
+  // low and at or above its own, so lows are strictly decreasing. The first
+  // bucket also takes any higher score, the last one any lower.
+  struct bucket {
+    int low;
+    int high;
+    int count;
+  };
+
+  double eps;
+  vector<bucket> buckets;   // highest scores first
+  vector<int> fenwick;      // Fenwick tree over the bucket counts
+  int total;
+  int built;                // players at the last rebuild
+  int limit;                // most players a multi-score bucket may hold
+  bool isStale;
+
+  size_t find(int score) const;                  // bucket of score
+  void bump(size_t i, int delta);                // count and Fenwick tree
+  int countBefore(size_t i) const;               // players in buckets [0, i)
+  void finish(int target);                       // Fenwick tree and limit
+  void checkSize();
+};
+
+template <class ScoreAt, class CountAround>
+void ApproxRank::rebuild(int n, ScoreAt scoreAt, CountAround countAround) {
+  buckets.clear();
+  int want = (int)(1.0 / eps + 0.5);                // buckets to aim for
+  int target = (n + want - 1) / want;               // players per bucket
+  if (target < 1) target = 1;
+  int pos = 0;
+  while (pos < n) {
+    bucket b;
+    b.high = scoreAt(pos);
+    int end = (pos + target < n) ? pos + target : n;
+    b.low = scoreAt(end - 1);
+    int over = 0;
+    int tied = 0;
+    countAround(b.low, over, tied);
+    int next = over + tied;   // everyone scoring >= low: a tie is never cut
+    if (b.low != b.high && next - pos > target && over > pos) {
+      // a large tie at low: close the bucket above it, the tie gets its own
+      next = over;
+      b.low = scoreAt(next - 1);
+    }
+    b.count = next - pos;
+    buckets.push_back(b);
+    pos = next;
+  }
+  total = n;
+  built = n;
+  finish(target);
+}
+
+#endif // APPROX_RANK_H__
@@ -0,0 +1,872 @@
+#ifndef BTREE_H__
+#define BTREE_H__
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+#include "RBT.h"   // rb_no_value, rb_rank, rb_mem_stats
+
+using namespace std;
+
+// BTree is an order-statistic B+ tree: the same ordered multiset as RBT
+// (insert, remove, rank, select, bounds, in-order walk), laid out for the
+// cache instead of one heap node per key.
+//
+// Leaves hold up to Width keys (and their values) side by side and are
+// chained left to right, so an in-order walk is a scan over arrays. Inner
+// nodes hold up to Width children, the Width - 1 separator keys between
+// them and the number of keys below each child; a descent reads a handful of
+// wide nodes instead of ~2 log2(n) scattered ones, and the counts give rank
+// and select in the same descent.
+//
+// Separators: every key below child[i] is <= keys[i] and every key below
+// child[i + 1] is >= keys[i]. A separator is the first key of its right
+// subtree when it is made; removals may leave it as a key that is no longer
+// stored, which still divides the two sides correctly.
+//
+// Every node except the root is at least half full, so all leaves are at
+// depth O(log n / log Width). Inserting an equal key puts it after the keys
+// it ties with, as RBT does.
+
+template <class Key, class Value, int Width>
+struct bt_node {
+  int n;       // keys in a leaf, children in an inner node
+  bool leaf;
+};
+
+template <class Key, class Value, int Width>
+struct bt_leaf : bt_node<Key, Value, Width> {
+  Key keys[Width];
+  Value values[Width];
+  bt_leaf* next;   // the leaf to the right, NULL for the last one
+};
+
+template <class Key, class Value, int Width>
+struct bt_inner : bt_node<Key, Value, Width> {
+  Key keys[Width - 1];                     // keys[i] separates child[i] and child[i + 1]
+  bt_node<Key, Value, Width>* child[Width];
+  int count[Width];                        // keys below child[i]
+};
+
+template <class Key, class Value = rb_no_value, class Compare = std::less<Key>, int Width = 32>
+class BTree {
+public:
+  static_assert(Width >= 4, "BTree nodes need room for at least four entries");
+
+  typedef bt_node<Key, Value, Width> node_type;
+  typedef bt_leaf<Key, Value, Width> leaf_type;
+  typedef bt_inner<Key, Value, Width> inner_type;
+
+  explicit BTree(const Compare& comp = Compare());
+  ~BTree();
+  BTree(const BTree&) = delete;
+  BTree& operator=(const BTree&) = delete;
+
+  // number of keys
+  int size() const { return total; }
+
+  // insert_data adds data with its value; equal keys are kept, after the
+  // ones already there. O(log n).
+  void insert_data(const Key& data, const Value& value = Value());
+
+  // remove deletes one key equal to data; false if there is none. O(log n).
+  bool remove(const Key& data);
+
+  bool contains(const Key& data) const;
+
+  // empty the tree and free every node
+  void clear();
+
+  // build_from_sorted replaces the tree with n keys already in order,
+  // key_at(i) / value_at(i) for i = 0..n-1, packing the leaves in O(n).
+  template <class KeyAt, class ValueAt>
+  void build_from_sorted(int n, KeyAt key_at, ValueAt value_at);
+
+  // order statistics, same meaning as RBT::rank: how many keys order before
+  // data, tie with it and order after it. K is anything Compare orders
+  // against Key.
+  template <class K>
+  rb_rank rank(const K& data) const;
+  // position: rank(data).less alone, in one descent
+  template <class K>
+  int position(const K& data) const;
+
+  // const_iterator walks the keys in order along the leaf chain. It is
+  // invalidated by any insert or remove.
+  class const_iterator {
+  public:
+    const_iterator() : leaf(NULL), at(0) {}
+    const Key& key() const { return leaf->keys[at]; }
+    const Value& value() const { return leaf->values[at]; }
+    // the leaf and the entry in it, for callers that keep their own cursor
+    const leaf_type* node() const { return leaf; }
+    int index() const { return at; }
+    const_iterator& operator++() {
+      if (++at == leaf->n) {
+        leaf = leaf->next;
+        at = 0;
+      }
+      return *this;
+    }
+    bool operator==(const const_iterator& o) const { return leaf == o.leaf && at == o.at; }
+    bool operator!=(const const_iterator& o) const { return !(*this == o); }
+
+  private:
+    friend class BTree;
+    const_iterator(const leaf_type* l, int i) : leaf(l), at(i) {}
+    const leaf_type* leaf;   // NULL at end()
+    int at;
+  };
+
+  const_iterator begin() const;
+  const_iterator end() const { return const_iterator(); }
+
+  // select: iterator at the k-th smallest key (0-based); end() if out of range
+  const_iterator select(int k) const;
+
+  // lower_bound: the first key not less than data; upper_bound: the first
+  // key greater than data. end() if there is none. O(log n).
+  template <class K>
+  const_iterator lower_bound(const K& data) const;
+  template <class K>
+  const_iterator upper_bound(const K& data) const;
+
+  // validate checks the whole tree: keys in order within and across nodes
+  // and the leaf chain, separators, fill, equal leaf depth and the counts.
+  bool validate() const;
+
+  // incremental checking, as RBT::track_changes / validate_changes: the
+  // nodes writes touch are logged, and validate_changes re-checks just those
+  // (their order, fill, separators against their children and counts), then
+  // clears the log. Past kMaxChanged nodes it checks the whole tree.
+  void track_changes(bool on);
+  bool validate_changes();
+
+  // node memory: every node is one allocation of sizeof(leaf_type) or
+  // sizeof(inner_type)
+  rb_mem_stats mem_stats() const;
+
+private:
+  static const int kMin = Width / 2;          // fill of every non-root node
+  static const size_t kMaxChanged = 256;
+
+  node_type* root;      // NULL when empty
+  int total;
+  Compare comp;
+  size_t live_leaves;
+  size_t live_inners;
+  size_t peak_nodes;
+  size_t peak_bytes;
+
+  bool track;
+  bool changed_all;
+  vector<node_type*> changed;
+
+  leaf_type* new_leaf();
+  inner_type* new_inner();
+  void count_new_node();
+  void free_node(node_type* n);
+  void free_subtree(node_type* n);
+  void note_change(node_type* n);
+  static int subtree_size(const node_type* n);
+
+  // positions inside one node
+  template <class K>
+  int below(const Key* keys, int n, const K& data) const;     // keys < data
+  template <class K>
+  int at_most(const Key* keys, int n, const K& data) const;   // keys <= data
+
+  node_type* insert_into(node_type* n, const Key& data, const Value& value, Key& sep);
+  bool remove_from(node_type* n, const Key& data);
+  void fix_child(inner_type* p, int i);
+
+  bool check_node(const node_type* n, const Key* lo, const Key* hi, int depth, int& leaf_depth,
+                  int& size) const;
+  bool check_local(const node_type* n) const;
+};
+
+// ---------------------------------------------------------------- helpers
+
+template <class Key, class Value, class Compare, int Width>
+BTree<Key, Value, Compare, Width>::BTree(const Compare& c)
+  : root(NULL), total(0), comp(c), live_leaves(0), live_inners(0), peak_nodes(0), peak_bytes(0),
+    track(false), changed_all(false), changed() {}
+
+template <class Key, class Value, class Compare, int Width>
+BTree<Key, Value, Compare, Width>::~BTree() {
+  free_subtree(root);
+}
+
+template <class Key, class Value, class Compare, int Width>
+typename BTree<Key, Value, Compare, Width>::leaf_type* BTree<Key, Value, Compare, Width>::new_leaf() {
+  leaf_type* l = new leaf_type();
+  l->n = 0;
+  l->leaf = true;
+  l->next = NULL;
+  live_leaves++;
+  count_new_node();
+  return l;
+}
+
+template <class Key, class Value, class Compare, int Width>
+typename BTree<Key, Value, Compare, Width>::inner_type* BTree<Key, Value, Compare, Width>::new_inner() {
+  inner_type* in = new inner_type();
+  in->n = 0;
+  in->leaf = false;
+  live_inners++;
+  count_new_node();
+  return in;
+}
+
+template <class Key, class Value, class Compare, int Width>
+void BTree<Key, Value, Compare, Width>::count_new_node() {
+  size_t bytes = live_leaves * sizeof(leaf_type) + live_inners * sizeof(inner_type);
+  if (bytes > peak_bytes) peak_bytes = bytes;
+  if (live_leaves + live_inners > peak_nodes) peak_nodes = live_leaves + live_inners;
+}
+
+template <class Key, class Value, class Compare, int Width>
+void BTree<Key, Value, Compare, Width>::free_node(node_type* n) {
+  if (track && !changed_all) changed.erase(std::remove(changed.begin(), changed.end(), n), changed.end());
+  if (n->leaf) {
+    delete static_cast<leaf_type*>(n);
+    live_leaves--;
+  } else {
+    delete static_cast<inner_type*>(n);
+    live_inners--;
+  }
+}
+
+template <class Key, class Value, class Compare, int Width>
+void BTree<Key, Value, Compare, Width>::free_subtree(node_type* n) {
+  if (n == NULL) return;
+  if (!n->leaf) {
+    inner_type* in = static_cast<inner_type*>(n);
+    for (int i = 0; i < in->n; i++) free_subtree(in->child[i]);
+  }
+  free_node(n);
+}
+
+template <class Key, class Value, class Compare, int Width>
+void BTree<Key, Value, Compare, Width>::note_change(node_type* n) {
+  if (!track || changed_all) return;
+  if (changed.size() >= kMaxChanged) {
+    changed_all = true;
+    changed.clear();
+    return;
+  }
+  changed.push_back(n);
+}
+
+template <class Key, class Value, class Compare, int Width>
+int BTree<Key, Value, Compare, Width>::subtree_size(const node_type* n) {
+  if (n->leaf) return n->n;
+  const inner_type* in = static_cast<const inner_type*>(n);
+  int s = 0;
+  for (int i = 0; i < in->n; i++) s += in->count[i];
+  return s;
+}
+
+// below: how many of keys[0..n) order before data (binary search)
+template <class Key, class Value, class Compare, int Width>
+template <class K>
+int BTree<Key, Value, Compare, Width>::below(const Key* keys, int n, const K& data) const {
+  int lo = 0;
+  int hi = n;
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (comp(keys[mid], data)) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo;
+}
+
+// at_most: how many of keys[0..n) do not order after data
+template <class Key, class Value, class Compare, int Width>
+template <class K>
+int BTree<Key, Value, Compare, Width>::at_most(const Key* keys, int n, const K& data) const {
+  int lo = 0;
+  int hi = n;
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (comp(data, keys[mid])) hi = mid;
+    else lo = mid + 1;
+  }
+  return lo;
+}
+
+template <class Key, class Value, class Compare, int Width>
+void BTree<Key, Value, Compare, Width>::clear() {
+  free_subtree(root);
+  root = NULL;
+  total = 0;
+  if (track) {
+    changed_all = true;
+    changed.clear();
+  }
+}
+
+template <class Key, class Value, class Compare, int Width>
+rb_mem_stats BTree<Key, Value, Compare, Width>::mem_stats() const {
+  rb_mem_stats s;
+  s.live_nodes = live_leaves + live_inners;
+  s.live_bytes = live_leaves * sizeof(leaf_type) + live_inners * sizeof(inner_type);
+  s.peak_bytes = peak_bytes;
+  s.peak_nodes = peak_nodes;
+  s.reserved_bytes = s.live_bytes;
+  return s;
+}
+
+// ----------------------------------------------------------------- insert
+
+// insert_into adds data below n. If n had to split, the new right half is
+// returned and sep is set to the key that separates the halves; otherwise
+// NULL.
+template <class Key, class Value, class Compare, int Width>
+typename BTree<Key, Value, Compare, Width>::node_type* BTree<Key, Value, Compare, Width>::insert_into(
+        node_type* n, const Key& data, const Value& value, Key& sep) {
+  note_change(n);
+  if (n->leaf) {
+    leaf_type* l = static_cast<leaf_type*>(n);
+    int pos = at_most(l->keys, l->n, data);   // after equal keys
+    leaf_type* target = l;
+    leaf_type* right = NULL;
+    if (l->n == Width) {
+      // split first, then insert into the half the key belongs to
+      right = new_leaf();
+      note_change(right);
+      int mid = Width / 2;
+      for (int i = mid; i < Width; i++) {
+        right->keys[i - mid] = std::move(l->keys[i]);
+        right->values[i - mid] = std::move(l->values[i]);
+      }
+      right->n = Width - mid;
+      l->n = mid;
+      right->next = l->next;
+      l->next = right;
+      if (pos > mid) {
+        target = right;
+        pos -= mid;
+      }
+    }
+    for (int i = target->n; i > pos; i--) {
+      target->keys[i] = std::move(target->keys[i - 1]);
+      target->values[i] = std::move(target->values[i - 1]);
+    }
+    target->keys[pos] = data;
+    target->values[pos] = value;
+    target->n++;
+    if (right != NULL) sep = right->keys[0];
+    return right;
+  }
+
+  inner_type* in = static_cast<inner_type*>(n);
+  int i = at_most(in->keys, in->n - 1, data);
+  in->count[i]++;
+  Key childSep;
+  node_type* split = insert_into(in->child[i], data, value, childSep);
+  if (split == NULL) return NULL;
+
+  // child i split into child i and split: add split at i + 1
+  int leftCount = subtree_size(in->child[i]);
+  int splitCount = in->count[i] - leftCount;
+  in->count[i] = leftCount;
+  inner_type* target = in;
+  inner_type* right = NULL;
+  int at = i + 1;                 // child index of the new entry
+  if (in->n == Width) {
+    right = new_inner();
+    note_change(right);
+    int mid = Width / 2;          // children kept on the left
+    for (int c = mid; c < Width; c++) {
+      right->child[c - mid] = in->child[c];
+      right->count[c - mid] = in->count[c];
+    }
+    for (int k = mid; k < Width - 1; k++) right->keys[k - mid] = std::move(in->keys[k]);
+    right->n = Width - mid;
+    sep = std::move(in->keys[mid - 1]);
+    in->n = mid;
+    if (at > mid) {
+      target = right;
+      at -= mid;
+    }
+  }
+  for (int c = target->n; c > at; c--) {
+    target->child[c] = target->child[c - 1];
+    target->count[c] = target->count[c - 1];
+  }
+  for (int k = target->n - 1; k > at - 1; k--) target->keys[k] = std::move(target->keys[k - 1]);
+  target->child[at] = split;
+  target->count[at] = splitCount;
+  target->keys[at - 1] = std::move(childSep);
+  target->n++;
+  return right;
+}
+
+template <class Key, class Value, class Compare, int Width>
+void BTree<Key, Value, Compare, Width>::insert_data(const Key& data, const Value& value) {
+  if (root == NULL) {
+    root = new_leaf();
+    note_change(root);
+  }
+  Key sep;
+  node_type* split = insert_into(root, data, value, sep);
+  total++;
+  if (split != NULL) {
+    inner_type* top = new_inner();
+    note_change(top);
+    top->child[0] = root;
+    top->child[1] = split;
+    top->count[1] = subtree_size(split);
+    top->count[0] = total - top->count[1];
+    top->keys[0] = std::move(sep);
+    top->n = 2;
+    root = top;
+  }
+}
+
+// ----------------------------------------------------------------- remove
+
+// fix_child restores the fill of p->child[i] after a removal below it:
+// borrow one entry from a sibling that has one to spare, otherwise merge
+// with a sibling.
+template <class Key, class Value, class Compare, int Width>
+void BTree<Key, Value, Compare, Width>::fix_child(inner_type* p, int i) {
+  node_type* c = p->child[i];
+  if (c->n >= kMin) return;
+  node_type* left = i > 0 ? p->child[i - 1] : NULL;
+  node_type* right = i + 1 < p->n ? p->child[i + 1] : NULL;
+
+  if (c->leaf) {
+    leaf_type* l = static_cast<leaf_type*>(c);
+    if (left != NULL && left->n > kMin) {
+      leaf_type* from = static_cast<leaf_type*>(left);
+      note_change(from);
+      for (int k = l->n; k > 0; k--) {
+        l->keys[k] = std::move(l->keys[k - 1]);
+        l->values[k] = std::move(l->values[k - 1]);
+      }
+      l->keys[0] = std::move(from->keys[from->n - 1]);
+      l->values[0] = std::move(from->values[from->n - 1]);
+      l->n++;
+      from->n--;
+      p->keys[i - 1] = l->keys[0];
+      p->count[i - 1]--;
+      p->count[i]++;
+      return;
+    }
+    if (right != NULL && right->n > kMin) {
+      leaf_type* from = static_cast<leaf_type*>(right);
+      note_change(from);
+      l->keys[l->n] = std::move(from->keys[0]);
+      l->values[l->n] = std::move(from->values[0]);
+      l->n++;
+      for (int k = 1; k < from->n; k++) {
+        from->keys[k - 1] = std::move(from->keys[k]);
+        from->values[k - 1] = std::move(from->values[k]);
+      }
+      from->n--;
+      p->keys[i] = from->keys[0];
+      p->count[i]++;
+      p->count[i + 1]--;
+      return;
+    }
+  } else {
+    inner_type* in = static_cast<inner_type*>(c);
+    if (left != NULL && left->n > kMin) {
+      inner_type* from = static_cast<inner_type*>(left);
+      note_change(from);
+      for (int k = in->n; k > 0; k--) {
+        in->child[k] = in->child[k - 1];
+        in->count[k] = in->count[k - 1];
+      }
+      for (int k = in->n - 1; k > 0; k--) in->keys[k] = std::move(in->keys[k - 1]);
+      in->child[0] = from->child[from->n - 1];
+      in->count[0] = from->count[from->n - 1];
+      in->keys[0] = std::move(p->keys[i - 1]);
+      p->keys[i - 1] = std::move(from->keys[from->n - 2]);
+      in->n++;
+      from->n--;
+      p->count[i - 1] -= in->count[0];
+      p->count[i] += in->count[0];
+      return;
+    }
+    if (right != NULL && right->n > kMin) {
+      inner_type* from = static_cast<inner_type*>(right);
+      note_change(from);
+      in->child[in->n] = from->child[0];
+      in->count[in->n] = from->count[0];
+      in->keys[in->n - 1] = std::move(p->keys[i]);
+      p->keys[i] = std::move(from->keys[0]);
+      in->n++;
+      int moved = from->count[0];
+      for (int k = 1; k < from->n; k++) {
+        from->child[k - 1] = from->child[k];
+        from->count[k - 1] = from->count[k];
+      }
+      for (int k = 1; k < from->n - 1; k++) from->keys[k - 1] = std::move(from->keys[k]);
+      from->n--;
+      p->count[i] += moved;
+      p->count[i + 1] -= moved;
+      return;
+    }
+  }
+
+  // no sibling to borrow from: merge child j + 1 into child j
+  int j = left != NULL ? i - 1 : i;
+  node_type* a = p->child[j];
+  node_type* b = p->child[j + 1];
+  note_change(a);
+  if (a->leaf) {
+    leaf_type* la = static_cast<leaf_type*>(a);
+    leaf_type* lb = static_cast<leaf_type*>(b);
+    for (int k = 0; k < lb->n; k++) {
+      la->keys[la->n + k] = std::move(lb->keys[k]);
+      la->values[la->n + k] = std::move(lb->values[k]);
+    }
+    la->n += lb->n;
+    la->next = lb->next;
+  } else {
+    inner_type* ia = static_cast<inner_type*>(a);
+    inner_type* ib = static_cast<inner_type*>(b);
+    ia->keys[ia->n - 1] = std::move(p->keys[j]);
+    for (int k = 0; k < ib->n - 1; k++) ia->keys[ia->n + k] = std::move(ib->keys[k]);
+    for (int k = 0; k < ib->n; k++) {
+      ia->child[ia->n + k] = ib->child[k];
+      ia->count[ia->n + k] = ib->count[k];
+    }
+    ia->n += ib->n;
+  }
+  p->count[j] += p->count[j + 1];
+  for (int k = j + 1; k < p->n - 1; k++) {
+    p->child[k] = p->child[k + 1];
+    p->count[k] = p->count[k + 1];
+  }
+  for (int k = j; k < p->n - 2; k++) p->keys[k] = std::move(p->keys[k + 1]);
+  p->n--;
+  free_node(b);
+}
+
+// remove_from deletes one key equal to data below n; false if there is none.
+// Equal keys may sit on both sides of a separator equal to them, so every
+// child that can hold one is tried, leftmost first.
+template <class Key, class Value, class Compare, int Width>
+bool BTree<Key, Value, Compare, Width>::remove_from(node_type* n, const Key& data) {
+  if (n->leaf) {
+    leaf_type* l = static_cast<leaf_type*>(n);
+    int pos = below(l->keys, l->n, data);
+    if (pos == l->n || comp(data, l->keys[pos])) return false;
+    note_change(n);
+    for (int k = pos + 1; k < l->n; k++) {
+      l->keys[k - 1] = std::move(l->keys[k]);
+      l->values[k - 1] = std::move(l->values[k]);
+    }
+    l->n--;
+    return true;
+  }
+  inner_type* in = static_cast<inner_type*>(n);
+  for (int i = below(in->keys, in->n - 1, data); i < in->n; i++) {
+    if (remove_from(in->child[i], data)) {
+      note_change(n);
+      in->count[i]--;
+      fix_child(in, i);
+      return true;
+    }
+    if (i == in->n - 1 || comp(data, in->keys[i])) break;  // nothing equal further right
+  }
+  return false;
+}
+
+template <class Key, class Value, class Compare, int Width>
+bool BTree<Key, Value, Compare, Width>::remove(const Key& data) {
+  if (root == NULL || !remove_from(root, data)) return false;
+  total--;
+  if (!root->leaf && root->n == 1) {
+    // the root lost its last separator: its only child becomes the root
+    node_type* old = root;
+    root = static_cast<inner_type*>(old)->child[0];
+    free_node(old);
+    note_change(root);
+  } else if (root->leaf && root->n == 0) {
+    free_node(root);
+    root = NULL;
+  }
+  return true;
+}
+
+// ------------------------------------------------------------------ search
+
+template <class Key, class Value, class Compare, int Width>
+bool BTree<Key, Value, Compare, Width>::contains(const Key& data) const {
+  const_iterator it = lower_bound(data);
+  return it != end() && !comp(data, it.key());
+}
+
+template <class Key, class Value, class Compare, int Width>
+typename BTree<Key, Value, Compare, Width>::const_iterator BTree<Key, Value, Compare, Width>::begin() const {
+  if (root == NULL) return end();
+  const node_type* n = root;
+  while (!n->leaf) n = static_cast<const inner_type*>(n)->child[0];
+  return const_iterator(static_cast<const leaf_type*>(n), 0);
+}
+
+template <class Key, class Value, class Compare, int Width>
+typename BTree<Key, Value, Compare, Width>::const_iterator BTree<Key, Value, Compare, Width>::select(int k) const {
+  if (k < 0 || k >= total) return end();
+  const node_type* n = root;
+  while (!n->leaf) {
+    const inner_type* in = static_cast<const inner_type*>(n);
+    int i = 0;
+    while (k >= in->count[i]) {
+      k -= in->count[i];
+      i++;
+    }
+    n = in->child[i];
+  }
+  return const_iterator(static_cast<const leaf_type*>(n), k);
+}
+
+template <class Key, class Value, class Compare, int Width>
+template <class K>
+typename BTree<Key, Value, Compare, Width>::const_iterator BTree<Key, Value, Compare, Width>::lower_bound(
+        const K& data) const {
+  if (root == NULL) return end();
+  const node_type* n = root;
+  while (!n->leaf) {
+    const inner_type* in = static_cast<const inner_type*>(n);
+    n = in->child[below(in->keys, in->n - 1, data)];
+  }
+  const leaf_type* l = static_cast<const leaf_type*>(n);
+  int pos = below(l->keys, l->n, data);
+  if (pos == l->n) return const_iterator(l->next, 0);   // every key here is smaller
+  return const_iterator(l, pos);
+}
+
+template <class Key, class Value, class Compare, int Width>
+template <class K>
+typename BTree<Key, Value, Compare, Width>::const_iterator BTree<Key, Value, Compare, Width>::upper_bound(
+        const K& data) const {
+  if (root == NULL) return end();
+  const node_type* n = root;
+  while (!n->leaf) {
+    const inner_type* in = static_cast<const inner_type*>(n);
+    n = in->child[at_most(in->keys, in->n - 1, data)];
+  }
+  const leaf_type* l = static_cast<const leaf_type*>(n);
+  int pos = at_most(l->keys, l->n, data);
+  if (pos == l->n) return const_iterator(l->next, 0);
+  return const_iterator(l, pos);
+}
+
+// position: one descent counting the keys before data; the children to the
+// left of each step are added from the counts
+template <class Key, class Value, class Compare, int Width>
+template <class K>
+int BTree<Key, Value, Compare, Width>::position(const K& data) const {
+  int less = 0;
+  for (const node_type* n = root; n != NULL;) {
+    if (n->leaf) {
+      const leaf_type* l = static_cast<const leaf_type*>(n);
+      less += below(l->keys, l->n, data);
+      break;
+    }
+    const inner_type* in = static_cast<const inner_type*>(n);
+    int i = below(in->keys, in->n - 1, data);
+    for (int c = 0; c < i; c++) less += in->count[c];
+    n = in->child[i];
+  }
+  return less;
+}
+
+// rank: position, then a second descent counting the keys not after data
+template <class Key, class Value, class Compare, int Width>
+template <class K>
+rb_rank BTree<Key, Value, Compare, Width>::rank(const K& data) const {
+  int less = position(data);
+  int notAfter = 0;
+  for (const node_type* n = root; n != NULL;) {
+    if (n->leaf) {
+      const leaf_type* l = static_cast<const leaf_type*>(n);
+      notAfter += at_most(l->keys, l->n, data);
+      break;
+    }
+    const inner_type* in = static_cast<const inner_type*>(n);
+    int i = at_most(in->keys, in->n - 1, data);
+    for (int c = 0; c < i; c++) notAfter += in->count[c];
+    n = in->child[i];
+  }
+  rb_rank r;
+  r.less = less;
+  r.equal = notAfter - less;
+  r.greater = total - notAfter;
+  return r;
+}
+
+// ------------------------------------------------------------- bulk build
+
+template <class Key, class Value, class Compare, int Width>
+template <class KeyAt, class ValueAt>
+void BTree<Key, Value, Compare, Width>::build_from_sorted(int n, KeyAt key_at, ValueAt value_at) {
+  clear();
+  if (n <= 0) return;
+
+  // leaves: as few as fit n keys, with the keys spread evenly, so every
+  // leaf but a lone root leaf is at least half full
+  int leaves = (n + Width - 1) / Width;
+  vector<node_type*> level;
+  vector<const Key*> firstKey;     // smallest key below each node of level
+  level.reserve((size_t)leaves);
+  firstKey.reserve((size_t)leaves);
+  leaf_type* prev = NULL;
+  int next = 0;
+  for (int j = 0; j < leaves; j++) {
+    leaf_type* l = new_leaf();
+    int take = n / leaves + (j < n % leaves ? 1 : 0);
+    for (int k = 0; k < take; k++, next++) {
+      l->keys[k] = key_at(next);
+      l->values[k] = value_at(next);
+    }
+    l->n = take;
+    if (prev != NULL) prev->next = l;
+    prev = l;
+    level.push_back(l);
+    firstKey.push_back(&l->keys[0]);
+  }
+
+  // inner levels, the same way, until one node is left
+  while (level.size() > 1) {
+    int m = (int)level.size();
+    int parents = (m + Width - 1) / Width;
+    vector<node_type*> up;
+    vector<const Key*> upFirst;
+    up.reserve((size_t)parents);
+    upFirst.reserve((size_t)parents);
+    int c = 0;
+    for (int j = 0; j < parents; j++) {
+      inner_type* in = new_inner();
+      int take = m / parents + (j < m % parents ? 1 : 0);
+      for (int k = 0; k < take; k++, c++) {
+        in->child[k] = level[(size_t)c];
+        in->count[k] = subtree_size(level[(size_t)c]);
+        if (k > 0) in->keys[k - 1] = *firstKey[(size_t)c];
+      }
+      in->n = take;
+      up.push_back(in);
+      upFirst.push_back(firstKey[(size_t)(c - take)]);
+    }
+    level.swap(up);
+    firstKey.swap(upFirst);
+  }
+  root = level[0];
+  total = n;
+}
+
+// ---------------------------------------------------------------- checking
+
+// check_node checks the subtree under n: every key within [lo, hi] (NULL:
+// unbounded), keys in order, fill, counts, and all leaves at one depth
+template <class Key, class Value, class Compare, int Width>
+bool BTree<Key, Value, Compare, Width>::check_node(const node_type* n, const Key* lo, const Key* hi,
+                                                   int depth, int& leaf_depth, int& size) const {
+  if (n != root && n->n < kMin) return false;
+  if (n->n < 1 || n->n > Width) return false;
+  if (n->leaf) {
+    const leaf_type* l = static_cast<const leaf_type*>(n);
+    for (int k = 0; k < l->n; k++) {
+      if (k > 0 && comp(l->keys[k], l->keys[k - 1])) return false;
+      if (lo != NULL && comp(l->keys[k], *lo)) return false;
+      if (hi != NULL && comp(*hi, l->keys[k])) return false;
+    }
+    if (leaf_depth < 0) leaf_depth = depth;
+    if (depth != leaf_depth) return false;
+    size = l->n;
+    return true;
+  }
+  const inner_type* in = static_cast<const inner_type*>(n);
+  if (in->n < 2) return false;
+  size = 0;
+  for (int i = 0; i < in->n; i++) {
+    if (i < in->n - 1) {
+      if (i > 0 && comp(in->keys[i], in->keys[i - 1])) return false;
+      if (lo != NULL && comp(in->keys[i], *lo)) return false;
+      if (hi != NULL && comp(*hi, in->keys[i])) return false;
+    }
+    const Key* clo = i > 0 ? &in->keys[i - 1] : lo;
+    const Key* chi = i < in->n - 1 ? &in->keys[i] : hi;
+    int csize = 0;
+    if (!check_node(in->child[i], clo, chi, depth + 1, leaf_depth, csize)) return false;
+    if (csize != in->count[i]) return false;
+    size += csize;
+  }
+  return true;
+}
+
+template <class Key, class Value, class Compare, int Width>
+bool BTree<Key, Value, Compare, Width>::validate() const {
+  if (root == NULL) return total == 0;
+  int leaf_depth = -1;
+  int size = 0;
+  if (!check_node(root, NULL, NULL, 0, leaf_depth, size) || size != total) return false;
+  // the leaf chain visits every key once, in order
+  int seen = 0;
+  const Key* last = NULL;
+  for (const_iterator it = begin(); it != end(); ++it, seen++) {
+    if (last != NULL && comp(it.key(), *last)) return false;
+    last = &it.key();
+  }
+  return seen == total;
+}
+
+// check_local: the rules that only involve n and its children
+template <class Key, class Value, class Compare, int Width>
+bool BTree<Key, Value, Compare, Width>::check_local(const node_type* n) const {
+  if (n->n < 1 || n->n > Width) return false;
+  if (n != root && n->n < kMin) return false;
+  if (n->leaf) {
+    const leaf_type* l = static_cast<const leaf_type*>(n);
+    for (int k = 1; k < l->n; k++) {
+      if (comp(l->keys[k], l->keys[k - 1])) return false;
+    }
+    // the chain continues in order
+    return l->next == NULL || !comp(l->next->keys[0], l->keys[l->n - 1]);
+  }
+  const inner_type* in = static_cast<const inner_type*>(n);
+  if (in->n < 2) return false;
+  for (int i = 0; i < in->n; i++) {
+    if (i > 0 && i < in->n - 1 && comp(in->keys[i], in->keys[i - 1])) return false;
+    const node_type* c = in->child[i];
+    if (in->count[i] != subtree_size(c)) return false;
+    // the child's own keys lie between the separators around it
+    const Key* ck = c->leaf ? static_cast<const leaf_type*>(c)->keys : static_cast<const inner_type*>(c)->keys;
+    int cn = c->leaf ? c->n : c->n - 1;
+    if (cn > 0 && i > 0 && comp(ck[0], in->keys[i - 1])) return false;
+    if (cn > 0 && i < in->n - 1 && comp(in->keys[i], ck[cn - 1])) return false;
+  }
+  return true;
+}
+
+template <class Key, class Value, class Compare, int Width>
+void BTree<Key, Value, Compare, Width>::track_changes(bool on) {
+  track = on;
+  changed_all = false;
+  changed.clear();
+}
+
+template <class Key, class Value, class Compare, int Width>
+bool BTree<Key, Value, Compare, Width>::validate_changes() {
+  bool ok = true;
+  if (changed_all) {
+    ok = validate();
+  } else {
+    for (size_t i = 0; i < changed.size() && ok; i++) ok = check_local(changed[i]);
+    if (ok && root != NULL) ok = subtree_size(root) == total;
+    if (root == NULL) ok = ok && total == 0;
+  }
+  changed_all = false;
+  changed.clear();
+  return ok;
+}
+
+#endif // BTREE_H__
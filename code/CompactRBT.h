@@ -0,0 +1,758 @@
+#ifndef COMPACT_RBT_H__
+#define COMPACT_RBT_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <utility>
+#include <vector>
+#include "RBT.h"   // rb_no_value, rb_rank, rb_mem_stats
+
+using namespace std;
+
+// CompactRBT is the compact storage mode of RBT: the same red–black tree
+// (same rules, rotations and fix-ups, same ordered multiset with rank,
+// select, bounds and an in-order walk) with a node layout sized for very
+// large trees of small keys.
+//
+// All nodes live in one contiguous array and link to each other by 32-bit
+// index instead of 64-bit pointer. There is no parent link: insert and
+// remove keep the path they walked down on a small stack and run the fix-up
+// off it, and an iterator carries the same kind of stack. The color is the
+// top bit of the left link. For CompactRBT<int> a node is 16 bytes (key,
+// left + color, right, subtree size) against 40 for rb_node<int>.
+//
+// Links are 31-bit, so a tree holds fewer than kNil (2^31 - 1) nodes.
+// Equal keys get one node each, after the keys they tie with, as in
+// RBDuplicates::Nodes; there is no Counted mode. Removing a key with two
+// children moves its successor's key into its slot, so any insert or remove
+// invalidates iterators. Leaderboard uses it through
+// ScoreIndexKind::Compact.
+
+// crb_node is one slot of the node array.
+template <class Key, class Value = rb_no_value>
+struct crb_node {
+  Key data;
+  [[no_unique_address]] Value value;   // takes no room for rb_no_value
+  uint32_t left;    // index of the left child; top bit set = RED
+  uint32_t right;   // index of the right child (next free slot once freed)
+  int size;         // number of keys in the subtree rooted here (self included)
+};
+
+template <class Key, class Value = rb_no_value, class Compare = std::less<Key> >
+class CompactRBT {
+public:
+  typedef crb_node<Key, Value> node_type;
+
+  // the "no node" link; also one more than the largest usable index
+  static const uint32_t kNil = 0x7fffffff;
+  // longest root-to-leaf path: a red–black tree of < 2^31 nodes is at most
+  // 2 log2(n + 1) <= 62 deep
+  static const int kMaxDepth = 64;
+
+  explicit CompactRBT(const Compare& comp = Compare());
+  CompactRBT(const CompactRBT&) = delete;
+  CompactRBT& operator=(const CompactRBT&) = delete;
+
+  // number of keys
+  int size() const { return live; }
+
+  // reserve room for n nodes so the array does not regrow while filling
+  void reserve(int n) { nodes.reserve((size_t)n); }
+
+  // insert_data adds data with its value; equal keys are kept, after the
+  // ones already there. O(log n).
+  void insert_data(const Key& data, const Value& value = Value());
+
+  // remove deletes one key equal to data; false if there is none. O(log n).
+  bool remove(const Key& data);
+
+  bool contains(const Key& data) const;
+
+  // empty the tree and return the node array to the system
+  void clear();
+
+  // build_from_sorted replaces the tree with n keys already in order,
+  // key_at(i) / value_at(i) for i = 0..n-1, in O(n) with no fix-ups. Slot i
+  // holds the i-th key, and the coloring is RBT::build_from_sorted's: the
+  // deepest level RED, everything above it BLACK.
+  template <class KeyAt, class ValueAt>
+  void build_from_sorted(int n, KeyAt key_at, ValueAt value_at);
+  void build_from_sorted(const vector<Key>& sorted_keys);
+
+  // order statistics, same meaning as RBT::rank. K is anything Compare
+  // orders against Key.
+  template <class K>
+  rb_rank rank(const K& data) const;
+
+  // const_iterator walks the keys in order. It keeps the current node on
+  // top of a stack of the ancestors still to visit, so ++ is amortized O(1)
+  // with no parent links; the stack makes it a few hundred bytes. As with
+  // RBT's iterator *it is the node (it->data, it->value). Without parent
+  // links it only moves forward: a std::forward_iterator.
+  class const_iterator {
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef std::forward_iterator_tag iterator_concept;
+    typedef node_type value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const node_type* pointer;
+    typedef const node_type& reference;
+
+    const_iterator() : tree(NULL), depth(0) {}
+    const node_type& operator*() const { return tree->nodes[path[depth - 1]]; }
+    const node_type* operator->() const { return &tree->nodes[path[depth - 1]]; }
+    const Key& key() const { return (*this)->data; }
+    const Value& value() const { return (*this)->value; }
+    const_iterator& operator++() {
+      push_left(tree->right(path[--depth]));
+      return *this;
+    }
+    const_iterator operator++(int) {
+      const_iterator was = *this;
+      ++*this;
+      return was;
+    }
+    bool operator==(const const_iterator& o) const {
+      return depth == o.depth && (depth == 0 || path[depth - 1] == o.path[depth - 1]);
+    }
+    bool operator!=(const const_iterator& o) const { return !(*this == o); }
+
+  private:
+    friend class CompactRBT;
+    explicit const_iterator(const CompactRBT* t) : tree(t), depth(0) {}
+    void push(uint32_t i) { path[depth++] = i; }
+    void push_left(uint32_t i) {
+      for (; i != kNil; i = tree->left(i)) push(i);
+    }
+    const CompactRBT* tree;
+    uint32_t path[kMaxDepth];   // empty at end()
+    int depth;
+  };
+
+  const_iterator begin() const;
+  const_iterator end() const { return const_iterator(); }
+
+  // select: iterator at the k-th smallest key (0-based); end() if out of range
+  const_iterator select(int k) const;
+
+  // successor: the node after n (a node of this tree) in key order, NULL at
+  // the end. Without parent links this is the leftmost node of n's right
+  // subtree or, if n has none, a descent from the root: O(log n), where an
+  // iterator's ++ is amortized O(1). For callers that can only keep a node.
+  // The descent finds n by its key, so n's key must not be repeated.
+  const node_type* successor(const node_type* n) const;
+
+  // lower_bound: the first key not less than data; upper_bound: the first
+  // key greater than data. end() if there is none. O(log n).
+  template <class K>
+  const_iterator lower_bound(const K& data) const;
+  template <class K>
+  const_iterator upper_bound(const K& data) const;
+
+  // verify all red–black invariants, as RBT::validate, plus the subtree
+  // sizes, key order and that every slot is either in the tree or on the
+  // free list.
+  bool validate() const;
+
+  // incremental checking, as BTree::track_changes / validate_changes: the
+  // slots each insert/remove touches (its path, recolored and rotated
+  // nodes) are logged, and validate_changes re-checks just those (size,
+  // red–red and key order against their children) and the root, then
+  // clears the log. Black heights are only checked by the full validate(),
+  // which it falls back to after clear(), build_from_sorted(), turning
+  // tracking on or a log of more than kMaxChanged slots.
+  void track_changes(bool on);
+  bool validate_changes();
+
+  // node memory: the node array, sizeof(node_type) per slot. reserved_bytes
+  // is the array's capacity, free slots included.
+  rb_mem_stats mem_stats() const;
+  static size_t node_bytes() { return sizeof(node_type); }
+
+private:
+  static const uint32_t kRed = 0x80000000u;
+  static const size_t kMaxChanged = 4096;
+
+  vector<node_type> nodes;
+  uint32_t root;        // kNil when empty
+  uint32_t free_head;   // freed slots (size 0), chained through their right link
+  int live;
+  size_t peak;
+  Compare comp;
+  bool track;                 // log touched slots for validate_changes
+  bool changed_all;           // the log overflowed or was never started
+  vector<uint32_t> changed;   // slots touched since the last validate_changes
+
+  uint32_t left(uint32_t i) const { return nodes[i].left & ~kRed; }
+  uint32_t right(uint32_t i) const { return nodes[i].right; }
+  void set_left(uint32_t i, uint32_t c) { nodes[i].left = (nodes[i].left & kRed) | c; }
+  void set_right(uint32_t i, uint32_t c) { nodes[i].right = c; }
+  bool is_red(uint32_t i) const { return i != kNil && (nodes[i].left & kRed) != 0; }
+  void set_red(uint32_t i, bool red) {
+    if (i == kNil) return;
+    note_change(i);
+    nodes[i].left = red ? (nodes[i].left | kRed) : (nodes[i].left & ~kRed);
+  }
+  void note_change(uint32_t i) {
+    if (!track || changed_all) return;
+    if (changed.size() == kMaxChanged) {
+      changed.clear();
+      changed_all = true;
+      return;
+    }
+    changed.push_back(i);
+  }
+  int size_of(uint32_t i) const { return i == kNil ? 0 : nodes[i].size; }
+  void resize(uint32_t i) { nodes[i].size = size_of(left(i)) + size_of(right(i)) + 1; }
+
+  uint32_t new_node(const Key& data, const Value& value);
+  void free_node(uint32_t i);
+  void replace_child(uint32_t parent, uint32_t old_child, uint32_t new_child);
+  void rotate_left(uint32_t x, uint32_t parent);
+  void rotate_right(uint32_t x, uint32_t parent);
+  void remove_fixup(uint32_t x, bool x_left, uint32_t* path, int d);
+  uint32_t link_range(int lo, int hi, int depth, int red_depth);
+
+  template <class K>
+  int count_less(const K& data) const;
+  template <class K>
+  int count_at_most(const K& data) const;
+
+  int check(uint32_t i, const Key* lo, const Key* hi) const;
+  bool check_local(uint32_t i) const;
+};
+
+// ---------------------------------------------------------------- helpers
+
+template <class Key, class Value, class Compare>
+CompactRBT<Key, Value, Compare>::CompactRBT(const Compare& c)
+  : nodes(), root(kNil), free_head(kNil), live(0), peak(0), comp(c), track(false), changed_all(false) {}
+
+// new_node takes a freed slot first, else appends to the array. The node is
+// built before it goes in, so data may refer into the array itself.
+template <class Key, class Value, class Compare>
+uint32_t CompactRBT<Key, Value, Compare>::new_node(const Key& data, const Value& value) {
+  node_type n = {data, value, kRed | kNil, kNil, 1};
+  uint32_t i;
+  if (free_head != kNil) {
+    i = free_head;
+    free_head = nodes[i].right;
+    nodes[i] = std::move(n);
+  } else {
+    i = (uint32_t)nodes.size();
+    nodes.push_back(std::move(n));
+  }
+  live++;
+  if ((size_t)live > peak) peak = (size_t)live;
+  return i;
+}
+
+// free_node drops the slot's key (releasing anything it owns) and puts the
+// slot on the free list.
+template <class Key, class Value, class Compare>
+void CompactRBT<Key, Value, Compare>::free_node(uint32_t i) {
+  nodes[i].data = Key();
+  nodes[i].value = Value();
+  nodes[i].size = 0;   // live slots have size >= 1
+  nodes[i].right = free_head;
+  free_head = i;
+  live--;
+}
+
+// replace_child points parent's link to old_child at new_child instead; a
+// parent of kNil means old_child was the root.
+template <class Key, class Value, class Compare>
+void CompactRBT<Key, Value, Compare>::replace_child(uint32_t parent, uint32_t old_child,
+                                                    uint32_t new_child) {
+  if (parent == kNil) root = new_child;
+  else if (left(parent) == old_child) set_left(parent, new_child);
+  else set_right(parent, new_child);
+}
+
+// rotations as in RBT, with the parent passed in instead of read off the
+// node. Subtree sizes of the two nodes that move are recomputed.
+template <class Key, class Value, class Compare>
+void CompactRBT<Key, Value, Compare>::rotate_left(uint32_t x, uint32_t parent) {
+  uint32_t y = right(x);
+  note_change(x);
+  note_change(y);
+  set_right(x, left(y));
+  set_left(y, x);
+  replace_child(parent, x, y);
+  nodes[y].size = nodes[x].size;
+  resize(x);
+}
+
+template <class Key, class Value, class Compare>
+void CompactRBT<Key, Value, Compare>::rotate_right(uint32_t x, uint32_t parent) {
+  uint32_t y = left(x);
+  note_change(x);
+  note_change(y);
+  set_left(x, right(y));
+  set_right(y, x);
+  replace_child(parent, x, y);
+  nodes[y].size = nodes[x].size;
+  resize(x);
+}
+
+template <class Key, class Value, class Compare>
+void CompactRBT<Key, Value, Compare>::clear() {
+  vector<node_type>().swap(nodes);
+  root = kNil;
+  free_head = kNil;
+  live = 0;
+  changed.clear();
+  changed_all = true;
+}
+
+template <class Key, class Value, class Compare>
+rb_mem_stats CompactRBT<Key, Value, Compare>::mem_stats() const {
+  rb_mem_stats s;
+  s.live_nodes = (size_t)live;
+  s.peak_nodes = peak;
+  s.live_bytes = (size_t)live * sizeof(node_type);
+  s.peak_bytes = peak * sizeof(node_type);
+  s.reserved_bytes = nodes.capacity() * sizeof(node_type);
+  return s;
+}
+
+// ----------------------------------------------------------------- insert
+
+// insert_data: BST insert recording the path, then the usual red–black
+// fix-up, with each node's parent and grandparent read off the path.
+template <class Key, class Value, class Compare>
+void CompactRBT<Key, Value, Compare>::insert_data(const Key& data, const Value& value) {
+  uint32_t x = new_node(data, value);
+  const Key& key = nodes[x].data;
+  uint32_t path[kMaxDepth];
+  int d = 0;
+  for (uint32_t n = root; n != kNil; n = comp(key, nodes[n].data) ? left(n) : right(n)) {
+    nodes[n].size++;
+    note_change(n);
+    path[d++] = n;
+  }
+  note_change(x);
+  if (d == 0) root = x;
+  else if (comp(key, nodes[path[d - 1]].data)) set_left(path[d - 1], x);
+  else set_right(path[d - 1], x);
+
+  // a red parent is never the root, so the grandparent is on the path
+  while (d >= 2 && is_red(path[d - 1])) {
+    uint32_t p = path[d - 1];
+    uint32_t g = path[d - 2];
+    uint32_t gg = (d >= 3) ? path[d - 3] : kNil;
+    if (p == left(g)) {
+      uint32_t u = right(g);
+      if (is_red(u)) {
+        // red uncle: recolor and continue from the grandparent
+        set_red(p, false);
+        set_red(u, false);
+        set_red(g, true);
+        x = g;
+        d -= 2;
+        continue;
+      }
+      if (x == right(p)) {
+        rotate_left(p, g);
+        std::swap(x, p);
+      }
+      set_red(p, false);
+      set_red(g, true);
+      rotate_right(g, gg);
+    } else {
+      uint32_t u = left(g);
+      if (is_red(u)) {
+        set_red(p, false);
+        set_red(u, false);
+        set_red(g, true);
+        x = g;
+        d -= 2;
+        continue;
+      }
+      if (x == left(p)) {
+        rotate_right(p, g);
+        std::swap(x, p);
+      }
+      set_red(p, false);
+      set_red(g, true);
+      rotate_left(g, gg);
+    }
+    break;
+  }
+  set_red(root, false);
+}
+
+// ----------------------------------------------------------------- remove
+
+// remove: find the key recording the path, unlink it (or, with two
+// children, its successor after moving the successor's key up), then fix a
+// missing black on the path as RBT does.
+template <class Key, class Value, class Compare>
+bool CompactRBT<Key, Value, Compare>::remove(const Key& data) {
+  uint32_t path[kMaxDepth];
+  int d = 0;
+  uint32_t z = root;
+  while (z != kNil) {
+    if (comp(data, nodes[z].data)) {
+      path[d++] = z;
+      z = left(z);
+    } else if (comp(nodes[z].data, data)) {
+      path[d++] = z;
+      z = right(z);
+    } else {
+      break;
+    }
+  }
+  if (z == kNil) return false;
+  for (int i = 0; i < d; i++) {
+    nodes[path[i]].size--;
+    note_change(path[i]);
+  }
+  note_change(z);   // loses a child, or takes its successor's key
+
+  // y is the slot that leaves the tree: z, or z's successor
+  uint32_t y = z;
+  if (left(z) != kNil && right(z) != kNil) {
+    nodes[z].size--;
+    path[d++] = z;
+    y = right(z);
+    while (left(y) != kNil) {
+      nodes[y].size--;
+      note_change(y);
+      path[d++] = y;
+      y = left(y);
+    }
+    nodes[z].data = std::move(nodes[y].data);
+    nodes[z].value = std::move(nodes[y].value);
+  }
+
+  // y has at most one child, x, which takes its place
+  uint32_t x = (left(y) != kNil) ? left(y) : right(y);
+  uint32_t p = (d > 0) ? path[d - 1] : kNil;
+  bool x_left = p != kNil && left(p) == y;
+  replace_child(p, y, x);
+  bool was_black = !is_red(y);
+  free_node(y);
+  if (was_black) remove_fixup(x, x_left, path, d);
+  return true;
+}
+
+// remove_fixup: x (maybe kNil) is one black short; path[0..d) are its
+// ancestors, path[d - 1] its parent, and x_left says which side it is on.
+template <class Key, class Value, class Compare>
+void CompactRBT<Key, Value, Compare>::remove_fixup(uint32_t x, bool x_left, uint32_t* path, int d) {
+  while (x != root && !is_red(x)) {
+    uint32_t p = path[d - 1];
+    if (x_left) {
+      uint32_t w = right(p);
+      if (is_red(w)) {
+        // red sibling: rotate it above p, which keeps p as x's parent
+        set_red(w, false);
+        set_red(p, true);
+        rotate_left(p, (d >= 2) ? path[d - 2] : kNil);
+        path[d - 1] = w;
+        path[d++] = p;
+        w = right(p);
+      }
+      if (!is_red(left(w)) && !is_red(right(w))) {
+        set_red(w, true);
+        x = p;
+        d--;
+        x_left = d > 0 && left(path[d - 1]) == x;
+        continue;
+      }
+      if (!is_red(right(w))) {
+        set_red(left(w), false);
+        set_red(w, true);
+        rotate_right(w, p);
+        w = right(p);
+      }
+      set_red(w, is_red(p));
+      set_red(p, false);
+      set_red(right(w), false);
+      rotate_left(p, (d >= 2) ? path[d - 2] : kNil);
+    } else {
+      uint32_t w = left(p);
+      if (is_red(w)) {
+        set_red(w, false);
+        set_red(p, true);
+        rotate_right(p, (d >= 2) ? path[d - 2] : kNil);
+        path[d - 1] = w;
+        path[d++] = p;
+        w = left(p);
+      }
+      if (!is_red(left(w)) && !is_red(right(w))) {
+        set_red(w, true);
+        x = p;
+        d--;
+        x_left = d > 0 && left(path[d - 1]) == x;
+        continue;
+      }
+      if (!is_red(left(w))) {
+        set_red(right(w), false);
+        set_red(w, true);
+        rotate_left(w, p);
+        w = left(p);
+      }
+      set_red(w, is_red(p));
+      set_red(p, false);
+      set_red(left(w), false);
+      rotate_right(p, (d >= 2) ? path[d - 2] : kNil);
+    }
+    x = root;
+  }
+  set_red(x, false);
+}
+
+template <class Key, class Value, class Compare>
+bool CompactRBT<Key, Value, Compare>::contains(const Key& data) const {
+  uint32_t n = root;
+  while (n != kNil) {
+    if (comp(data, nodes[n].data)) n = left(n);
+    else if (comp(nodes[n].data, data)) n = right(n);
+    else return true;
+  }
+  return false;
+}
+
+// ------------------------------------------------------------ bulk build
+
+template <class Key, class Value, class Compare>
+template <class KeyAt, class ValueAt>
+void CompactRBT<Key, Value, Compare>::build_from_sorted(int n, KeyAt key_at, ValueAt value_at) {
+  clear();
+  if (n <= 0) return;
+  nodes.reserve((size_t)n);
+  for (int i = 0; i < n; i++) {
+    node_type node = {key_at(i), value_at(i), kNil, kNil, 1};
+    nodes.push_back(std::move(node));
+  }
+  live = n;
+  if ((size_t)n > peak) peak = (size_t)n;
+
+  int h = 0;   // floor(log2 n): depth of the deepest level
+  while ((2LL << h) <= n) h++;
+  // a single node is the root and must stay black
+  root = link_range(0, n - 1, 0, (h > 0) ? h : -1);
+}
+
+template <class Key, class Value, class Compare>
+void CompactRBT<Key, Value, Compare>::build_from_sorted(const vector<Key>& sorted_keys) {
+  build_from_sorted((int)sorted_keys.size(),
+                    [&sorted_keys](int i) -> const Key& { return sorted_keys[(size_t)i]; },
+                    [](int) { return Value(); });
+}
+
+// link_range makes slots lo..hi a balanced subtree around the middle slot
+// and returns it.
+template <class Key, class Value, class Compare>
+uint32_t CompactRBT<Key, Value, Compare>::link_range(int lo, int hi, int depth, int red_depth) {
+  if (lo > hi) return kNil;
+  int mid = lo + (hi - lo) / 2;
+  uint32_t m = (uint32_t)mid;
+  nodes[m].left = link_range(lo, mid - 1, depth + 1, red_depth);
+  nodes[m].right = link_range(mid + 1, hi, depth + 1, red_depth);
+  nodes[m].size = hi - lo + 1;
+  set_red(m, depth == red_depth);
+  return m;
+}
+
+// ------------------------------------------------------- order statistics
+
+template <class Key, class Value, class Compare>
+template <class K>
+int CompactRBT<Key, Value, Compare>::count_less(const K& data) const {
+  int c = 0;
+  uint32_t n = root;
+  while (n != kNil) {
+    if (comp(nodes[n].data, data)) {
+      c += size_of(left(n)) + 1;
+      n = right(n);
+    } else {
+      n = left(n);
+    }
+  }
+  return c;
+}
+
+template <class Key, class Value, class Compare>
+template <class K>
+int CompactRBT<Key, Value, Compare>::count_at_most(const K& data) const {
+  int c = 0;
+  uint32_t n = root;
+  while (n != kNil) {
+    if (comp(data, nodes[n].data)) {
+      n = left(n);
+    } else {
+      c += size_of(left(n)) + 1;
+      n = right(n);
+    }
+  }
+  return c;
+}
+
+template <class Key, class Value, class Compare>
+template <class K>
+rb_rank CompactRBT<Key, Value, Compare>::rank(const K& data) const {
+  rb_rank r;
+  r.less = count_less(data);
+  int at_most = count_at_most(data);
+  r.equal = at_most - r.less;
+  r.greater = live - at_most;
+  return r;
+}
+
+// ------------------------------------------------------------- iteration
+// Every descent pushes the nodes it leaves to the left: those are exactly
+// the ancestors still to be visited, nearest on top.
+
+template <class Key, class Value, class Compare>
+typename CompactRBT<Key, Value, Compare>::const_iterator CompactRBT<Key, Value, Compare>::begin() const {
+  const_iterator it(this);
+  it.push_left(root);
+  return it;
+}
+
+template <class Key, class Value, class Compare>
+typename CompactRBT<Key, Value, Compare>::const_iterator CompactRBT<Key, Value, Compare>::select(int k) const {
+  const_iterator it(this);
+  if (k < 0 || k >= live) return end();
+  uint32_t n = root;
+  while (true) {
+    int ls = size_of(left(n));
+    if (k < ls) {
+      it.push(n);
+      n = left(n);
+    } else if (k == ls) {
+      it.push(n);
+      return it;
+    } else {
+      k -= ls + 1;
+      n = right(n);
+    }
+  }
+}
+
+template <class Key, class Value, class Compare>
+template <class K>
+typename CompactRBT<Key, Value, Compare>::const_iterator CompactRBT<Key, Value, Compare>::lower_bound(
+        const K& data) const {
+  const_iterator it(this);
+  for (uint32_t n = root; n != kNil;) {
+    if (comp(nodes[n].data, data)) {
+      n = right(n);
+    } else {
+      it.push(n);
+      n = left(n);
+    }
+  }
+  return it.depth == 0 ? end() : it;
+}
+
+template <class Key, class Value, class Compare>
+template <class K>
+typename CompactRBT<Key, Value, Compare>::const_iterator CompactRBT<Key, Value, Compare>::upper_bound(
+        const K& data) const {
+  const_iterator it(this);
+  for (uint32_t n = root; n != kNil;) {
+    if (comp(data, nodes[n].data)) {
+      it.push(n);
+      n = left(n);
+    } else {
+      n = right(n);
+    }
+  }
+  return it.depth == 0 ? end() : it;
+}
+
+template <class Key, class Value, class Compare>
+const typename CompactRBT<Key, Value, Compare>::node_type* CompactRBT<Key, Value, Compare>::successor(
+        const node_type* n) const {
+  uint32_t i = (uint32_t)(n - nodes.data());
+  uint32_t next = kNil;
+  if (right(i) != kNil) {
+    for (next = right(i); left(next) != kNil;) next = left(next);
+  } else {
+    // the last node we leave to the left on the way down to n's key
+    for (uint32_t a = root; a != i && a != kNil;) {
+      if (comp(n->data, nodes[a].data)) {
+        next = a;
+        a = left(a);
+      } else {
+        a = right(a);
+      }
+    }
+  }
+  return next == kNil ? NULL : &nodes[next];
+}
+
+// ------------------------------------------------------------- validation
+
+// check returns the black height below i (kNil = 1), or -1 if the subtree
+// breaks a rule: keys outside [lo, hi], a red node with a red child, unequal
+// black heights or a wrong size.
+template <class Key, class Value, class Compare>
+int CompactRBT<Key, Value, Compare>::check(uint32_t i, const Key* lo, const Key* hi) const {
+  if (i == kNil) return 1;
+  if (i >= nodes.size()) return -1;
+  const node_type& n = nodes[i];
+  if (lo != NULL && comp(n.data, *lo)) return -1;
+  if (hi != NULL && comp(*hi, n.data)) return -1;
+  if (is_red(i) && (is_red(left(i)) || is_red(right(i)))) return -1;
+  if (n.size != size_of(left(i)) + size_of(right(i)) + 1) return -1;
+  int lh = check(left(i), lo, &n.data);
+  int rh = check(right(i), &n.data, hi);
+  if (lh < 0 || rh < 0 || lh != rh) return -1;
+  return lh + (is_red(i) ? 0 : 1);
+}
+
+template <class Key, class Value, class Compare>
+bool CompactRBT<Key, Value, Compare>::validate() const {
+  if (is_red(root)) return false;
+  if (check(root, NULL, NULL) < 0 || size_of(root) != live) return false;
+  // every slot is either live or on the free list
+  size_t freed = 0;
+  for (uint32_t f = free_head; f != kNil; f = nodes[f].right) {
+    if (f >= nodes.size() || ++freed > nodes.size()) return false;
+  }
+  return (size_t)live + freed == nodes.size();
+}
+
+template <class Key, class Value, class Compare>
+void CompactRBT<Key, Value, Compare>::track_changes(bool on) {
+  track = on;
+  changed.clear();
+  changed_all = true;   // changes made while off were not logged
+}
+
+// check_local: one live slot against its children
+template <class Key, class Value, class Compare>
+bool CompactRBT<Key, Value, Compare>::check_local(uint32_t i) const {
+  if (i >= nodes.size()) return false;
+  if (nodes[i].size == 0) return true;   // freed since it was logged
+  uint32_t l = left(i);
+  uint32_t r = right(i);
+  if (nodes[i].size != size_of(l) + size_of(r) + 1) return false;
+  if (is_red(i) && (is_red(l) || is_red(r))) return false;
+  if (l != kNil && comp(nodes[i].data, nodes[l].data)) return false;
+  if (r != kNil && comp(nodes[r].data, nodes[i].data)) return false;
+  return true;
+}
+
+template <class Key, class Value, class Compare>
+bool CompactRBT<Key, Value, Compare>::validate_changes() {
+  bool ok = true;
+  if (changed_all) {
+    ok = validate();
+  } else {
+    for (size_t i = 0; i < changed.size() && ok; i++) ok = check_local(changed[i]);
+    ok = ok && !is_red(root) && size_of(root) == live;
+  }
+  changed_all = false;
+  changed.clear();
+  return ok;
+}
+
+#endif // COMPACT_RBT_H__
@@ -0,0 +1,317 @@
+#include "Journal.h"
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+using namespace std;
+
+static const char kMagic[8] = {'R', 'B', 'T', 'L', 'B', 'J', 'N', 'L'};
+static const uint32_t kVersion = 1;
+static const size_t kHeaderBytes = 16;   // magic, version, reserved
+static const size_t kFrameHeader = 8;    // payload bytes, CRC-32
+static const uint32_t kMaxFrame = 1u << 30;
+
+// ------------------------------------------------------------- encoding
+
+// crc32 is the common (zlib) CRC-32, table driven
+static uint32_t crc32(const char* p, size_t n) {
+  static uint32_t table[256];
+  static once_flag built;
+  call_once(built, []() {
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; k++) c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+      table[i] = c;
+    }
+  });
+  uint32_t c = 0xffffffffu;
+  for (size_t i = 0; i < n; i++) c = table[(c ^ (unsigned char)p[i]) & 0xff] ^ (c >> 8);
+  return c ^ 0xffffffffu;
+}
+
+static void put_varint(vector<char>& out, uint32_t v) {
+  while (v >= 0x80) {
+    out.push_back((char)(v | 0x80));
+    v >>= 7;
+  }
+  out.push_back((char)v);
+}
+
+static bool get_varint(const char*& p, const char* end, uint32_t& v) {
+  v = 0;
+  for (int shift = 0; shift < 35 && p < end; shift += 7) {
+    unsigned char b = (unsigned char)*p++;
+    v |= (uint32_t)(b & 0x7f) << shift;
+    if ((b & 0x80) == 0) return true;
+  }
+  return false;
+}
+
+// zigzag keeps small negative scores short too
+static uint32_t zigzag(int v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+static int unzigzag(uint32_t v) { return (int)(v >> 1) ^ -(int)(v & 1); }
+
+static void encode_update(vector<char>& out, const string& name, int score) {
+  out.push_back((char)JournalRecord::Update);
+  put_varint(out, (uint32_t)name.size());
+  put_varint(out, zigzag(score));
+  out.insert(out.end(), name.begin(), name.end());
+}
+
+// decode_frame calls fn for each record of one frame's payload
+static bool decode_frame(const char* p, const char* end, const function<void(const JournalRecord&)>& fn,
+                         size_t& count) {
+  JournalRecord r;
+  while (p < end) {
+    r.kind = (JournalRecord::Kind)(unsigned char)*p++;
+    if (r.kind == JournalRecord::Clear) {
+      r.name.clear();
+      r.score = 0;
+    } else if (r.kind == JournalRecord::Update) {
+      uint32_t len = 0;
+      uint32_t score = 0;
+      if (!get_varint(p, end, len) || !get_varint(p, end, score) || len > (size_t)(end - p)) return false;
+      r.name.assign(p, len);
+      r.score = unzigzag(score);
+      p += len;
+    } else {
+      return false;
+    }
+    if (fn) fn(r);
+    count++;
+  }
+  return true;
+}
+
+static bool read_full(int fd, void* buf, size_t n, off_t at) {
+  char* b = (char*)buf;
+  while (n > 0) {
+    ssize_t got = pread(fd, b, n, at);
+    if (got <= 0) return false;
+    b += got;
+    at += got;
+    n -= (size_t)got;
+  }
+  return true;
+}
+
+static bool write_full(int fd, const char* p, size_t n) {
+  while (n > 0) {
+    ssize_t put = ::write(fd, p, n);
+    if (put <= 0) return false;
+    p += put;
+    n -= (size_t)put;
+  }
+  return true;
+}
+
+// scan_frames walks the whole frames after the header, calling fn for their
+// records, and returns the offset just past the last good frame
+static off_t scan_frames(int fd, off_t fileBytes, const function<void(const JournalRecord&)>& fn,
+                         size_t& count) {
+  off_t at = (off_t)kHeaderBytes;
+  vector<char> payload;
+  while (at + (off_t)kFrameHeader <= fileBytes) {
+    uint32_t head[2];
+    if (!read_full(fd, head, sizeof(head), at)) break;
+    if (head[0] == 0 || head[0] > kMaxFrame || at + (off_t)kFrameHeader + head[0] > fileBytes) break;
+    payload.resize(head[0]);
+    if (!read_full(fd, payload.data(), head[0], at + (off_t)kFrameHeader)) break;
+    if (crc32(payload.data(), payload.size()) != head[1]) break;
+    size_t frameRecords = 0;
+    if (!decode_frame(payload.data(), payload.data() + payload.size(), fn, frameRecords)) break;
+    count += frameRecords;
+    at += (off_t)kFrameHeader + head[0];
+  }
+  return at;
+}
+
+// ----------------------------------------------------------------- open
+
+Journal::Journal(const string& path, const JournalOptions& options)
+  : opts(options), fd(-1), appended(0), durable(0), handled(0), flushWanted(0), stopping(false), writeFailed(false) {
+  counters.records = 0;
+  counters.bytes = 0;
+  counters.frames = 0;
+
+  int f = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+  if (f < 0) return;
+  struct stat st;
+  if (fstat(f, &st) != 0) {
+    close(f);
+    return;
+  }
+  char header[kHeaderBytes];
+  memset(header, 0, sizeof(header));
+  memcpy(header, kMagic, sizeof(kMagic));
+  memcpy(header + 8, &kVersion, sizeof(kVersion));
+  if ((size_t)st.st_size < kHeaderBytes) {
+    // new (or never finished) journal: start over with a fresh header
+    if (ftruncate(f, 0) != 0 || !write_full(f, header, sizeof(header)) || fdatasync(f) != 0) {
+      close(f);
+      return;
+    }
+  } else {
+    char have[kHeaderBytes];
+    if (!read_full(f, have, sizeof(have), 0) || memcmp(have, header, 12) != 0) {
+      close(f);  // not a journal, or another version: leave it alone
+      return;
+    }
+    size_t records = 0;
+    off_t end = scan_frames(f, (off_t)st.st_size, function<void(const JournalRecord&)>(), records);
+    if (end != (off_t)st.st_size && (ftruncate(f, end) != 0 || fdatasync(f) != 0)) {
+      close(f);
+      return;
+    }
+  }
+  if (lseek(f, 0, SEEK_END) < 0) {
+    close(f);
+    return;
+  }
+  fd = f;
+  flusher = thread(&Journal::flushLoop, this);
+}
+
+Journal::~Journal() {
+  if (fd < 0) return;
+  {
+    lock_guard<mutex> lock(mu);
+    stopping = true;
+  }
+  wake.notify_one();
+  flusher.join();   // the flusher writes out what is pending before it exits
+  close(fd);
+}
+
+// --------------------------------------------------------------- append
+
+uint64_t Journal::appendUpdate(const string& name, int score) {
+  if (fd < 0) return 0;
+  lock_guard<mutex> lock(mu);
+  bool wasEmpty = pending.empty();
+  if (wasEmpty) pending.resize(kFrameHeader);  // filled in by writeFrame
+  encode_update(pending, name, score);
+  counters.records++;
+  if (wasEmpty) wake.notify_one();  // start a window
+  return ++appended;
+}
+
+uint64_t Journal::appendClear() {
+  if (fd < 0) return 0;
+  lock_guard<mutex> lock(mu);
+  bool wasEmpty = pending.empty();
+  if (wasEmpty) pending.resize(kFrameHeader);
+  pending.push_back((char)JournalRecord::Clear);
+  counters.records++;
+  if (wasEmpty) wake.notify_one();
+  return ++appended;
+}
+
+bool Journal::waitDurable(uint64_t seq) {
+  if (fd < 0) return false;
+  // the window is not cut short: records from other threads that arrive
+  // meanwhile share the same frame and sync
+  unique_lock<mutex> lock(mu);
+  synced.wait(lock, [this, seq]() { return handled >= seq; });
+  return durable >= seq;
+}
+
+bool Journal::flush() {
+  if (fd < 0) return false;
+  unique_lock<mutex> lock(mu);
+  uint64_t seq = appended;
+  if (handled >= seq) return durable >= seq;
+  flushWanted = seq;
+  wake.notify_one();
+  synced.wait(lock, [this, seq]() { return handled >= seq; });
+  return durable >= seq;
+}
+
+bool Journal::failed() const {
+  lock_guard<mutex> lock(mu);
+  return writeFailed;
+}
+
+// flushLoop runs on the flusher thread: wait for records, give the window
+// a chance to collect more, then write and sync them as one frame
+void Journal::flushLoop() {
+  unique_lock<mutex> lock(mu);
+  vector<char> frame;
+  while (true) {
+    wake.wait(lock, [this]() { return stopping || !pending.empty(); });
+    if (pending.empty()) break;  // stopping with nothing left
+    if (opts.commitWindow.count() > 0 && !stopping && flushWanted <= handled) {
+      wake.wait_for(lock, opts.commitWindow, [this]() { return stopping || flushWanted > handled; });
+    }
+    frame.swap(pending);
+    pending.clear();
+    uint64_t upto = appended;
+    lock.unlock();
+
+    bool ok = writeFrame(frame);  // appenders keep queueing meanwhile
+
+    lock.lock();
+    if (ok) {
+      counters.bytes += frame.size();
+      counters.frames++;
+    } else {
+      // the frame's records are dropped rather than retried forever; later
+      // frames are still written, but with a gap behind them nothing counts
+      // as durable until a checkpoint (truncate) covers the lost records
+      writeFailed = true;
+    }
+    if (!writeFailed) durable = upto;
+    handled = upto;
+    synced.notify_all();
+  }
+}
+
+// frame starts with kFrameHeader reserved bytes, followed by the records.
+// A failed frame is cut off again, so a torn frame never sits in front of
+// the frames written after it (opening the journal stops at the first one)
+bool Journal::writeFrame(vector<char>& frame) {
+  uint32_t head[2];
+  head[0] = (uint32_t)(frame.size() - kFrameHeader);
+  head[1] = crc32(frame.data() + kFrameHeader, head[0]);
+  memcpy(frame.data(), head, sizeof(head));
+  off_t start = lseek(fd, 0, SEEK_CUR);
+  if (start < 0) return false;
+  if (write_full(fd, frame.data(), frame.size()) && (!opts.sync || fdatasync(fd) == 0)) return true;
+  if (ftruncate(fd, start) != 0) {
+    // keep appending after whatever landed; replay stops at the torn frame
+    lseek(fd, 0, SEEK_END);
+    return false;
+  }
+  lseek(fd, start, SEEK_SET);
+  return false;
+}
+
+// --------------------------------------------------------- replay, reset
+
+size_t Journal::replay(const function<void(const JournalRecord&)>& fn) const {
+  if (fd < 0) return 0;
+  struct stat st;
+  if (fstat(fd, &st) != 0) return 0;
+  size_t records = 0;
+  scan_frames(fd, (off_t)st.st_size, fn, records);
+  return records;
+}
+
+bool Journal::truncate() {
+  if (fd < 0) return false;
+  flush();
+  // holding mu with nothing pending keeps the flusher idle while we cut
+  lock_guard<mutex> lock(mu);
+  if (!pending.empty()) return false;  // records arrived after the checkpoint
+  if (ftruncate(fd, (off_t)kHeaderBytes) != 0 || lseek(fd, 0, SEEK_END) < 0) return false;
+  if (opts.sync && fdatasync(fd) != 0) return false;
+  // the checkpoint holds every record appended so far, lost ones included
+  writeFailed = false;
+  durable = handled;
+  return true;
+}
+
+JournalStats Journal::stats() const {
+  lock_guard<mutex> lock(mu);
+  return counters;
+}
@@ -0,0 +1,130 @@
+#ifndef JOURNAL_H__
+#define JOURNAL_H__
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Journal is an append-only write-ahead log of leaderboard updates.
+//
+// Records are small binary entries (a kind byte, the name length and the
+// score as varints, then the name bytes), so a typical update costs well
+// under 20 bytes. A background thread writes whatever records have piled up
+// as one frame and syncs it with a single fdatasync: every append that
+// arrives within the group-commit window shares that sync.
+//
+// File layout: a 16-byte header (magic, version), then frames of
+// [u32 payload bytes][u32 CRC-32 of the payload][records], in native byte
+// order (a journal is read back on the machine that wrote it). A frame torn by a
+// crash fails its length or CRC check; opening the journal cuts the file
+// back to the last whole frame, so recovery never replays half a batch.
+//
+// Records hold absolute scores, so replaying a journal on top of a
+// checkpoint that already contains some of its records gives the same board.
+
+// one logged change
+struct JournalRecord {
+  enum Kind { Update = 1, Clear = 2 };
+  Kind kind;      // Update: name now has score. Clear: the board was emptied.
+  string name;
+  int score;
+};
+
+struct JournalOptions {
+  // group-commit window: after the first pending record the flusher waits
+  // this long for more before writing and syncing them together. Zero
+  // syncs as soon as the previous sync is done.
+  chrono::microseconds commitWindow = chrono::microseconds(2000);
+
+  // waitDurable: writers (Leaderboard::addOrUpdate, ...) return only once
+  // their record is synced. Otherwise they return as soon as it is queued,
+  // and an update can be lost if the process dies within one window of it.
+  bool waitDurable = false;
+
+  // sync: call fdatasync after each frame. Off only makes sense for tests
+  // and benchmarks on scratch files.
+  bool sync = true;
+};
+
+// counters since the journal was opened
+struct JournalStats {
+  uint64_t records;      // records appended
+  uint64_t bytes;        // bytes written, frame headers included
+  uint64_t frames;       // frames written (one write + one sync each)
+};
+
+class Journal {
+public:
+  // open path for appending, creating it if needed. An existing journal is
+  // checked frame by frame and cut back to its last whole frame.
+  explicit Journal(const string& path, const JournalOptions& options = JournalOptions());
+  ~Journal();  // writes out pending records and stops the flusher
+
+  Journal(const Journal&) = delete;
+  Journal& operator=(const Journal&) = delete;
+
+  // false if the file could not be opened or is not a journal
+  bool isOpen() const { return fd >= 0; }
+
+  // append queues one record and returns its sequence number (1, 2, ...).
+  // They never wait for the disk; see waitDurable.
+  uint64_t appendUpdate(const string& name, int score);
+  uint64_t appendClear();
+
+  // waitDurable blocks until record seq has been written out and returns
+  // whether it (and every record before it) is synced. False once a frame
+  // failed to write: its records are lost, see failed.
+  bool waitDurable(uint64_t seq);
+
+  // flush writes and syncs every record appended so far; false as for
+  // waitDurable.
+  bool flush();
+
+  // failed: a frame could not be written or synced since the journal was
+  // opened or last truncated. The frame is cut off and later records are
+  // still written, but none of them count as durable until a checkpoint
+  // (Leaderboard::compactJournal) has captured the lost ones.
+  bool failed() const;
+
+  // replay calls fn for every record in the file, in order, and returns the
+  // number of records. Call it before appending (e.g. at startup).
+  size_t replay(const function<void(const JournalRecord&)>& fn) const;
+
+  // truncate drops every record (after a checkpoint has captured them) and
+  // clears failed.
+  bool truncate();
+
+  JournalStats stats() const;
+
+  // options.waitDurable: whether writers should call waitDurable
+  bool waitsForDurability() const { return opts.waitDurable; }
+
+private:
+  JournalOptions opts;
+  int fd;
+
+  mutable mutex mu;
+  condition_variable wake;      // flusher: records pending, flush or stop asked
+  condition_variable synced;    // appenders: handled moved forward
+  vector<char> pending;         // encoded records not yet written
+  uint64_t appended;            // sequence number of the last appended record
+  uint64_t durable;             // sequence number of the last synced record
+  uint64_t handled;             // ... of the last record written or dropped
+  uint64_t flushWanted;         // flush() is waiting for this sequence number
+  bool stopping;
+  bool writeFailed;             // sticky until truncate; see failed()
+  JournalStats counters;
+  thread flusher;
+
+  void flushLoop();
+  bool writeFrame(vector<char>& frame);
+};
+
+#endif // JOURNAL_H__
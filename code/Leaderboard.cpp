@@ -1,122 +1,1128 @@
 #include "Leaderboard.h"
 #include <iostream>
-#include <algorithm>  // std::sort
+#include <algorithm>  // std::sort for unsorted bulk input
+#include <cmath>      // std::ceil for scoreAtPercentile
+#include <climits>    // INT_MIN for splitTier
 using namespace std;
 
-Leaderboard::Leaderboard() : players(), tree() {}
+Leaderboard::Leaderboard()
+  : opts(), players(), tree(ScoreIndex::create(opts.scoreIndex)), scores(greater<int>(), RBDuplicates::Counted), index(), current(),
+    journal(NULL), updatesOk(true) {}
 
-// Find index by name using a simple loop
-int Leaderboard::findIndexByName(const string& name) const {
-  for (size_t i = 0; i < players.size(); i++) {
-    if (players[i].name == name) {
-      return (int)i;
-    }
+Leaderboard::Leaderboard(const LeaderboardOptions& options)
+  : opts(options), players(), tree(ScoreIndex::create(options.scoreIndex)), scores(greater<int>(), RBDuplicates::Counted), index(), current(),
+    journal(NULL), updatesOk(true) {
+  if (opts.checkUpdates) {
+    tree->track_changes(true);
+    scores.track_changes(true);
+  }
+  if (opts.topRows > 0) {
+    top = make_shared<vector<Player> >();
+    top->reserve((size_t)opts.topRows + 1);
   }
-  return -1;
+  if (opts.approxRankError > 0) approx = make_unique<ApproxRank>(opts.approxRankError);
 }
 
-// Simple comparator: higher score first. If equal, keep relative order (no need for stable_sort here).
-static bool score_desc(const Player& a, const Player& b) {
-  if (a.score > b.score) return true;
-  if (a.score < b.score) return false;
-  return false;
+shared_lock<shared_mutex> Leaderboard::readLock() const {
+  if (opts.concurrent) return shared_lock<shared_mutex>(mu);
+  return shared_lock<shared_mutex>();
+}
+
+unique_lock<shared_mutex> Leaderboard::writeLock() {
+  if (opts.concurrent) return unique_lock<shared_mutex>(mu);
+  return unique_lock<shared_mutex>();
 }
 
-vector<Player> Leaderboard::sortedDesc() const {
-  vector<Player> copy = players;               // work on a copy
-  sort(copy.begin(), copy.end(), score_desc);  // highest score first
-  return copy;
+// Find index by name through the hash index; names are compared against players
+int Leaderboard::findIndexByName(const string& name) const {
+  return index.find(name, [this](int slot) -> const string& {
+    return players[(size_t)slot].name;
+  });
+}
+
+// make_key builds the tree key for a player
+static ScoreKey make_key(int score, const string& name) {
+  ScoreKey k;
+  k.score = score;
+  k.name = name;
+  return k;
 }
 
 void Leaderboard::addOrUpdate(const string& name, int score) {
-  int idx = findIndexByName(name);
+  // build the key (and its string copy) before taking the lock, so the
+  // exclusive section only does index and tree work
+  ScoreKey key = make_key(score, name);
+  unique_lock<shared_mutex> lock = writeLock();
+  if (mapped) materialize();
+  uint64_t seq = 0;
+
+  // one probe finds an existing player or reserves the next slot for a new one
+  int idx = index.find_or_insert(name, (int)players.size(), [this](int s) -> const string& {
+    return players[(size_t)s].name;
+  });
   if (idx >= 0) {
     int old = players[(size_t)idx].score;
     if (old != score) {
       // update player record
       players[(size_t)idx].score = score;
-      // update RBT multiset: remove one occurrence of old, insert one of new
-      tree.remove(old);
-      tree.insert_data(score);
+      scoreColumn[(size_t)idx] = score;
+      // move the player's key: remove (old, name), insert (new, name)
+      key.score = old;
+      tree->remove(key);
+      if (opts.snapshots) current.remove(key);
+      key.score = score;
+      if (opts.snapshots) current.insert(key, idx);
+      tree->insert(key, idx);
+      scores.remove(old);
+      scores.insert_data(score);
+      updateTop(key, true, old);
+      if (approx) {
+        approx->remove(old);
+        approx->add(score);
+      }
+      if (journal) seq = journal->appendUpdate(name, score);
     }
   } else {
-    // new player → push to vector and insert score into RBT
+    // new player (already indexed) → push to vector and insert score into RBT
     Player p;
     p.name = name;
     p.score = score;
+    if (opts.snapshots) current.insert(key, (int)players.size());
+    tree->insert(key, (int)players.size());
+    scores.insert_data(score);
     players.push_back(p);
-    tree.insert_data(score);
+    scoreColumn.push_back(score);
+    updateTop(key, false, 0);
+    if (approx) approx->add(score);
+    if (journal) seq = journal->appendUpdate(name, score);
+  }
+  if (approx && approx->stale()) rebuildApprox();
+  checkChanges();
+  waitForJournal(lock, journal, seq);
+}
+
+void Leaderboard::checkChanges() {
+  if (!opts.checkUpdates) return;
+  // both logs are emptied, even when the first check fails
+  bool treeOk = tree->validate_changes();
+  bool scoresOk = scores.validate_changes();
+  if (!treeOk || !scoresOk) updatesOk = false;
+}
+
+bool Leaderboard::updatesValid() const {
+  shared_lock<shared_mutex> lock = readLock();
+  return updatesOk;
+}
+
+// logged writers release the board before waiting for the disk, so other
+// writers can add their records to the same group commit
+void Leaderboard::waitForJournal(unique_lock<shared_mutex>& lock, Journal* j, uint64_t seq) {
+  if (j == NULL || seq == 0 || !j->waitsForDurability()) return;
+  if (lock.owns_lock()) lock.unlock();
+  j->waitDurable(seq);
+}
+
+// leaderboard_before is ScoreOrder on two player rows (no key copies)
+static bool leaderboard_before(const Player& a, const Player& b) {
+  if (a.score != b.score) return a.score > b.score;
+  return a.name < b.name;
+}
+
+// the same order between a row and a (score, name) pair
+static bool leaderboard_before(const Player& a, int score, const string& name) {
+  if (a.score != score) return a.score > score;
+  return a.name < name;
+}
+static bool leaderboard_before(int score, const string& name, const Player& b) {
+  if (score != b.score) return score > b.score;
+  return name < b.name;
+}
+
+vector<Player>& Leaderboard::topForWrite() {
+  // A list a TopKView may hold is never changed: writers switch to a copy.
+  // Shared boards always copy, since a reader on another thread can drop
+  // its view at any moment and use_count() gives no ordering with its reads.
+  if (opts.concurrent || top.use_count() > 1) {
+    shared_ptr<vector<Player> > copy = make_shared<vector<Player> >();
+    copy->reserve((size_t)opts.topRows + 1);
+    copy->assign(top->begin(), top->end());
+    top = copy;
+  }
+  return *top;
+}
+
+void Leaderboard::updateTop(const ScoreKey& key, bool hadScore, int oldScore) {
+  if (!top) return;
+  size_t cap = (size_t)opts.topRows;
+  size_t want = min(cap, players.size());
+  const vector<Player>& now = *top;
+  // the old row is listed iff it does not come after the last listed row;
+  // the new one belongs in the list iff it comes before that row
+  bool oldIn = hadScore && !now.empty() && !leaderboard_before(now.back(), oldScore, key.name);
+  bool newIn = !now.empty() && leaderboard_before(key.score, key.name, now.back());
+  if (!oldIn && !newIn && now.size() >= want) return;  // the common case
+
+  vector<Player>& rows = topForWrite();
+  if (oldIn) {
+    vector<Player>::iterator at = lower_bound(rows.begin(), rows.end(), key.name,
+        [oldScore](const Player& p, const string& name) { return leaderboard_before(p, oldScore, name); });
+    rows.erase(at);
+  }
+  // rows is now a prefix of the board without the moved player, so the
+  // player goes in if it sorts before the last row, and any shortfall is
+  // made up from the rows that follow the last one in the tree
+  if (!rows.empty() && leaderboard_before(key.score, key.name, rows.back())) {
+    vector<Player>::iterator at = lower_bound(rows.begin(), rows.end(), key.name,
+        [&key](const Player& p, const string& name) { return leaderboard_before(p, key.score, name); });
+    Player p;
+    p.name = key.name;
+    p.score = key.score;
+    rows.insert(at, p);
+    if (rows.size() > cap) rows.pop_back();
+  }
+  if (rows.size() < want) {
+    // the last row is on the board: start right after it
+    int from = rows.empty() ? 0 : tree->position(make_key(rows.back().score, rows.back().name)) + 1;
+    for (ScoreCursor c = tree->seek(from); rows.size() < want && c.node != NULL; tree->next(c)) {
+      Player p;
+      p.name = tree->key(c).name;
+      p.score = tree->key(c).score;
+      rows.push_back(p);
+    }
+  }
+}
+
+void Leaderboard::copyTop(size_t k, vector<Player>& out) const {
+  out.clear();
+  if (mapped) {
+    for (size_t i = 0; i < k && i < mapped->size(); i++) {
+      Player p;
+      p.name = string(mapped->nameAt(i));
+      p.score = mapped->scoreAt(i);
+      out.push_back(p);
+    }
+    return;
+  }
+  for (ScoreCursor c = tree->seek(0); out.size() < k && c.node != NULL; tree->next(c)) {
+    Player p;
+    p.name = tree->key(c).name;
+    p.score = tree->key(c).score;
+    out.push_back(p);
+  }
+}
+
+void Leaderboard::rebuildTop() {
+  if (!top) return;
+  copyTop((size_t)opts.topRows, topForWrite());
+}
+
+void Leaderboard::rebuildApprox() {
+  if (!approx) return;
+  approx->rebuild(playerCount(),
+      [this](int pos) { return mapped ? mapped->scoreAt((size_t)pos) : tree->key(tree->seek(pos)).score; },
+      [this](int score, int& above, int& tied) { countAroundLocked(score, above, tied); });
+}
+
+TopKView Leaderboard::topK(int k) const {
+  shared_lock<shared_mutex> lock = readLock();
+  if (k <= 0) return TopKView();
+  if (top && k <= opts.topRows) {
+    return TopKView(top, min((size_t)k, top->size()));
+  }
+  shared_ptr<vector<Player> > rows = make_shared<vector<Player> >();
+  copyTop((size_t)k, *rows);
+  return TopKView(rows, rows->size());
+}
+
+// batch_order coalesces a batch: its positions ordered by name, keeping
+// batch order within a name, so the last write for each player is the last
+// entry of its run
+static vector<int> batch_order(span<const pair<string, int> > updates) {
+  vector<int> order(updates.size());
+  for (size_t i = 0; i < order.size(); i++) order[i] = (int)i;
+  stable_sort(order.begin(), order.end(), [&updates](int a, int b) {
+    return updates[(size_t)a].first < updates[(size_t)b].first;
+  });
+  return order;
+}
+
+int Leaderboard::applyBatch(span<const pair<string, int> > updates) {
+  vector<int> order = batch_order(updates);  // before taking the lock
+  unique_lock<shared_mutex> lock = writeLock();
+  vector<ScoreKey> additions;
+  applyBatchLocked(updates, order, additions);
+  uint64_t seq = 0;
+  for (size_t i = 0; journal != NULL && i < additions.size(); i++) {
+    seq = journal->appendUpdate(additions[i].name, additions[i].score);
+  }
+  waitForJournal(lock, journal, seq);
+  return (int)additions.size();
+}
+
+void Leaderboard::applyBatchLocked(span<const pair<string, int> > updates, const vector<int>& order,
+                                   vector<ScoreKey>& additions) {
+  if (mapped) materialize();
+
+  vector<ScoreKey> removals;   // old keys of players whose score changes
+  vector<int> slots;           // slot for additions[i]
+  for (size_t i = 0; i < order.size(); i++) {
+    if (i + 1 < order.size() &&
+        updates[(size_t)order[i + 1]].first == updates[(size_t)order[i]].first) {
+      continue;  // a later write for the same player follows
+    }
+    const string& name = updates[(size_t)order[i]].first;
+    int score = updates[(size_t)order[i]].second;
+    int idx = index.find_or_insert(name, (int)players.size(), [this](int s) -> const string& {
+      return players[(size_t)s].name;
+    });
+    if (idx >= 0) {
+      int old = players[(size_t)idx].score;
+      if (old == score) continue;  // no-op
+      removals.push_back(make_key(old, name));
+      players[(size_t)idx].score = score;
+      scoreColumn[(size_t)idx] = score;
+    } else {
+      Player p;
+      p.name = name;
+      p.score = score;
+      idx = (int)players.size();
+      players.push_back(p);
+      scoreColumn.push_back(score);
+    }
+    additions.push_back(make_key(score, name));
+    slots.push_back(idx);
+  }
+
+  // net tree work, each pass in leaderboard order
+  ScoreOrder before;
+  sort(removals.begin(), removals.end(), before);
+  for (size_t i = 0; i < removals.size(); i++) {
+    tree->remove(removals[i]);
+    scores.remove(removals[i].score);
+    if (opts.snapshots) current.remove(removals[i]);
+  }
+  vector<int> addOrder(additions.size());
+  for (size_t i = 0; i < addOrder.size(); i++) addOrder[i] = (int)i;
+  sort(addOrder.begin(), addOrder.end(), [&additions, &before](int a, int b) {
+    return before(additions[(size_t)a], additions[(size_t)b]);
+  });
+  for (size_t i = 0; i < addOrder.size(); i++) {
+    tree->insert(additions[(size_t)addOrder[i]], slots[(size_t)addOrder[i]]);
+    scores.insert_data(additions[(size_t)addOrder[i]].score);
+    if (opts.snapshots) current.insert(additions[(size_t)addOrder[i]], slots[(size_t)addOrder[i]]);
+  }
+  // the histogram follows each net change, as in addOrUpdate
+  for (size_t i = 0; approx && i < removals.size(); i++) approx->remove(removals[i].score);
+  for (size_t i = 0; approx && i < additions.size(); i++) approx->add(additions[i].score);
+  if (approx && approx->stale()) rebuildApprox();
+  if (batchTouchesTop(removals, additions)) rebuildTop();
+  checkChanges();
+}
+
+bool Leaderboard::batchTouchesTop(const vector<ScoreKey>& removals, const vector<ScoreKey>& additions) const {
+  if (!top || additions.empty()) return false;
+  const vector<Player>& now = *top;
+  if (now.size() < min((size_t)opts.topRows, players.size()) || now.empty()) return true;
+  // an old key that was listed, or a new one that sorts before the last row
+  for (size_t i = 0; i < removals.size(); i++) {
+    if (!leaderboard_before(now.back(), removals[i].score, removals[i].name)) return true;
+  }
+  for (size_t i = 0; i < additions.size(); i++) {
+    if (leaderboard_before(additions[i].score, additions[i].name, now.back())) return true;
+  }
+  return false;
+}
+
+void Leaderboard::bulkLoad(const vector<Player>& rows) {
+  unique_lock<shared_mutex> lock = writeLock();
+  mapped.reset();
+  loadRows(rows);
+  checkChanges();
+  // the journal sees the whole replacement: clear, then the loaded rows
+  waitForJournal(lock, journal, logAll());
+}
+
+uint64_t Leaderboard::logAll() {
+  if (journal == NULL) return 0;
+  uint64_t seq = journal->appendClear();
+  for (size_t i = 0; i < players.size(); i++) {
+    seq = journal->appendUpdate(players[i].name, players[i].score);
+  }
+  return seq;
+}
+
+void Leaderboard::writeLockPair(Leaderboard& other, unique_lock<shared_mutex>& mine,
+                                unique_lock<shared_mutex>& theirs) {
+  if (this < &other) {
+    mine = writeLock();
+    theirs = other.writeLock();
+  } else {
+    theirs = other.writeLock();
+    mine = writeLock();
+  }
+}
+
+void Leaderboard::rebuildCurrent() {
+  if (!opts.snapshots) return;
+  vector<ScoreKey> keys;
+  vector<int> slots;
+  keys.reserve(players.size());
+  slots.reserve(players.size());
+  for (ScoreCursor c = tree->seek(0); c.node != NULL; tree->next(c)) {
+    keys.push_back(tree->key(c));
+    slots.push_back(tree->slot(c));
+  }
+  current.build_from_sorted((int)keys.size(), [&keys](int i) { return keys[(size_t)i]; },
+                            [&slots](int i) { return slots[(size_t)i]; });
+}
+
+int Leaderboard::mergeFrom(Leaderboard& other) {
+  if (&other == this) return 0;
+  unique_lock<shared_mutex> lock;
+  unique_lock<shared_mutex> otherLock;
+  writeLockPair(other, lock, otherLock);
+  if (mapped) materialize();
+  if (other.mapped) other.materialize();
+
+  // slot of each of other's players on this board; a player on both boards
+  // drops the lower of its two keys before the trees are united
+  vector<int> to(other.players.size());
+  vector<ScoreKey> removals;   // this board's keys that other outscores
+  vector<ScoreKey> losers;     // other's keys that this board outscores (or ties)
+  vector<ScoreKey> additions;  // the keys that come over
+  for (size_t j = 0; j < other.players.size(); j++) {
+    const Player& p = other.players[j];
+    int idx = index.find_or_insert(p.name, (int)players.size(), [this](int s) -> const string& {
+      return players[(size_t)s].name;
+    });
+    if (idx >= 0) {
+      to[j] = idx;
+      int old = players[(size_t)idx].score;
+      if (p.score <= old) {
+        losers.push_back(make_key(p.score, p.name));
+        continue;
+      }
+      removals.push_back(make_key(old, p.name));
+      players[(size_t)idx].score = p.score;
+      scoreColumn[(size_t)idx] = p.score;
+    } else {
+      to[j] = (int)players.size();
+      players.push_back(p);
+      scoreColumn.push_back(p.score);
+    }
+    additions.push_back(make_key(p.score, p.name));
+  }
+
+  ScoreOrder before;
+  sort(removals.begin(), removals.end(), before);
+  sort(losers.begin(), losers.end(), before);
+  for (size_t i = 0; i < removals.size(); i++) {
+    tree->remove(removals[i]);
+    scores.remove(removals[i].score);
+    if (opts.snapshots) current.remove(removals[i]);
+  }
+  for (size_t i = 0; i < losers.size(); i++) {
+    other.tree->remove(losers[i]);
+    other.scores.remove(losers[i].score);
+  }
+  other.tree->renumber(to);
+  tree->unite(*other.tree);
+  scores.unite(other.scores);   // Counted: the players on a shared score add up
+
+  sort(additions.begin(), additions.end(), before);
+  for (size_t i = 0; opts.snapshots && i < additions.size(); i++) {
+    current.insert(additions[i], findIndexByName(additions[i].name));
   }
+  for (size_t i = 0; approx && i < removals.size(); i++) approx->remove(removals[i].score);
+  for (size_t i = 0; approx && i < additions.size(); i++) approx->add(additions[i].score);
+  if (approx && approx->stale()) rebuildApprox();
+  if (batchTouchesTop(removals, additions)) rebuildTop();
+  checkChanges();
+
+  // other's trees are empty now; this resets the rest of it
+  other.loadRows(vector<Player>());
+  other.checkChanges();
+
+  uint64_t seq = 0;
+  for (size_t i = 0; journal != NULL && i < additions.size(); i++) {
+    seq = journal->appendUpdate(additions[i].name, additions[i].score);
+  }
+  uint64_t otherSeq = other.logAll();
+  Journal* otherJournal = other.journal;
+  other.waitForJournal(otherLock, otherJournal, otherSeq);
+  waitForJournal(lock, journal, seq);
+  return (int)additions.size();
+}
+
+int Leaderboard::splitTier(int minScore, Leaderboard& tier) {
+  if (&tier == this) return 0;
+  unique_lock<shared_mutex> lock;
+  unique_lock<shared_mutex> tierLock;
+  writeLockPair(tier, lock, tierLock);
+  if (mapped) materialize();
+  tier.mapped.reset();
+
+  // cut the index and the counts: tree and scores keep minScore and up,
+  // rest and low take the others (all of them for INT_MIN)
+  unique_ptr<ScoreIndex> rest = ScoreIndex::create(opts.scoreIndex);
+  ScoreCounts low(greater<int>(), RBDuplicates::Counted);
+  if (minScore > INT_MIN) {
+    tree->split_at(minScore - 1, *rest);
+    scores.split_at(minScore - 1, low);
+  }
+
+  // the tier's players in leaderboard order, the rest in slot order; to
+  // maps each old slot to its new one on whichever board it went to
+  vector<int> to(players.size());
+  vector<char> moved(players.size(), 0);
+  vector<Player> tierRows;
+  tierRows.reserve((size_t)tree->size());
+  for (ScoreCursor c = tree->seek(0); c.node != NULL; tree->next(c)) {
+    int slot = tree->slot(c);
+    to[(size_t)slot] = (int)tierRows.size();
+    moved[(size_t)slot] = 1;
+    tierRows.push_back(players[(size_t)slot]);
+  }
+  vector<Player> keep;
+  keep.reserve(players.size() - tierRows.size());
+  for (size_t i = 0; i < players.size(); i++) {
+    if (moved[i]) continue;
+    to[i] = (int)keep.size();
+    keep.push_back(players[i]);
+  }
+  tree->renumber(to);
+  rest->renumber(to);
+
+  // hand the cut pieces over: the tier takes tree and scores, this board
+  // keeps rest and low
+  if (tier.opts.scoreIndex == opts.scoreIndex) {
+    tier.tree = std::move(tree);
+  } else {
+    tier.tree->clear();
+    tier.tree->unite(*tree);
+  }
+  tree = std::move(rest);
+  tree->track_changes(opts.checkUpdates);
+  tier.tree->track_changes(tier.opts.checkUpdates);
+  tier.scores.swap(scores);
+  scores.swap(low);   // low now holds the tier's old counts, freed below
+
+  players.swap(keep);
+  tier.players.swap(tierRows);
+  Leaderboard* boards[2] = {this, &tier};
+  for (Leaderboard* b : boards) {
+    b->index.clear();
+    b->index.reserve(b->players.size());
+    b->scoreColumn.resize(b->players.size());
+    for (size_t i = 0; i < b->players.size(); i++) {
+      b->index.insert(b->players[i].name, (int)i);
+      b->scoreColumn[i] = b->players[i].score;
+    }
+    b->rebuildCurrent();
+    b->rebuildTop();
+    b->rebuildApprox();
+    b->checkChanges();
+  }
+
+  uint64_t seq = logAll();
+  uint64_t tierSeq = tier.logAll();
+  Journal* tierJournal = tier.journal;
+  tier.waitForJournal(tierLock, tierJournal, tierSeq);
+  waitForJournal(lock, journal, seq);
+  return (int)tier.players.size();
+}
+
+void Leaderboard::loadRows(const vector<Player>& rows) {
+  players.clear();
+  index.clear();
+  players.reserve(rows.size());
+  index.reserve(rows.size());
+
+  // one slot per distinct name; a repeated name overwrites the earlier score
+  bool inOrder = true;
+  auto name_at = [this](int s) -> const string& { return players[(size_t)s].name; };
+  for (size_t i = 0; i < rows.size(); i++) {
+    int slot = index.find_or_insert(rows[i].name, (int)players.size(), name_at);
+    if (slot >= 0) {
+      players[(size_t)slot].score = rows[i].score;
+      inOrder = false;  // the overwritten slot may now be out of place
+      continue;
+    }
+    if (!players.empty() && !leaderboard_before(players.back(), rows[i])) {
+      inOrder = false;
+    }
+    players.push_back(rows[i]);
+  }
+  scoreColumn.resize(players.size());
+  for (size_t i = 0; i < players.size(); i++) scoreColumn[i] = players[i].score;
+
+  // order[i] = slot of the i-th player in leaderboard order
+  vector<int> order(players.size());
+  for (size_t i = 0; i < order.size(); i++) order[i] = (int)i;
+  if (!inOrder) {
+    const vector<Player>& ps = players;
+    sort(order.begin(), order.end(), [&ps](int a, int b) {
+      return leaderboard_before(ps[(size_t)a], ps[(size_t)b]);
+    });
+  }
+
+  tree->build_from_sorted((int)order.size(),
+      [this, &order](int i) { return make_key(players[(size_t)order[(size_t)i]].score,
+                                              players[(size_t)order[(size_t)i]].name); },
+      [&order](int i) { return order[(size_t)i]; });
+  // equal scores are adjacent in leaderboard order, so each run becomes one node
+  scores.build_from_sorted((int)order.size(),
+      [this, &order](int i) { return players[(size_t)order[(size_t)i]].score; },
+      [](int) { return rb_no_value(); });
+  if (opts.snapshots) {
+    current.build_from_sorted((int)order.size(),
+        [this, &order](int i) { return make_key(players[(size_t)order[(size_t)i]].score,
+                                                players[(size_t)order[(size_t)i]].name); },
+        [&order](int i) { return order[(size_t)i]; });
+  }
+  rebuildTop();
+  rebuildApprox();
 }
 
 bool Leaderboard::getScore(const string& name, int& outScore) const {
+  shared_lock<shared_mutex> lock = readLock();
+  if (mapped) {
+    long row = mapped->find(name);
+    if (row < 0) return false;
+    outScore = mapped->scoreAt((size_t)row);
+    return true;
+  }
   int idx = findIndexByName(name);
   if (idx < 0) return false;
   outScore = players[(size_t)idx].score;
   return true;
 }
 
+// the tree is already in leaderboard order: walk it inorder, no copy or sort
 void Leaderboard::printAll() const {
-  vector<Player> s = sortedDesc();
+  if (opts.snapshots) {
+    // print a frozen version so writers are not held up by the output
+    LeaderboardSnapshot snap = snapshot();
+    cout << "=== Leaderboard (highest first) ===\n";
+    int pos = 1;
+    for (LeaderboardSnapshot::const_iterator it = snap.begin(); it != snap.end(); ++it) {
+      cout << pos << ". " << it->data.name << " : " << it->data.score << "\n";
+      pos++;
+    }
+    return;
+  }
+  shared_lock<shared_mutex> lock = readLock();
   cout << "=== Leaderboard (highest first) ===\n";
-  for (size_t i = 0; i < s.size(); i++) {
-    cout << (i + 1) << ". " << s[i].name << " : " << s[i].score << "\n";
+  if (mapped) {
+    for (size_t i = 0; i < mapped->size(); i++) {
+      cout << (i + 1) << ". " << mapped->nameAt(i) << " : " << mapped->scoreAt(i) << "\n";
+    }
+    return;
+  }
+  int pos = 1;
+  for (ScoreCursor c = tree->seek(0); c.node != NULL; tree->next(c)) {
+    cout << pos << ". " << tree->key(c).name << " : " << tree->key(c).score << "\n";
+    pos++;
   }
 }
 
 bool Leaderboard::validateTree() const {
-  return tree.validate();
+  shared_lock<shared_mutex> lock = readLock();
+  if (mapped) return mapped->verify();  // checksum, row order and score runs
+  // the score counts must describe the same players as the tree
+  return tree->validate() && scores.validate() &&
+         scores.size(scores.get_root()) == tree->size();
+}
+
+rb_mem_stats Leaderboard::treeMemory() const {
+  shared_lock<shared_mutex> lock = readLock();
+  return tree->mem_stats();
 }
 
 bool Leaderboard::computeRank(const string& name, RankInfo& outInfo) const {
+  shared_lock<shared_mutex> lock = readLock();
+  if (mapped) {
+    // the row is the position; ties come from the file's score runs
+    long row = mapped->find(name);
+    if (row < 0) return false;
+    int above = 0;
+    int tied = 0;
+    outInfo.score = mapped->scoreAt((size_t)row);
+    mapped->rankOf(outInfo.score, above, tied);
+    outInfo.rank = above + 1;
+    outInfo.sameScoreCount = tied;
+    outInfo.totalPlayers = (int)mapped->size();
+    return true;
+  }
   int idx = findIndexByName(name);
   if (idx < 0) return false;  // player not found
 
   int sc = players[(size_t)idx].score;
 
-  // Compute rank with simple counting: how many strictly greater + count ties
-  int greater = 0;
-  int ties = 0;
-  for (size_t i = 0; i < players.size(); i++) {
-    if (players[i].score > sc) {
-      greater = greater + 1;
-    } else if (players[i].score == sc) {
-      ties = ties + 1;
-    }
-  }
+  // One descent of the distinct-score tree: the counts of the higher scores
+  // add up to the players above (less), and the tie count is read off the
+  // score's own node (equal). O(log d) for d distinct scores.
+  rb_rank r = scores.rank(sc);
 
   outInfo.score = sc;
-  outInfo.rank = greater + 1;          // 1-based rank
-  outInfo.sameScoreCount = ties;       // includes self
+  outInfo.rank = r.less + 1;           // 1-based rank
+  outInfo.sameScoreCount = r.equal;    // includes self
   outInfo.totalPlayers = (int)players.size();
   return true;
 }
 
 vector<Player> Leaderboard::neighborsAround(const string& name, int halfWindow) const {
+  shared_lock<shared_mutex> lock = readLock();
   vector<Player> out;
-  if (players.empty()) return out;
-
-  // Get a descending view and find the position of "name"
-  vector<Player> s = sortedDesc();
-
-  int pos = -1;
-  for (size_t i = 0; i < s.size(); i++) {
-    if (s[i].name == name) {
-      pos = (int)i;
-      break;
+  if (mapped) {
+    long row = mapped->find(name);
+    if (row < 0) return out;
+    long first = row - halfWindow < 0 ? 0 : row - halfWindow;
+    long last = row + halfWindow;
+    if (last >= (long)mapped->size()) last = (long)mapped->size() - 1;
+    for (long i = first; i <= last; i++) {
+      Player p;
+      p.name = string(mapped->nameAt((size_t)i));
+      p.score = mapped->scoreAt((size_t)i);
+      out.push_back(p);
     }
+    return out;
   }
-  if (pos < 0) return out; // not found in the sorted view (shouldn't happen)
+  int idx = findIndexByName(name);
+  if (idx < 0) return out;
+
+  // the player's position in leaderboard order is the number of keys before it
+  int pos = tree->position(make_key(players[(size_t)idx].score, name));
 
   // Compute window bounds safely
   int start = pos - halfWindow;
   if (start < 0) start = 0;
   int end = pos + halfWindow;
-  if (end >= (int)s.size()) end = (int)s.size() - 1;
+  int total = tree->size();
+  if (end >= total) end = total - 1;
+
+  if (opts.snapshots) {
+    // copy the version and walk it after dropping the lock
+    LeaderboardSnapshot snap(current);
+    lock = shared_lock<shared_mutex>();
+    return snap.rows(start, end - start + 1);
+  }
+
+  // jump to the first row, then walk inorder: O(log n + window)
+  ScoreCursor c = tree->seek(start);
+  for (int i = start; i <= end && c.node != NULL; i++, tree->next(c)) {
+    Player row;
+    row.name = tree->key(c).name;
+    row.score = tree->key(c).score;
+    out.push_back(row);
+  }
+  return out;
+}
+
+int Leaderboard::countInRange(int lo, int hi) const {
+  shared_lock<shared_mutex> lock = readLock();
+  return countLocked(lo, hi);
+}
+
+int Leaderboard::countLocked(int lo, int hi) const {
+  if (lo > hi) return 0;
+  // players scoring >= lo, minus the ones scoring above hi
+  int aboveHi = 0;
+  int above = 0;
+  int tied = 0;
+  countAroundLocked(hi, aboveHi, tied);
+  countAroundLocked(lo, above, tied);
+  return above + tied - aboveHi;
+}
+
+void Leaderboard::countAround(int score, int& above, int& tied) const {
+  shared_lock<shared_mutex> lock = readLock();
+  countAroundLocked(score, above, tied);
+}
+
+int Leaderboard::scanCountAbove(int score) const {
+  shared_lock<shared_mutex> lock = readLock();
+  if (mapped) {
+    int above = 0;
+    int tied = 0;
+    countAroundLocked(score, above, tied);
+    return above;
+  }
+  return (int)scan_count_greater(scoreColumn.data(), scoreColumn.size(), score);
+}
+
+int Leaderboard::scanCountTied(int score) const {
+  shared_lock<shared_mutex> lock = readLock();
+  if (mapped) {
+    int above = 0;
+    int tied = 0;
+    countAroundLocked(score, above, tied);
+    return tied;
+  }
+  return (int)scan_count_equal(scoreColumn.data(), scoreColumn.size(), score);
+}
+
+int Leaderboard::scanCountInRange(int lo, int hi) const {
+  shared_lock<shared_mutex> lock = readLock();
+  if (mapped) return countLocked(lo, hi);
+  return (int)scan_count_in_range(scoreColumn.data(), scoreColumn.size(), lo, hi);
+}
 
-  // Collect that window
-  for (int i = start; i <= end; i++) {
-    out.push_back(s[(size_t)i]);
+bool Leaderboard::scanMinMax(int& outMin, int& outMax) const {
+  shared_lock<shared_mutex> lock = readLock();
+  if (mapped) {
+    // rows are in leaderboard order: the first is the highest
+    if (mapped->size() == 0) return false;
+    outMax = mapped->scoreAt(0);
+    outMin = mapped->scoreAt(mapped->size() - 1);
+    return true;
+  }
+  int32_t lo = 0;
+  int32_t hi = 0;
+  if (!scan_min_max(scoreColumn.data(), scoreColumn.size(), lo, hi)) return false;
+  outMin = lo;
+  outMax = hi;
+  return true;
+}
+
+int Leaderboard::size() const {
+  shared_lock<shared_mutex> lock = readLock();
+  return playerCount();
+}
+
+vector<Player> Leaderboard::rows(int start, int count) const {
+  shared_lock<shared_mutex> lock = readLock();
+  vector<Player> out;
+  if (start < 0) {
+    count += start;
+    start = 0;
+  }
+  if (count <= 0) return out;
+  out.reserve((size_t)min(count, max(playerCount() - start, 0)));
+  if (mapped) {
+    for (size_t i = (size_t)start; i < mapped->size() && (int)out.size() < count; i++) {
+      Player p;
+      p.name = string(mapped->nameAt(i));
+      p.score = mapped->scoreAt(i);
+      out.push_back(p);
+    }
+    return out;
+  }
+  for (ScoreCursor c = tree->seek(start); c.node != NULL && (int)out.size() < count; tree->next(c)) {
+    Player p;
+    p.name = tree->key(c).name;
+    p.score = tree->key(c).score;
+    out.push_back(p);
   }
   return out;
-}
\ No newline at end of file
+}
+
+void Leaderboard::countAroundLocked(int score, int& above, int& tied) const {
+  if (mapped) {
+    mapped->rankOf(score, above, tied);
+    return;
+  }
+  rb_rank r = scores.rank(score);
+  above = r.less;
+  tied = r.equal;
+}
+
+int Leaderboard::playerCount() const {
+  return mapped ? (int)mapped->size() : (int)players.size();
+}
+
+bool Leaderboard::percentileOf(const string& name, double& outPercentile) const {
+  shared_lock<shared_mutex> lock = readLock();
+  int score = 0;
+  if (mapped) {
+    long row = mapped->find(name);
+    if (row < 0) return false;
+    score = mapped->scoreAt((size_t)row);
+  } else {
+    int idx = findIndexByName(name);
+    if (idx < 0) return false;
+    score = players[(size_t)idx].score;
+  }
+  int above = 0;
+  int tied = 0;
+  countAroundLocked(score, above, tied);
+  int total = playerCount();
+  int below = total - above - tied;
+  outPercentile = 100.0 * ((double)below + 0.5 * (double)tied) / (double)total;
+  return true;
+}
+
+bool Leaderboard::scoreLocked(const string& name, int& outScore) const {
+  if (mapped) {
+    long row = mapped->find(name);
+    if (row < 0) return false;
+    outScore = mapped->scoreAt((size_t)row);
+    return true;
+  }
+  int idx = findIndexByName(name);
+  if (idx < 0) return false;
+  outScore = players[(size_t)idx].score;
+  return true;
+}
+
+bool Leaderboard::approxRankOf(const string& name, int& outRank) const {
+  shared_lock<shared_mutex> lock = readLock();
+  int score = 0;
+  if (!scoreLocked(name, score)) return false;
+  if (approx) {
+    outRank = approx->above(score) + 1;
+    return true;
+  }
+  int above = 0;
+  int tied = 0;
+  countAroundLocked(score, above, tied);
+  outRank = above + 1;
+  return true;
+}
+
+bool Leaderboard::approxPercentileOf(const string& name, double& outPercentile) const {
+  if (!approx) return percentileOf(name, outPercentile);
+  shared_lock<shared_mutex> lock = readLock();
+  int score = 0;
+  if (!scoreLocked(name, score)) return false;
+  outPercentile = approx->percentile(score);
+  return true;
+}
+
+bool Leaderboard::scoreAtPercentile(double p, int& outScore) const {
+  shared_lock<shared_mutex> lock = readLock();
+  int total = playerCount();
+  if (total == 0) return false;
+  if (p < 0) p = 0;
+  if (p > 100) p = 100;
+  // nearest rank: the r-th lowest score, r = ceil(p% of the board), at
+  // least 1; the board is highest first, so that is position total - r
+  int r = (int)ceil(p / 100.0 * (double)total);
+  if (r < 1) r = 1;
+  if (r > total) r = total;
+  int pos = total - r;
+  if (mapped) {
+    outScore = mapped->scoreAt((size_t)pos);
+    return true;
+  }
+  outScore = tree->key(tree->seek(pos)).score;
+  return true;
+}
+
+vector<int> Leaderboard::histogram(span<const int> bucketEdges) const {
+  shared_lock<shared_mutex> lock = readLock();
+  vector<int> out;
+  if (bucketEdges.size() < 2) return out;
+  out.reserve(bucketEdges.size() - 1);
+  // atLeast = players scoring >= the current edge; each bucket is the
+  // difference between two neighbouring edges
+  int above = 0;
+  int tied = 0;
+  countAroundLocked(bucketEdges[0], above, tied);
+  int atLeast = above + tied;
+  for (size_t i = 1; i < bucketEdges.size(); i++) {
+    countAroundLocked(bucketEdges[i], above, tied);
+    int next = above + tied;
+    out.push_back(bucketEdges[i] > bucketEdges[i - 1] ? atLeast - next : 0);
+    atLeast = next;
+  }
+  return out;
+}
+
+vector<Player> Leaderboard::playersInRange(int lo, int hi, int limit) const {
+  shared_lock<shared_mutex> lock = readLock();
+  vector<Player> out;
+  if (lo > hi || limit == 0) return out;
+  if (mapped) {
+    // rows are in order: the range is one run of rows after the ones above hi
+    int above = 0;
+    int tied = 0;
+    mapped->rankOf(hi, above, tied);
+    for (size_t i = (size_t)above; i < mapped->size() && mapped->scoreAt(i) >= lo; i++) {
+      if (limit >= 0 && (int)out.size() >= limit) break;
+      Player p;
+      p.name = string(mapped->nameAt(i));
+      p.score = mapped->scoreAt(i);
+      out.push_back(p);
+    }
+    return out;
+  }
+
+  if (opts.snapshots) {
+    // the range is rows [above hi, above hi + count); copy the version and
+    // walk it after dropping the lock
+    int start = scores.rank(hi).less;
+    int count = countLocked(lo, hi);
+    if (limit >= 0 && limit < count) count = limit;
+    LeaderboardSnapshot snap(current);
+    lock = shared_lock<shared_mutex>();
+    return snap.rows(start, count);
+  }
+
+  // the first key with score <= hi comes after everyone scoring above hi;
+  // walk inorder from there until the score drops below lo
+  for (ScoreCursor c = tree->seek(scores.rank(hi).less); c.node != NULL; tree->next(c)) {
+    const ScoreKey& k = tree->key(c);
+    if (k.score < lo) break;
+    if (limit >= 0 && (int)out.size() >= limit) break;
+    Player row;
+    row.name = k.name;
+    row.score = k.score;
+    out.push_back(row);
+  }
+  return out;
+}
+
+LeaderboardSnapshot Leaderboard::snapshot() const {
+  shared_lock<shared_mutex> lock = readLock();
+  if (mapped) {
+    // mapped rows are already in order; slots are the row numbers
+    ScoreVersion v;
+    v.build_from_sorted((int)mapped->size(),
+        [this](int i) { return make_key(mapped->scoreAt((size_t)i), string(mapped->nameAt((size_t)i))); },
+        [](int i) { return i; });
+    return LeaderboardSnapshot(v);
+  }
+  if (opts.snapshots) return LeaderboardSnapshot(current);  // O(1): share the root
+
+  // no persistent tree kept: build one from the tree in O(n)
+  vector<ScoreCursor> rows;
+  rows.reserve((size_t)tree->size());
+  for (ScoreCursor c = tree->seek(0); c.node != NULL; tree->next(c)) rows.push_back(c);
+  ScoreVersion v;
+  v.build_from_sorted((int)rows.size(),
+      [this, &rows](int i) { return tree->key(rows[(size_t)i]); },
+      [this, &rows](int i) { return tree->slot(rows[(size_t)i]); });
+  return LeaderboardSnapshot(v);
+}
+
+vector<Player> LeaderboardSnapshot::rows(int start, int count) const {
+  vector<Player> out;
+  if (start < 0) {
+    count += start;
+    start = 0;
+  }
+  if (count <= 0) return out;
+  int i = 0;
+  for (const_iterator it = at(start); it != end() && i < count; ++it, i++) {
+    Player row;
+    row.name = it->data.name;
+    row.score = it->data.score;
+    out.push_back(row);
+  }
+  return out;
+}
+
+bool Leaderboard::saveSnapshot(const string& path) const {
+  shared_lock<shared_mutex> lock = readLock();
+  return saveLocked(path);
+}
+
+bool Leaderboard::saveLocked(const string& path) const {
+  if (mapped) {
+    const SnapshotFile& m = *mapped;
+    return SnapshotFile::write(path, m.size(), [&m](size_t i) {
+      SnapshotRow r;
+      string_view name = m.nameAt(i);
+      r.score = m.scoreAt(i);
+      r.name = name.data();
+      r.nameLen = (uint32_t)name.size();
+      return r;
+    });
+  }
+  // rows are asked for in order, so stream them from one inorder walk
+  ScoreCursor c = tree->seek(0);
+  return SnapshotFile::write(path, players.size(), [this, &c](size_t) {
+    const ScoreKey& k = tree->key(c);
+    SnapshotRow r;
+    r.score = k.score;
+    r.name = k.name.data();
+    r.nameLen = (uint32_t)k.name.size();
+    tree->next(c);
+    return r;
+  });
+}
+
+bool Leaderboard::openSnapshot(const string& path, bool verify) {
+  // map and check the file before touching the board
+  unique_ptr<SnapshotFile> file = SnapshotFile::open(path, verify);
+  if (!file) return false;
+
+  unique_lock<shared_mutex> lock = writeLock();
+  vector<Player>().swap(players);
+  vector<int32_t>().swap(scoreColumn);
+  index.clear();
+  tree->clear();
+  scores.clear();
+  current.clear();
+  mapped = std::move(file);
+  rebuildTop();  // the first rows of the file
+  rebuildApprox();
+  if (journal) {
+    // a logged board that switches files logs the new contents in full
+    uint64_t seq = journal->appendClear();
+    for (size_t i = 0; i < mapped->size(); i++) {
+      seq = journal->appendUpdate(string(mapped->nameAt(i)), mapped->scoreAt(i));
+    }
+    waitForJournal(lock, journal, seq);
+  }
+  return true;
+}
+
+void Leaderboard::materialize() {
+  unique_ptr<SnapshotFile> file = std::move(mapped);
+  vector<Player> rows(file->size());
+  for (size_t i = 0; i < rows.size(); i++) {
+    rows[i].name = string(file->nameAt(i));
+    rows[i].score = file->scoreAt(i);
+  }
+  loadRows(rows);  // already in leaderboard order: O(n) build
+}
+
+void Leaderboard::attachJournal(Journal* j) {
+  unique_lock<shared_mutex> lock = writeLock();
+  journal = j;
+}
+
+size_t Leaderboard::replayJournal(const Journal& j) {
+  // one write lock for the whole replay: no other writer can slip an update
+  // in between (and, being applied but not logged, lose it on the next
+  // restart). The records go through the locked helpers, so none is logged
+  // again to an attached journal.
+  unique_lock<shared_mutex> lock = writeLock();
+
+  // feed the records through applyBatchLocked in large chunks; a Clear
+  // record empties the board at its place in the log
+  const size_t kChunk = 65536;
+  vector<pair<string, int> > chunk;
+  vector<ScoreKey> additions;
+  auto applyChunk = [this, &chunk, &additions]() {
+    applyBatchLocked(chunk, batch_order(chunk), additions);
+    chunk.clear();
+    additions.clear();
+  };
+  size_t count = j.replay([this, &chunk, &applyChunk](const JournalRecord& r) {
+    if (r.kind == JournalRecord::Clear) {
+      chunk.clear();  // earlier updates are wiped anyway
+      mapped.reset();
+      loadRows(vector<Player>());
+      checkChanges();
+      return;
+    }
+    chunk.push_back(make_pair(r.name, r.score));
+    if (chunk.size() == kChunk) applyChunk();
+  });
+  if (!chunk.empty()) applyChunk();
+  return count;
+}
+
+bool Leaderboard::compactJournal(const string& checkpointPath) {
+  // a shared lock keeps writers out (and readers running) until both the
+  // checkpoint and the truncation are done; compactMu keeps a second
+  // compaction from writing the same checkpoint file meanwhile
+  lock_guard<mutex> compacting(compactMu);
+  shared_lock<shared_mutex> lock = readLock();
+  if (journal == NULL) return false;
+  if (!saveLocked(checkpointPath)) return false;
+  return journal->truncate();
+}
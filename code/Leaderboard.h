@@ -1,6 +1,21 @@
+#ifndef LEADERBOARD_H__
+#define LEADERBOARD_H__
+
 #include <string>
 #include <vector>
+#include <span>
+#include <utility>
+#include <mutex>
+#include <shared_mutex>
+#include <memory>
 #include "RBT.h"
+#include "PRBT.h"
+#include "ScoreIndex.h"
+#include "NameIndex.h"
+#include "SnapshotFile.h"
+#include "Journal.h"
+#include "ApproxRank.h"
+#include "ScoreScan.h"
 using namespace std;
 
 // simple record to hold one player
@@ -9,6 +24,13 @@ struct Player {
   int score;
 };
 
+// distinct scores, highest first, each with how many players hold it
+// (RBDuplicates::Counted: one node per score, however many ties)
+typedef RBT<int, rb_no_value, greater<int> > ScoreCounts;
+
+// persistent copy of the same index, kept when snapshots are enabled
+typedef PRBT<ScoreKey, int, ScoreOrder> ScoreVersion;
+
 // What we show after each update
 struct RankInfo {
   int score;            // player's score now
@@ -17,14 +39,144 @@ struct RankInfo {
   int totalPlayers;     // total players currently on the board
 };
 
+// construction-time settings for a Leaderboard
+struct LeaderboardOptions {
+  // concurrent: the board may be shared between threads. Readers
+  // (getScore, computeRank, neighborsAround, printAll, ...) hold a shared
+  // lock and run in parallel; writers (addOrUpdate, applyBatch, bulkLoad)
+  // hold the exclusive lock and are serialized. Off by default, where no
+  // locking is done at all.
+  bool concurrent = false;
+
+  // snapshots: also keep the ranking in a persistent (path-copying) tree, so
+  // snapshot() is O(1) and printAll / neighborsAround read a frozen version
+  // without holding the lock while they walk it. Costs O(log n) extra node
+  // allocations per changed score. Off by default.
+  bool snapshots = false;
+
+  // checkUpdates: after every write, re-check the red–black rules on the
+  // nodes it touched (RBT::validate_changes), O(log n) per update instead of
+  // validateTree's O(n), so checking can stay on in production. A failure
+  // is remembered and reported by updatesValid(). Off by default.
+  bool checkUpdates = false;
+
+  // topRows: keep the first topRows rows materialized, highest first, so
+  // topK(k) for k <= topRows is a view of a ready list instead of a walk.
+  // Writes only touch the list when a change enters, leaves or moves
+  // within it; anything else costs one comparison with its last row.
+  // 0 (the default) keeps no list.
+  int topRows = 0;
+
+  // scoreIndex: how the ranking itself is stored (ScoreIndex.h). RedBlack
+  // is one node per player; BTree packs 32-64 players per node, so a descent
+  // touches a few wide nodes and walks scan arrays; Compact is the red–black
+  // tree in one array with 32-bit links and no parent link. Same answers
+  // every way.
+  ScoreIndexKind scoreIndex = ScoreIndexKind::RedBlack;
+
+  // approxRankError: above 0, also keep an ApproxRank (ApproxRank.h) with
+  // this error, as a fraction of the players (0.001 = 0.1%), for
+  // approxRankOf / approxPercentileOf. It stays a few KB however many
+  // players there are, and every write adjusts one bucket of it. 0 (the
+  // default) keeps none, and those calls answer exactly.
+  double approxRankError = 0;
+};
+
+// TopKView is a read-only view of the first rows of the board, highest
+// first. A view of the materialized list (LeaderboardOptions::topRows)
+// shares it, so taking one allocates nothing. A writer that changes the list
+// while a view may still hold it switches to a copy, so a view keeps showing
+// the rows it was taken with; on a concurrent board it may be read from any
+// thread without locks.
+class TopKView {
+public:
+  typedef const Player* const_iterator;
+
+  TopKView() : rows(), count(0) {}
+  TopKView(shared_ptr<const vector<Player> > r, size_t n) : rows(std::move(r)), count(n) {}
+
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+  const Player& operator[](size_t i) const { return (*rows)[i]; }
+
+  const_iterator begin() const { return rows ? rows->data() : NULL; }
+  const_iterator end() const { return begin() + count; }
+
+private:
+  shared_ptr<const vector<Player> > rows;
+  size_t count;   // rows shown: a prefix of *rows
+};
+
+// LeaderboardSnapshot is a frozen, read-only version of the ranking. It owns
+// its version: writers may keep changing the board, and the snapshot still
+// shows the rows it was taken with. Nodes no other version shares are freed
+// when the last snapshot holding them is destroyed. Safe to read from any
+// number of threads without locks.
+class LeaderboardSnapshot {
+public:
+  typedef ScoreVersion::const_iterator const_iterator;  // *it is a node: it->data.name / .score
+
+  LeaderboardSnapshot() : version() {}
+  explicit LeaderboardSnapshot(const ScoreVersion& v) : version(v) {}
+
+  // number of players in this version
+  int size() const { return version.size(); }
+
+  // rows in leaderboard order (highest score first)
+  const_iterator begin() const { return version.begin(); }
+  const_iterator end() const { return version.end(); }
+
+  // iterator at 0-based position pos, O(log n); end() if out of range
+  const_iterator at(int pos) const { return version.iterator_at(pos); }
+
+  // rows [start, start + count) in leaderboard order, clipped to the board
+  vector<Player> rows(int start, int count) const;
+
+private:
+  ScoreVersion version;
+};
+
 class Leaderboard {
 public:
   Leaderboard();
+  explicit Leaderboard(const LeaderboardOptions& options);
 
   // add a new player or update an existing one.
   // if a player's score changes, remove old score from RBT and insert the new score.
   void addOrUpdate(const string& name, int score);
 
+  // replace the whole board with rows (cold start). Rows should already be in
+  // leaderboard order (score descending, then name); then the tree is built
+  // in O(n) with RBT::build_from_sorted instead of n separate inserts.
+  // Unsorted input is accepted and sorted first. If a name appears more
+  // than once the last row wins, as if the rows were replayed with addOrUpdate.
+  void bulkLoad(const vector<Player>& rows);
+
+  // apply many (name, score) updates at once, e.g. a match-end burst.
+  // Updates are coalesced per player (the last one in the batch wins), updates
+  // that leave a score unchanged are dropped, and the remaining tree work is
+  // done as one pass of removals and one pass of insertions, each in key
+  // order so consecutive descents walk mostly the same, cached, path.
+  // Returns the number of players whose score changed or who were added.
+  int applyBatch(span<const pair<string, int> > updates);
+
+  // season merge: move every player of other onto this board; other is
+  // left empty. A player on both boards keeps the higher score. The score
+  // index and counts are united whole (ScoreIndex::unite, RBT::unite), not
+  // re-inserted key by key; the m moved players are still copied into this
+  // board's player array and name index, O(m) on top. Both boards are
+  // logged to their journals. Returns the number of players added or
+  // raised, as applyBatch.
+  int mergeFrom(Leaderboard& other);
+
+  // score tier: move every player scoring minScore or more to tier
+  // (emptied first); this board keeps the rest. The score index and counts
+  // are cut with one split each (ScoreIndex::split_at, RBT::split_at);
+  // both boards' player arrays are then compacted and their slots
+  // renumbered, O(n). Each journal logs a Clear and its board's players.
+  // Returns the number of players moved.
+  int splitTier(int minScore, Leaderboard& tier);
+
   // find a player's score; returns true if found.
   bool getScore(const string& name, int& outScore) const;
 
@@ -32,21 +184,193 @@ public:
   void printAll() const;
 
   // validate the red–black tree invariants (uses your RBT::validate()).
+  // Checks the whole board, O(n); see also updatesValid.
   bool validateTree() const;
 
+  // with options.checkUpdates: false once any write has left a tree
+  // breaking the red–black rules around the nodes it changed. Always true
+  // without the option.
+  bool updatesValid() const;
+
+  // node memory held by the score tree (live / peak / reserved).
+  rb_mem_stats treeMemory() const;
+
   // compute rank info for one player; returns false if name not found.
   bool computeRank(const string& name, RankInfo& outInfo) const;
 
   // get nearby rows (descending). halfWindow = how many above and how many below.
   vector<Player> neighborsAround(const string& name, int halfWindow) const;
 
+  // number of players with lo <= score <= hi (0 if lo > hi). Two descents
+  // of the distinct-score tree, O(log n); nothing is copied or scanned.
+  int countInRange(int lo, int hi) const;
+
+  // how many players score above score and how many score exactly score,
+  // from the distinct-score tree in O(log n). Boards that split players
+  // between them add these up to rank across all of them.
+  void countAround(int score, int& above, int& tied) const;
+
+  // number of players on the board
+  int size() const;
+
+  // rows [start, start + count) in leaderboard order, clipped to the board,
+  // as LeaderboardSnapshot::rows: one descent to start, then an inorder
+  // walk, O(log n + count).
+  vector<Player> rows(int start, int count) const;
+
+  // players with lo <= score <= hi in leaderboard order, at most limit of
+  // them (limit < 0: all). Starts at the highest such score with one
+  // descent and walks inorder from there: O(log n + k) for k rows returned.
+  vector<Player> playersInRange(int lo, int hi, int limit = -1) const;
+
+  // percentile rank of a player: the share of the board scoring below them,
+  // counting half of their ties (themselves included), in [0, 100].
+  // Returns false if name is not found. O(log n).
+  bool percentileOf(const string& name, double& outPercentile) const;
+
+  // estimated rank (1 = best) and percentile of a player, within
+  // options.approxRankError of the player count, from the score histogram:
+  // O(log buckets) and no walk. Without the option these are the exact
+  // answers (computeRank / percentileOf). False if name is not found.
+  bool approxRankOf(const string& name, int& outRank) const;
+  bool approxPercentileOf(const string& name, double& outPercentile) const;
+
+  // the same counts by scanning the score column (ScoreScan.h) instead of
+  // descending the trees: O(n), but one sequential pass over 4 bytes per
+  // player with the widest SIMD kernel the CPU has, so close to memory
+  // bandwidth. For analytics over the whole board and for cross-checking the
+  // trees. A mapped snapshot has no column yet and is answered from its
+  // score runs.
+  int scanCountAbove(int score) const;
+  int scanCountTied(int score) const;
+  int scanCountInRange(int lo, int hi) const;
+
+  // lowest and highest score on the board, from the same scan. Returns
+  // false on an empty board.
+  bool scanMinMax(int& outMin, int& outMax) const;
+
+  // the lowest score that at least p percent of the board is at or below
+  // (nearest rank; p is clipped to [0, 100]). Returns false on an empty
+  // board. O(log n).
+  bool scoreAtPercentile(double p, int& outScore) const;
+
+  // counts per score bucket: result[i] is the number of players with
+  // bucketEdges[i] <= score < bucketEdges[i + 1], for ascending edges
+  // (m edges give m - 1 buckets; scores outside them are not counted).
+  // O(log n) per edge, whatever the number of players.
+  vector<int> histogram(span<const int> bucketEdges) const;
+
+  // the first k rows (fewer if the board is smaller), highest first. For
+  // k <= options.topRows this reads the materialized list: O(1), no
+  // allocation. Larger k, or a board without the option, walks the tree
+  // into a new list, O(k).
+  TopKView topK(int k) const;
+
+  // take a frozen version of the ranking. O(1) with options.snapshots,
+  // otherwise the version is built from the tree in O(n).
+  LeaderboardSnapshot snapshot() const;
+
+  // write the board to path in the binary snapshot format (SnapshotFile.h).
+  // Returns false on I/O errors.
+  bool saveSnapshot(const string& path) const;
+
+  // replace the board with the snapshot at path. The file is mapped, not
+  // loaded: getScore, computeRank, neighborsAround and printAll are answered
+  // straight from the mapping, paging in only what they touch, so the first
+  // query does not wait for a rebuild. The first write (addOrUpdate,
+  // applyBatch) loads the rows into memory in O(n) and drops the mapping.
+  // Returns false and leaves the board unchanged if the file is missing or
+  // invalid; verify also checksums the whole payload.
+  bool openSnapshot(const string& path, bool verify = false);
+
+  // log every change from now on to j (NULL stops logging). The journal is
+  // not owned; it must outlive the board or be detached first. With
+  // JournalOptions::waitDurable, writers return once their record is synced
+  // (concurrent writers share one sync per group-commit window).
+  void attachJournal(Journal* j);
+
+  // recovery: apply j's records to the board, in batches, without logging
+  // them again. Writers wait until the whole journal is replayed. Usually:
+  // openSnapshot(checkpoint), replayJournal(j), attachJournal(&j). Returns
+  // the number of records replayed.
+  size_t replayJournal(const Journal& j);
+
+  // compaction: write the board to checkpointPath as a snapshot, then empty
+  // the attached journal. Writers wait meanwhile so no update can fall
+  // between the two. A crash in between is harmless: the journal's records
+  // are absolute scores and replay onto the new checkpoint unchanged.
+  bool compactJournal(const string& checkpointPath);
+
 private:
+  LeaderboardOptions opts;
+  mutable shared_mutex mu;      // only used when opts.concurrent
+  mutex compactMu;              // one compactJournal at a time (it holds mu shared)
+
+  // lock helpers: hold mu shared / exclusive in concurrent mode, no-op otherwise
+  shared_lock<shared_mutex> readLock() const;
+  unique_lock<shared_mutex> writeLock();
+
   vector<Player> players;  // simple array of (name,score)
-  RBT tree;                     // RBT holds scores so we can validate after updates
+  vector<int32_t> scoreColumn;  // players[i].score at i, contiguous for the scan kernels
+  unique_ptr<ScoreIndex> tree;  // players in leaderboard order; inorder walk = ranking
+  ScoreCounts scores;           // score -> number of players on it, for computeRank
+  NameIndex index;              // name -> slot in players, kept in sync by addOrUpdate
+  ScoreVersion current;         // latest persistent version (only with opts.snapshots)
+  unique_ptr<SnapshotFile> mapped;  // set after openSnapshot until the first write
+  Journal* journal;             // change log, if attached (not owned)
+  bool updatesOk;               // no checked write has failed (opts.checkUpdates)
+  shared_ptr<vector<Player> > top;  // first opts.topRows rows (only with opts.topRows)
+  unique_ptr<ApproxRank> approx;    // score histogram (only with opts.approxRankError)
+
+  // bulkLoad's work, with the write lock already held
+  void loadRows(const vector<Player>& rows);
+  // log the whole board as a replacement: Clear, then every player.
+  // Returns the last sequence number (write lock held)
+  uint64_t logAll();
+  // lock this board and other for writing, in address order so two boards
+  // merging into each other cannot deadlock
+  void writeLockPair(Leaderboard& other, unique_lock<shared_mutex>& mine,
+                     unique_lock<shared_mutex>& theirs);
+  // rebuild current from the tree after a merge or split (write lock held)
+  void rebuildCurrent();
+  // applyBatch's work, with the write lock held and without logging: order
+  // is the batch coalesced by name; the new keys go to additions
+  void applyBatchLocked(span<const pair<string, int> > updates, const vector<int>& order,
+                        vector<ScoreKey>& additions);
+  // bring a mapped snapshot into the in-memory structures (write lock held)
+  void materialize();
+  // saveSnapshot's work, with a lock already held
+  bool saveLocked(const string& path) const;
+  // countInRange's work, with a lock already held
+  int countLocked(int lo, int hi) const;
+  // players above score and on it, from the score counts or the mapped
+  // file's score runs (lock held)
+  void countAroundLocked(int score, int& above, int& tied) const;
+  // players on the board (lock held)
+  int playerCount() const;
+  // the first k rows of the tree or mapped file into out (lock held)
+  void copyTop(size_t k, vector<Player>& out) const;
+  // keep top in step with one player's move from (oldScore, key.name) to
+  // key; hadScore is false for a new player (write lock held, tree updated)
+  void updateTop(const ScoreKey& key, bool hadScore, int oldScore);
+  // refill top from scratch after a batch, bulk load or snapshot open
+  void rebuildTop();
+  // whether a batch's net changes reach into top (tree already updated)
+  bool batchTouchesTop(const vector<ScoreKey>& removals, const vector<ScoreKey>& additions) const;
+  // rebuild approx from the exact counts after bulk changes, or once it
+  // reports stale (write lock held)
+  void rebuildApprox();
+  // a player's score by name, from the board or the mapped file (lock held)
+  bool scoreLocked(const string& name, int& outScore) const;
+  // top, copied first if a TopKView still shares it
+  vector<Player>& topForWrite();
+  // with opts.checkUpdates: check what the last write changed (write lock held)
+  void checkChanges();
+  // after a logged write: drop the lock, then wait for seq if asked to
+  void waitForJournal(unique_lock<shared_mutex>& lock, Journal* j, uint64_t seq);
 
-  // find index of a name in the vector (linear scan, simple and clear). Returns -1 if not found.
+  // find index of a name in the vector through the hash index (O(1) expected). Returns -1 if not found.
   int findIndexByName(const string& name) const;
+};
 
-  // build a copy of players sorted by descending score (for printing, rank windows, etc.).
-  vector<Player> sortedDesc() const;
-};
\ No newline at end of file
+#endif // LEADERBOARD_H__
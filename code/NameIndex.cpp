@@ -0,0 +1,70 @@
+/* Please refer to the header file (NameIndex.h) for documentation of each method. */
+
+#include "NameIndex.h"
+#include <functional>  // std::hash
+
+// tables start small and double; we grow before the load factor passes 0.7
+// so probe sequences stay short even for names that miss.
+static const size_t kMinCapacity = 16;
+
+NameIndex::NameIndex() : table(), count(0) {}
+
+uint32_t NameIndex::hash_name(const string& name) {
+  // fold through 64 bits: shifting a 32-bit size_t by 32 is undefined
+  uint64_t h = std::hash<string>()(name);
+  uint32_t tag = (uint32_t)(h ^ (h >> 32));
+  if (tag == 0) tag = 1;  // keep 0 free so a tag never looks uninitialised
+  return tag;
+}
+
+void NameIndex::grow(size_t new_cap) {
+  vector<entry> old;
+  old.swap(table);
+  entry empty;
+  empty.tag = 0;
+  empty.slot = -1;
+  table.assign(new_cap, empty);
+
+  // re-place every entry from its stored tag; no names are needed
+  size_t mask = new_cap - 1;
+  for (size_t k = 0; k < old.size(); k++) {
+    if (old[k].slot < 0) continue;
+    size_t i = old[k].tag & mask;
+    while (table[i].slot >= 0) {
+      i = (i + 1) & mask;
+    }
+    table[i] = old[k];
+  }
+}
+
+void NameIndex::reserve(size_t n) {
+  if (n * 10 < table.size() * 7) return;  // already fits (the common case)
+  size_t cap = kMinCapacity;
+  while (n * 10 >= cap * 7) {
+    cap = cap * 2;
+  }
+  if (cap > table.size()) {
+    grow(cap);
+  }
+}
+
+void NameIndex::insert(const string& name, int slot) {
+  reserve(count + 1);
+  uint32_t tag = hash_name(name);
+  size_t mask = table.size() - 1;
+  size_t i = tag & mask;
+  while (table[i].slot >= 0) {
+    i = (i + 1) & mask;
+  }
+  table[i].tag = tag;
+  table[i].slot = slot;
+  count++;
+}
+
+void NameIndex::clear() {
+  for (size_t i = 0; i < table.size(); i++) {
+    table[i].tag = 0;
+    table[i].slot = -1;
+  }
+  count = 0;
+}
@@ -0,0 +1,93 @@
+#ifndef NAME_INDEX_H__
+#define NAME_INDEX_H__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// NameIndex maps a player name to its slot in the owner's player array.
+//
+// It is an open-addressing hash table with linear probing. The table does not
+// keep its own copy of the names: each entry is just a 32-bit hash tag and the
+// slot number, and lookups compare the name through a callback that returns
+// the name stored at a slot. That keeps an entry at 8 bytes and lets the
+// owner's array stay the single home of the strings.
+//
+// Names are never removed (players stay on the board once added).
+class NameIndex {
+public:
+  NameIndex();
+
+  // find returns the slot stored for name, or -1 if the name is not indexed.
+  // name_at(slot) must return the name the owner keeps at that slot.
+  template <class NameAt>
+  int find(const string& name, NameAt name_at) const;
+
+  // insert records name -> slot. The caller guarantees name is not present.
+  void insert(const string& name, int slot);
+
+  // find_or_insert returns the slot already stored for name, or records
+  // name -> slot and returns -1. One hash and one probe sequence for both.
+  template <class NameAt>
+  int find_or_insert(const string& name, int slot, NameAt name_at);
+
+  // reserve grows the table so n names fit without rehashing.
+  void reserve(size_t n);
+
+  // clear drops every entry (capacity is kept).
+  void clear();
+
+  size_t size() const { return count; }
+
+private:
+  struct entry {
+    uint32_t tag;   // hash of the name (0 is remapped so it never means empty)
+    int32_t slot;   // -1 marks an empty bucket
+  };
+
+  vector<entry> table;  // capacity is always a power of two
+  size_t count;
+
+  void grow(size_t new_cap);
+  // hash_name is the hash used for the tag
+  static uint32_t hash_name(const string& name);
+};
+
+template <class NameAt>
+int NameIndex::find(const string& name, NameAt name_at) const {
+  if (count == 0) return -1;
+  uint32_t tag = hash_name(name);
+  size_t mask = table.size() - 1;
+  size_t i = tag & mask;
+  // probe until an empty bucket; compare names only when the tag matches
+  while (table[i].slot >= 0) {
+    if (table[i].tag == tag && name_at(table[i].slot) == name) {
+      return table[i].slot;
+    }
+    i = (i + 1) & mask;
+  }
+  return -1;
+}
+
+template <class NameAt>
+int NameIndex::find_or_insert(const string& name, int slot, NameAt name_at) {
+  reserve(count + 1);
+  uint32_t tag = hash_name(name);
+  size_t mask = table.size() - 1;
+  size_t i = tag & mask;
+  while (table[i].slot >= 0) {
+    if (table[i].tag == tag && name_at(table[i].slot) == name) {
+      return table[i].slot;
+    }
+    i = (i + 1) & mask;
+  }
+  // the probe ended on the empty bucket where name belongs
+  table[i].tag = tag;
+  table[i].slot = slot;
+  count++;
+  return -1;
+}
+
+#endif // NAME_INDEX_H__
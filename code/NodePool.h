@@ -0,0 +1,191 @@
+#ifndef NODE_POOL_H__
+#define NODE_POOL_H__
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// NodePool is a slab allocator for fixed-size tree nodes.
+//
+// Nodes are carved out of large contiguous slabs in allocation order, so nodes
+// created together sit next to each other in memory. Destroyed nodes go onto
+// a free list (the link lives inside the dead node itself) and are handed out
+// again before any new slab space is used. Slabs start small and double up to
+// kMaxSlabNodes, so tiny trees stay tiny and big trees need few allocations.
+//
+// release() returns every slab to the system in one go without visiting the
+// nodes; callers whose nodes own resources must destroy() them first.
+template <class T>
+class NodePool {
+public:
+  NodePool();
+  ~NodePool();
+
+  // a pool owns raw memory that live nodes point into: never copy it
+  NodePool(const NodePool&) = delete;
+  NodePool& operator=(const NodePool&) = delete;
+
+  // create constructs a T in pooled memory.
+  template <class... Args>
+  T* create(Args&&... args);
+
+  // destroy runs ~T and puts the memory on the free list.
+  void destroy(T* p);
+
+  // release frees every slab at once. Live nodes are not destructed.
+  void release();
+
+  // adopt takes over every slab of other, live nodes and free cells
+  // included, and leaves other empty. Nodes keep their addresses, so a tree
+  // can take in another tree's nodes without copying them. O(slabs) plus a
+  // walk of the shorter free list and of the smaller unused slab tail.
+  void adopt(NodePool& other);
+
+  // memory accounting
+  size_t live_nodes() const { return live; }
+  size_t peak_nodes() const { return peak; }
+  size_t reserved_nodes() const { return capacity; }
+  static size_t node_bytes() { return sizeof(cell); }
+
+private:
+  union cell {
+    cell* next;                                  // while on the free list
+    alignas(T) unsigned char bytes[sizeof(T)];   // while holding a T
+  };
+
+  static const size_t kFirstSlabNodes = 64;
+  static const size_t kMaxSlabNodes = 65536;
+
+  vector<cell*> slabs;
+  cell* free_list;    // most recently destroyed node first
+  cell* bump;         // next never-used cell in the newest slab
+  cell* bump_end;
+  size_t next_slab;   // size of the next slab to allocate
+  size_t live;
+  size_t peak;
+  size_t capacity;    // cells across all slabs
+
+  cell* grab();
+  size_t free_cells() const { return capacity - live - (size_t)(bump_end - bump); }
+};
+
+template <class T>
+NodePool<T>::NodePool()
+    : slabs(), free_list(nullptr), bump(nullptr), bump_end(nullptr),
+      next_slab(kFirstSlabNodes), live(0), peak(0), capacity(0) {}
+
+template <class T>
+NodePool<T>::~NodePool() {
+  release();
+}
+
+template <class T>
+typename NodePool<T>::cell* NodePool<T>::grab() {
+  // reuse a freed node first: it is likely still in cache
+  if (free_list != nullptr) {
+    cell* c = free_list;
+    free_list = c->next;
+    return c;
+  }
+  if (bump == bump_end) {
+    cell* slab = static_cast<cell*>(::operator new(next_slab * sizeof(cell)));
+    slabs.push_back(slab);
+    bump = slab;
+    bump_end = slab + next_slab;
+    capacity += next_slab;
+    if (next_slab < kMaxSlabNodes) next_slab *= 2;
+  }
+  return bump++;
+}
+
+template <class T>
+template <class... Args>
+T* NodePool<T>::create(Args&&... args) {
+  cell* c = grab();
+  T* p = ::new (static_cast<void*>(c->bytes)) T(std::forward<Args>(args)...);
+  live++;
+  if (live > peak) peak = live;
+  return p;
+}
+
+template <class T>
+void NodePool<T>::destroy(T* p) {
+  if (p == nullptr) return;
+  p->~T();
+  cell* c = reinterpret_cast<cell*>(p);
+  c->next = free_list;
+  free_list = c;
+  live--;
+}
+
+template <class T>
+void NodePool<T>::release() {
+  for (size_t i = 0; i < slabs.size(); i++) {
+    ::operator delete(slabs[i]);
+  }
+  slabs.clear();
+  free_list = nullptr;
+  bump = nullptr;
+  bump_end = nullptr;
+  next_slab = kFirstSlabNodes;
+  live = 0;
+  capacity = 0;
+}
+
+template <class T>
+void NodePool<T>::adopt(NodePool& other) {
+  if (&other == this) return;
+  slabs.insert(slabs.end(), other.slabs.begin(), other.slabs.end());
+  size_t mine = free_cells();
+  size_t theirs = other.free_cells();
+  cell* their_list = other.free_list;
+
+  // keep the larger unused slab tail for bump allocation; the cells of the
+  // smaller one go on the free lists
+  if (bump_end - bump < other.bump_end - other.bump) {
+    for (cell* c = bump; c != bump_end; c++, mine++) {
+      c->next = free_list;
+      free_list = c;
+    }
+    bump = other.bump;
+    bump_end = other.bump_end;
+  }
+  else {
+    for (cell* c = other.bump; c != other.bump_end; c++, theirs++) {
+      c->next = their_list;
+      their_list = c;
+    }
+  }
+
+  // hang the longer free list off the end of the shorter one
+  cell* shorter = free_list;
+  cell* longer = their_list;
+  if (mine > theirs) swap(shorter, longer);
+  if (shorter == nullptr) {
+    free_list = longer;
+  }
+  else {
+    cell* tail = shorter;
+    while (tail->next != nullptr) tail = tail->next;
+    tail->next = longer;
+    free_list = shorter;
+  }
+
+  live += other.live;
+  if (live > peak) peak = live;
+  capacity += other.capacity;
+  if (other.next_slab > next_slab) next_slab = other.next_slab;
+
+  other.slabs.clear();
+  other.free_list = nullptr;
+  other.bump = nullptr;
+  other.bump_end = nullptr;
+  other.next_slab = kFirstSlabNodes;
+  other.live = 0;
+  other.capacity = 0;
+}
+
+#endif // NODE_POOL_H__
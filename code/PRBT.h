@@ -0,0 +1,454 @@
+#ifndef PRBT_H__
+#define PRBT_H__
+
+#include <functional>
+#include <memory>
+#include <vector>
+#include "RBT.h"   // RBColor, rb_no_value, rb_rank
+
+using namespace std;
+
+// PRBT is a persistent (path-copying) red–black tree.
+//
+// Nodes are immutable once built and are shared between versions through
+// shared_ptr. insert and remove never change an existing node: they copy the
+// O(log n) nodes on the root-to-key path and reuse every other subtree. A
+// PRBT object is one version; copying it is O(1) (one reference count bump)
+// and the copy keeps seeing exactly the keys it had, whatever later inserts
+// or removes do to the original. When the last version that references a
+// node goes away, the node is freed.
+//
+// Keys are unique (a set): inserting an existing key replaces its payload.
+// Each node also keeps its subtree size, so rank/select work like RBT's.
+//
+// Insert and remove follow Kahrs' functional red–black algorithms
+// ("Red-black trees with types", JFP 2001), written over shared links.
+// A version may be read from many threads at once; changing one PRBT object
+// from two threads needs outside locking, like any other object.
+
+template <class Key, class Value = rb_no_value>
+struct prb_node {
+  Key data;
+  Value value;
+  RBColor color;
+  int size;                              // nodes in this subtree
+  shared_ptr<const prb_node> left;
+  shared_ptr<const prb_node> right;
+};
+
+template <class Key, class Value = rb_no_value, class Compare = std::less<Key> >
+class PRBT {
+public:
+  typedef prb_node<Key, Value> node_type;
+  typedef shared_ptr<const node_type> link;
+
+  explicit PRBT(const Compare& comp = Compare());
+
+  int size() const { return root ? root->size : 0; }
+  bool empty() const { return !root; }
+
+  // find returns the node holding data, or NULL.
+  const node_type* find(const Key& data) const;
+  bool contains(const Key& data) const { return find(data) != NULL; }
+
+  // insert adds data (or replaces the payload of an equal key) in this
+  // version only. O(log n) new nodes.
+  void insert(const Key& data, const Value& value = Value());
+
+  // remove deletes data from this version only; false if it was absent.
+  bool remove(const Key& data);
+
+  // clear drops this version's reference to the tree.
+  void clear() { root.reset(); }
+
+  // build_from_sorted replaces this version with n keys already in order, in
+  // O(n), colored by level like RBT::build_from_sorted.
+  template <class KeyAt, class ValueAt>
+  void build_from_sorted(int n, KeyAt key_at, ValueAt value_at);
+
+  // order statistics, same meaning as RBT::rank / RBT::select
+  template <class K>
+  rb_rank rank(const K& data) const;
+  const node_type* select(int k) const;
+
+  // validate checks the red–black rules and the subtree sizes.
+  bool validate() const;
+
+  // const_iterator walks keys in order with an explicit stack of at most
+  // one node per level, so it needs no parent pointers. It stays valid as
+  // long as some version holding the nodes (e.g. this object) is alive.
+  class const_iterator {
+  public:
+    const_iterator() : path() {}
+    const node_type& operator*() const { return *path.back(); }
+    const node_type* operator->() const { return path.back(); }
+    const_iterator& operator++();
+    bool operator==(const const_iterator& o) const {
+      if (path.empty() || o.path.empty()) return path.empty() && o.path.empty();
+      return path.back() == o.path.back();
+    }
+    bool operator!=(const const_iterator& o) const { return !(*this == o); }
+
+  private:
+    friend class PRBT;
+    vector<const node_type*> path;  // nodes still to visit; back() is current
+    void push_left(const node_type* n);
+  };
+
+  const_iterator begin() const;
+  const_iterator end() const { return const_iterator(); }
+  // iterator_at starts the walk at inorder position pos (end() if out of range)
+  const_iterator iterator_at(int pos) const;
+
+private:
+  link root;
+  Compare comp;
+
+  static bool is_red(const link& n) { return n && n->color == RBColor::Red; }
+  static bool is_black_node(const link& n) { return n && n->color == RBColor::Black; }
+  static int size_of(const link& n) { return n ? n->size : 0; }
+  static link make(RBColor c, const link& l, const Key& k, const Value& v, const link& r);
+  static link recolor(const link& n, RBColor c);
+
+  static link balance(const link& l, const Key& k, const Value& v, const link& r);
+  static link balleft(const link& l, const Key& k, const Value& v, const link& r);
+  static link balright(const link& l, const Key& k, const Value& v, const link& r);
+  static link append(const link& a, const link& b);
+
+  link ins(const link& n, const Key& k, const Value& v) const;
+  link del(const link& n, const Key& k) const;
+
+  template <class KeyAt, class ValueAt>
+  link build_range(int lo, int hi, int depth, int red_depth, KeyAt& key_at, ValueAt& value_at) const;
+  static int black_height(const node_type* n);
+};
+
+// ---------------------------------------------------------------- helpers
+
+template <class Key, class Value, class Compare>
+PRBT<Key, Value, Compare>::PRBT(const Compare& c) : root(), comp(c) {}
+
+// make builds a new immutable node; its size comes from the children
+template <class Key, class Value, class Compare>
+typename PRBT<Key, Value, Compare>::link PRBT<Key, Value, Compare>::make(
+        RBColor c, const link& l, const Key& k, const Value& v, const link& r) {
+  shared_ptr<node_type> n = make_shared<node_type>();
+  n->data = k;
+  n->value = v;
+  n->color = c;
+  n->size = 1 + size_of(l) + size_of(r);
+  n->left = l;
+  n->right = r;
+  return n;
+}
+
+// recolor copies one node with a different color (children are shared)
+template <class Key, class Value, class Compare>
+typename PRBT<Key, Value, Compare>::link PRBT<Key, Value, Compare>::recolor(const link& n, RBColor c) {
+  if (!n || n->color == c) return n;
+  return make(c, n->left, n->data, n->value, n->right);
+}
+
+// balance builds a BLACK node (l, k, r), rotating away a red-red pair below
+// it if there is one: the four red-red shapes (plus "both children red")
+// all become a RED node with two BLACK children.
+template <class Key, class Value, class Compare>
+typename PRBT<Key, Value, Compare>::link PRBT<Key, Value, Compare>::balance(
+        const link& l, const Key& k, const Value& v, const link& r) {
+  const RBColor R = RBColor::Red;
+  const RBColor B = RBColor::Black;
+  if (is_red(l) && is_red(r)) {
+    return make(R, recolor(l, B), k, v, recolor(r, B));
+  }
+  if (is_red(l) && is_red(l->left)) {        // left-left
+    return make(R, recolor(l->left, B), l->data, l->value, make(B, l->right, k, v, r));
+  }
+  if (is_red(l) && is_red(l->right)) {       // left-right
+    const link& m = l->right;
+    return make(R, make(B, l->left, l->data, l->value, m->left), m->data, m->value,
+                make(B, m->right, k, v, r));
+  }
+  if (is_red(r) && is_red(r->right)) {       // right-right
+    return make(R, make(B, l, k, v, r->left), r->data, r->value, recolor(r->right, B));
+  }
+  if (is_red(r) && is_red(r->left)) {        // right-left
+    const link& m = r->left;
+    return make(R, make(B, l, k, v, m->left), m->data, m->value,
+                make(B, m->right, r->data, r->value, r->right));
+  }
+  return make(B, l, k, v, r);
+}
+
+// balleft repairs (l, k, r) after the left side lost one black level
+template <class Key, class Value, class Compare>
+typename PRBT<Key, Value, Compare>::link PRBT<Key, Value, Compare>::balleft(
+        const link& l, const Key& k, const Value& v, const link& r) {
+  const RBColor R = RBColor::Red;
+  const RBColor B = RBColor::Black;
+  if (is_red(l)) {
+    return make(R, recolor(l, B), k, v, r);
+  }
+  if (is_black_node(r)) {
+    return balance(l, k, v, recolor(r, R));
+  }
+  // r is red with a black left child
+  const link& m = r->left;
+  return make(R, make(B, l, k, v, m->left), m->data, m->value,
+              balance(m->right, r->data, r->value, recolor(r->right, R)));
+}
+
+// balright mirrors balleft for a right side that lost one black level
+template <class Key, class Value, class Compare>
+typename PRBT<Key, Value, Compare>::link PRBT<Key, Value, Compare>::balright(
+        const link& l, const Key& k, const Value& v, const link& r) {
+  const RBColor R = RBColor::Red;
+  const RBColor B = RBColor::Black;
+  if (is_red(r)) {
+    return make(R, l, k, v, recolor(r, B));
+  }
+  if (is_black_node(l)) {
+    return balance(recolor(l, R), k, v, r);
+  }
+  // l is red with a black right child
+  const link& m = l->right;
+  return make(R, balance(recolor(l->left, R), l->data, l->value, m->left), m->data, m->value,
+              make(B, m->right, k, v, r));
+}
+
+// append joins two subtrees of equal black height whose keys are all
+// ordered a < b (what is left after removing the node between them)
+template <class Key, class Value, class Compare>
+typename PRBT<Key, Value, Compare>::link PRBT<Key, Value, Compare>::append(const link& a, const link& b) {
+  const RBColor R = RBColor::Red;
+  const RBColor B = RBColor::Black;
+  if (!a) return b;
+  if (!b) return a;
+  if (is_red(a) && is_red(b)) {
+    link bc = append(a->right, b->left);
+    if (is_red(bc)) {
+      return make(R, make(R, a->left, a->data, a->value, bc->left), bc->data, bc->value,
+                  make(R, bc->right, b->data, b->value, b->right));
+    }
+    return make(R, a->left, a->data, a->value, make(R, bc, b->data, b->value, b->right));
+  }
+  if (!is_red(a) && !is_red(b)) {
+    link bc = append(a->right, b->left);
+    if (is_red(bc)) {
+      return make(R, make(B, a->left, a->data, a->value, bc->left), bc->data, bc->value,
+                  make(B, bc->right, b->data, b->value, b->right));
+    }
+    return balleft(a->left, a->data, a->value, make(B, bc, b->data, b->value, b->right));
+  }
+  if (is_red(b)) {
+    return make(R, append(a, b->left), b->data, b->value, b->right);
+  }
+  return make(R, a->left, a->data, a->value, append(a->right, b));
+}
+
+// ---------------------------------------------------------------- insert
+
+template <class Key, class Value, class Compare>
+typename PRBT<Key, Value, Compare>::link PRBT<Key, Value, Compare>::ins(
+        const link& n, const Key& k, const Value& v) const {
+  if (!n) {
+    return make(RBColor::Red, link(), k, v, link());
+  }
+  if (comp(k, n->data)) {
+    if (n->color == RBColor::Black) return balance(ins(n->left, k, v), n->data, n->value, n->right);
+    return make(RBColor::Red, ins(n->left, k, v), n->data, n->value, n->right);
+  }
+  if (comp(n->data, k)) {
+    if (n->color == RBColor::Black) return balance(n->left, n->data, n->value, ins(n->right, k, v));
+    return make(RBColor::Red, n->left, n->data, n->value, ins(n->right, k, v));
+  }
+  return make(n->color, n->left, k, v, n->right);  // same key: new payload
+}
+
+template <class Key, class Value, class Compare>
+void PRBT<Key, Value, Compare>::insert(const Key& data, const Value& value) {
+  root = recolor(ins(root, data, value), RBColor::Black);
+}
+
+// ---------------------------------------------------------------- remove
+
+// del removes k from the subtree n. Removing from a BLACK subtree may
+// shorten it by one black level; balleft / balright repair that one level up.
+template <class Key, class Value, class Compare>
+typename PRBT<Key, Value, Compare>::link PRBT<Key, Value, Compare>::del(const link& n, const Key& k) const {
+  if (!n) return n;
+  if (comp(k, n->data)) {
+    if (is_black_node(n->left)) return balleft(del(n->left, k), n->data, n->value, n->right);
+    return make(RBColor::Red, del(n->left, k), n->data, n->value, n->right);
+  }
+  if (comp(n->data, k)) {
+    if (is_black_node(n->right)) return balright(n->left, n->data, n->value, del(n->right, k));
+    return make(RBColor::Red, n->left, n->data, n->value, del(n->right, k));
+  }
+  return append(n->left, n->right);
+}
+
+template <class Key, class Value, class Compare>
+bool PRBT<Key, Value, Compare>::remove(const Key& data) {
+  // the black-height repair assumes the key is present, so check first
+  if (find(data) == NULL) return false;
+  root = recolor(del(root, data), RBColor::Black);
+  return true;
+}
+
+// ---------------------------------------------------------------- queries
+
+template <class Key, class Value, class Compare>
+const typename PRBT<Key, Value, Compare>::node_type* PRBT<Key, Value, Compare>::find(const Key& data) const {
+  const node_type* c = root.get();
+  while (c != NULL) {
+    if (comp(data, c->data)) c = c->left.get();
+    else if (comp(c->data, data)) c = c->right.get();
+    else return c;
+  }
+  return NULL;
+}
+
+template <class Key, class Value, class Compare>
+template <class K>
+rb_rank PRBT<Key, Value, Compare>::rank(const K& data) const {
+  rb_rank r;
+  r.less = 0;
+  r.equal = 0;
+  r.greater = 0;
+  int le = 0;
+  for (const node_type* c = root.get(); c != NULL;) {   // keys < data
+    if (comp(c->data, data)) {
+      r.less += size_of(c->left) + 1;
+      c = c->right.get();
+    } else {
+      c = c->left.get();
+    }
+  }
+  for (const node_type* c = root.get(); c != NULL;) {   // keys <= data
+    if (comp(data, c->data)) {
+      c = c->left.get();
+    } else {
+      le += size_of(c->left) + 1;
+      c = c->right.get();
+    }
+  }
+  r.equal = le - r.less;
+  r.greater = size() - le;
+  return r;
+}
+
+template <class Key, class Value, class Compare>
+const typename PRBT<Key, Value, Compare>::node_type* PRBT<Key, Value, Compare>::select(int k) const {
+  if (k < 0 || k >= size()) return NULL;
+  const node_type* c = root.get();
+  while (c != NULL) {
+    int ls = size_of(c->left);
+    if (k < ls) {
+      c = c->left.get();
+    } else if (k == ls) {
+      return c;
+    } else {
+      k -= ls + 1;
+      c = c->right.get();
+    }
+  }
+  return NULL;
+}
+
+// black_height returns the black height of n, or -1 if a rule is broken
+template <class Key, class Value, class Compare>
+int PRBT<Key, Value, Compare>::black_height(const node_type* n) {
+  if (n == NULL) return 1;
+  const node_type* l = n->left.get();
+  const node_type* r = n->right.get();
+  if (n->color == RBColor::Red) {
+    if ((l != NULL && l->color == RBColor::Red) || (r != NULL && r->color == RBColor::Red)) return -1;
+  }
+  if (n->size != 1 + (l ? l->size : 0) + (r ? r->size : 0)) return -1;
+  int lh = black_height(l);
+  int rh = black_height(r);
+  if (lh < 0 || rh < 0 || lh != rh) return -1;
+  return lh + (n->color == RBColor::Black ? 1 : 0);
+}
+
+template <class Key, class Value, class Compare>
+bool PRBT<Key, Value, Compare>::validate() const {
+  if (!root) return true;
+  if (root->color != RBColor::Black) return false;
+  return black_height(root.get()) > 0;
+}
+
+// ---------------------------------------------------------------- bulk build
+
+template <class Key, class Value, class Compare>
+template <class KeyAt, class ValueAt>
+typename PRBT<Key, Value, Compare>::link PRBT<Key, Value, Compare>::build_range(
+        int lo, int hi, int depth, int red_depth, KeyAt& key_at, ValueAt& value_at) const {
+  if (lo > hi) return link();
+  int mid = lo + (hi - lo) / 2;
+  link l = build_range(lo, mid - 1, depth + 1, red_depth, key_at, value_at);
+  link r = build_range(mid + 1, hi, depth + 1, red_depth, key_at, value_at);
+  RBColor c = (depth == red_depth) ? RBColor::Red : RBColor::Black;
+  return make(c, l, key_at(mid), value_at(mid), r);
+}
+
+template <class Key, class Value, class Compare>
+template <class KeyAt, class ValueAt>
+void PRBT<Key, Value, Compare>::build_from_sorted(int n, KeyAt key_at, ValueAt value_at) {
+  root.reset();
+  if (n <= 0) return;
+  int h = 0;                      // floor(log2 n), see RBT::build_from_sorted
+  while ((2LL << h) <= n) h++;
+  root = build_range(0, n - 1, 0, (h > 0) ? h : -1, key_at, value_at);
+}
+
+// ---------------------------------------------------------------- iteration
+
+template <class Key, class Value, class Compare>
+void PRBT<Key, Value, Compare>::const_iterator::push_left(const node_type* n) {
+  while (n != NULL) {
+    path.push_back(n);
+    n = n->left.get();
+  }
+}
+
+template <class Key, class Value, class Compare>
+typename PRBT<Key, Value, Compare>::const_iterator&
+PRBT<Key, Value, Compare>::const_iterator::operator++() {
+  const node_type* cur = path.back();
+  path.pop_back();
+  push_left(cur->right.get());
+  return *this;
+}
+
+template <class Key, class Value, class Compare>
+typename PRBT<Key, Value, Compare>::const_iterator PRBT<Key, Value, Compare>::begin() const {
+  const_iterator it;
+  it.push_left(root.get());
+  return it;
+}
+
+// descend as select does, keeping every ancestor we leave through its left
+// side: those are exactly the nodes that come after pos in order
+template <class Key, class Value, class Compare>
+typename PRBT<Key, Value, Compare>::const_iterator PRBT<Key, Value, Compare>::iterator_at(int pos) const {
+  const_iterator it;
+  if (pos < 0 || pos >= size()) return it;
+  const node_type* c = root.get();
+  while (c != NULL) {
+    int ls = size_of(c->left);
+    if (pos < ls) {
+      it.path.push_back(c);
+      c = c->left.get();
+    } else if (pos == ls) {
+      it.path.push_back(c);
+      break;
+    } else {
+      pos -= ls + 1;
+      c = c->right.get();
+    }
+  }
+  return it;
+}
+
+#endif // PRBT_H__
@@ -4,55 +4,182 @@
 #include <vector>
 #include <string>
 #include <memory>
+#include <functional>
+#include <type_traits>
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include "NodePool.h"
 
 using namespace std;
 
 // A red–black tree augments a BST with a color bit and rebalancing rules
-// to ensure O(log n) height. This header keep consistent with BST.h format 
+// to ensure O(log n) height. This header keep consistent with BST.h format
 // so we can upgrade incrementally.
+//
+// The tree is a class template over the key, an optional payload stored next
+// to each key, and the comparator that orders keys (std::less by default).
+// RBT<int> is the plain integer tree the project started with. The method
+// bodies live in RBT_impl.h, included at the bottom of this header.
 
 // color of a node in the red–black tree.
-// reference: 
+// reference:
 // https://www.geeksforgeeks.org/cpp/enum-classes-in-c-and-their-advantage-over-enum-datatype/
-enum class RBColor { Red, Black };
+enum class RBColor : unsigned char { Red, Black };
+
+// payload type for trees that only store keys
+struct rb_no_value {};
+
+// how a tree stores keys that compare equal.
+// Nodes:   every insert gets its own node (the original multiset).
+// Counted: one node per distinct key with an occurrence count; inserting an
+//          equal key bumps the count and remove only unlinks the node when
+//          the count drops to zero. Heavily tied keys then cost one node.
+enum class RBDuplicates { Nodes, Counted };
 
 // rb_node is the red–black tree node structure.
+template <class Key, class Value = rb_no_value>
 struct rb_node {
-  int data;            // key (same as BST)
+  Key data;            // key (same as BST)
+  Value value;         // payload carried with the key
   RBColor color;       // Red or Black
+  unsigned char blacks;  // black height of either child (NULL = 1); see RBT::track_changes
   rb_node* parent;     // parent pointer (for rotations/fixups)
   rb_node* left;
   rb_node* right;
+  int size;            // number of keys in the subtree rooted here (self included)
+  int count;           // copies of data held by this node (always 1 unless Counted)
+};
+
+// result of RBT::rank: how many keys in the tree are less than, equal to,
+// and greater than a given key. less + equal + greater == tree size.
+struct rb_rank {
+  int less;
+  int equal;
+  int greater;
 };
 
+// node memory used by one RBT, in nodes and in bytes (slab cell size).
+struct rb_mem_stats {
+  size_t live_nodes;      // nodes currently in the tree
+  size_t peak_nodes;      // most nodes ever live at once
+  size_t live_bytes;
+  size_t peak_bytes;
+  size_t reserved_bytes;  // slab memory held, live or on the free list
+};
+
+// Keys a and b are "equal" when neither orders before the other under
+// Compare, so the tree never needs operator== on the key type.
+template <class Key, class Value = rb_no_value, class Compare = std::less<Key> >
 class RBT {
 public:
-  // Constructor and deconstructor same as BST
-  RBT();
+  typedef rb_node<Key, Value> node_type;
+  typedef NodePool<node_type> pool_type;
+
+  // Constructor and deconstructor same as BST.
+  // The destructor releases every node at once by freeing the slabs.
+  // dup picks how equal keys are stored (see RBDuplicates).
+  explicit RBT(const Compare& comp = Compare(), RBDuplicates dup = RBDuplicates::Nodes);
+  // a tree whose nodes come from a pool it shares with other trees (see
+  // node_pool). Trees on one pool hand nodes to each other in O(1) with
+  // join, split_at and unite. They must not be changed from two threads at
+  // once, and destroying or clearing one frees its nodes one by one.
+  RBT(shared_ptr<pool_type> shared, const Compare& comp = Compare(),
+      RBDuplicates dup = RBDuplicates::Nodes);
   ~RBT();
 
-  // init_node initializes a new rb_node from the heap using the given data.
-  // new nodes are created RED.
-  rb_node* init_node(int data);
+  // the pool this tree allocates from, to build sibling trees on
+  shared_ptr<pool_type> node_pool() const { return pool; }
+
+  // swap exchanges the contents (and pools) of two trees in O(1)
+  void swap(RBT& other);
+
+  // nodes point into this tree's slabs, so a tree cannot be copied
+  RBT(const RBT&) = delete;
+  RBT& operator=(const RBT&) = delete;
+
+  // init_node initializes a new node from the tree's node pool using the
+  // given key and payload. new nodes are created RED.
+  node_type* init_node(const Key& data, const Value& value = Value());
 
   // insert an existing node pointer into the tree, then
-  // run red–black rebalancing.
-  void insert(rb_node* new_node);
+  // run red–black rebalancing. new_node must come from init_node, because
+  // remove() hands removed nodes back to the pool. In Counted mode a node
+  // whose key is already present goes straight back to the pool.
+  void insert(node_type* new_node);
 
-  // insert_data creates a new node with the given data value and inserts it
-  // into the tree.
-  void insert_data(int data);
+  // insert_data creates a new node with the given key (and payload) and
+  // inserts it into the tree. Equal keys are kept (multiset). In Counted mode
+  // an equal key only increments the existing node's count (its payload is
+  // kept and value is ignored).
+  void insert_data(const Key& data, const Value& value = Value());
 
   // remove the node Using the standard BST delete with successor replacement, then red–black fixups.
-  void remove(int data);
+  // The removed node goes back on the pool's free list for the next insert.
+  // In Counted mode one copy is removed: the node is only unlinked once its
+  // count reaches zero.
+  void remove(const Key& data);
+
+  // true if the tree was built with RBDuplicates::Counted
+  bool counts_duplicates() const { return dup == RBDuplicates::Counted; }
+
+  // clear empties the tree and returns all slabs to the system (on a
+  // shared pool: its nodes, to the pool).
+  void clear();
+
+  // build_from_sorted replaces the contents with n keys that are already in
+  // tree order: key_at(i) / value_at(i) give the i-th key and payload. The
+  // tree is built bottom-up by splitting at the middle in O(n), with no
+  // descents or fix-ups. Nodes above the deepest level are BLACK and the
+  // deepest level is RED, which satisfies every red–black rule.
+  // In Counted mode runs of equal keys become one node (first payload wins).
+  template <class KeyAt, class ValueAt>
+  void build_from_sorted(int n, KeyAt key_at, ValueAt value_at);
+  void build_from_sorted(const vector<Key>& sorted_keys);
+
+  // join / split: whole-tree operations that cut and glue trees along a
+  // spine instead of moving keys one insert at a time. Every result passes
+  // validate(). Between trees on one pool (the shared-pool constructor)
+  // nodes change trees as they are, so the costs below are the whole cost.
+  // A tree on another pool is handed over the cheap way round: the smaller
+  // side is copied into the other pool (reusing freed cells), or a larger
+  // side whose pool has no other user has its slabs taken over whole
+  // (NodePool::adopt): O(min(m, n)) on top.
+  //
+  // join appends key and then every key of right to this tree. Keys must
+  // not decrease across the seam: this tree's keys, then key, then right's.
+  // right is left empty. O(log n).
+  void join(const Key& key, RBT& right, const Value& value = Value());
+
+  // split_at moves every key that does not order before key to right
+  // (emptied first); this tree keeps the keys that order before it. K may be
+  // anything Compare orders against Key (as for rank), so a tree of
+  // composite keys can be split at a bare score with all its ties on one
+  // side. O(log n).
+  template <class K>
+  void split_at(const K& key, RBT& right);
+
+  // unite moves every key of other into this tree (other is left empty);
+  // in Counted mode equal keys add up their counts. difference removes every
+  // key that other holds, all copies of it. unite splits the larger tree at
+  // the keys of the smaller, difference this tree at other's, and the pieces
+  // are joined back: O(m log(n/m + 1)) for sizes m <= n, against O(m log n)
+  // for m single inserts or removes. Two trees whose key ranges do not
+  // overlap are united with one join.
+  void unite(RBT& other);
+  void difference(const RBT& other);
 
-   // same as BST 
-  bool contains(rb_node* subt, int data) const;
-  rb_node* get_node(rb_node* subt, int data) const;
-  int size(rb_node* subt) const;
-  void to_vector(rb_node* subt, vector<int>& vec) const; // inorder
-  rb_node* get_root();
-  void set_root(rb_node** new_root);
+  // node memory accounting (live, peak and reserved). With a shared pool
+  // the numbers are the whole pool's.
+  rb_mem_stats mem_stats() const;
+
+   // same as BST
+  bool contains(node_type* subt, const Key& data) const;
+  node_type* get_node(node_type* subt, const Key& data) const;
+  int size(node_type* subt) const;  // O(1), keys (not nodes) in the subtree
+  void to_vector(node_type* subt, vector<Key>& vec) const; // inorder, count copies per node (no recursion)
+  node_type* get_root() const;
+  void set_root(node_type** new_root);
 
   // verify all red–black invariants(for testing).
   // returns true if:
@@ -63,17 +190,159 @@ public:
   //  5) Every path from a node to descendant leaves has same black-height
   bool validate() const;
 
-  void RBTreeRotateLeft(rb_node* n);
-  
-  void RBTreeRotateRight(rb_node* n);
+  // incremental checking, cheap enough to leave on after every update.
+  // With track_changes(true) the tree logs the nodes each insert/remove
+  // touches: the inserted (or removed) position and every rotation of the
+  // fix-up. validate_changes() then re-checks only those nodes, their
+  // ancestors and the tops of the unchanged subtrees beside them: subtree
+  // counts, parent links, red–red edges and equal black height. Every node
+  // caches the black height below it (rb_node::blacks), so an unchanged
+  // subtree's height is read off its top instead of walking down it: O(log n)
+  // nodes per update, all on paths the update itself just walked, instead of
+  // validate()'s n. The log is emptied, so each call covers the updates
+  // since the previous one. After clear(), build_from_sorted(), turning
+  // tracking on or a log of more than kMaxChanged nodes it does one full
+  // check instead, which also refreshes every cached height.
+  void track_changes(bool on);
+  bool validate_changes();
+
+  // order statistics, answered from the subtree counts in O(log n).
+  // rank counts the keys less than, equal to and greater than data.
+  // K may be any type Compare can order against Key (e.g. a bare score
+  // against a composite key), which lets a whole group of keys count as
+  // "equal".
+  template <class K>
+  rb_rank rank(const K& data) const;
+
+  // select returns the node holding the k-th smallest key (0-based, inorder
+  // position), or NULL if k is out of range.
+  node_type* select(int k) const;
+
+  // inorder navigation through the parent pointers, NULL past either end.
+  node_type* first() const;
+  node_type* last() const;
+  static node_type* successor(node_type* n);
+  static node_type* predecessor(node_type* n);
+
+  // const_iterator walks the nodes in key order through the parent
+  // pointers: no stack, no recursion and O(1) extra memory, so a caller can
+  // stream a huge tree and stop anywhere. Like PRBT's iterator, *it is the
+  // node (it->data, it->value); in Counted mode one node stands for
+  // it->count equal keys. A bidirectional iterator, so the tree works with
+  // range-for, std::ranges algorithms and std::reverse_iterator.
+  // Inserting or removing other keys keeps an iterator valid; removing its
+  // own node invalidates it.
+  class const_iterator {
+  public:
+    typedef std::bidirectional_iterator_tag iterator_category;
+    typedef std::bidirectional_iterator_tag iterator_concept;
+    typedef node_type value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const node_type* pointer;
+    typedef const node_type& reference;
+
+    const_iterator() : tree(NULL), n(NULL) {}
+    const node_type& operator*() const { return *n; }
+    const node_type* operator->() const { return n; }
+    const_iterator& operator++() {
+      n = successor(n);
+      return *this;
+    }
+    const_iterator operator++(int) {
+      const_iterator was = *this;
+      ++*this;
+      return was;
+    }
+    // stepping back from end() lands on the last node
+    const_iterator& operator--() {
+      n = (n == NULL) ? tree->last() : predecessor(n);
+      return *this;
+    }
+    const_iterator operator--(int) {
+      const_iterator was = *this;
+      --*this;
+      return was;
+    }
+    bool operator==(const const_iterator& o) const { return n == o.n; }
+    bool operator!=(const const_iterator& o) const { return n != o.n; }
+
+  private:
+    friend class RBT;
+    const_iterator(const RBT* t, node_type* at) : tree(t), n(at) {}
+    const RBT* tree;   // for --end()
+    node_type* n;      // NULL at end()
+  };
+  typedef const_iterator iterator;   // keys are never changed in place
+  typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+  typedef const_reverse_iterator reverse_iterator;
+
+  const_iterator begin() const { return const_iterator(this, first()); }
+  const_iterator end() const { return const_iterator(this, NULL); }
+  const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+  const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+  // lower_bound: the first node whose key is not less than data;
+  // upper_bound: the first node whose key is greater than data. end() if
+  // there is none. O(log n); K is anything Compare orders against Key, as
+  // for rank.
+  template <class K>
+  const_iterator lower_bound(const K& data) const;
+  template <class K>
+  const_iterator upper_bound(const K& data) const;
+
+  void RBTreeRotateLeft(node_type* n);
+
+  void RBTreeRotateRight(node_type* n);
 
 private:
   // same as BST
-  rb_node** root;
-  
+  node_type** root;
+  node_type** own_root;       // the root slot allocated by the constructor
+  shared_ptr<pool_type> pool;   // slabs that every node of this tree lives in
+  Compare comp;
+  RBDuplicates dup;
+
+  static const size_t kMaxChanged = 256;
+  bool track;                   // log touched nodes for validate_changes
+  bool changed_all;             // the log overflowed: next check is validate()
+  vector<node_type*> changed;   // nodes touched since the last validate_changes
+  vector<node_type*> changed_region;  // validate_changes scratch space
+  void note_change(node_type* n);
+  void forget_change(node_type* n);
 
-  void RBTreeInsert(rb_node* n);
-  void RBTreeRemove(rb_node* n);
+  void RBTreeInsert(node_type* n);
+  void RBTreeRemove(node_type* n);
+  void destroy_nodes();
+  // red–red repair after a red node z is linked in (insert and join)
+  void insert_fixup(node_type* z);
+
+  // join / split on detached subtrees of this tree's pool. h arguments are
+  // black heights (black nodes on a path down from the root, NULL = 0); every
+  // result root has no parent.
+  node_type* join_nodes(node_type* l, int hl, node_type* k, node_type* r, int hr, int& h);
+  node_type* join_pair(node_type* l, int hl, node_type* r, int hr, int& h);
+  node_type* split_last(node_type* t, int h, node_type*& rest, int& hrest);
+  template <class Pred>
+  void split_nodes(node_type* t, int h, Pred& goes_left,
+                   node_type*& l, int& hl, node_type*& r, int& hr);
+  node_type* union_nodes(node_type* a, int ha, node_type* b, int hb, int& h);
+  node_type* difference_nodes(node_type* t, int ht, const node_type* other, int& h);
+  // free every node of a detached subtree / copy one into this tree's pool
+  void destroy_subtree(node_type* n);
+  node_type* clone_subtree(node_type* src);
+  // other's nodes, in this pool (as they are, copied or adopted); other is emptied
+  node_type* take_nodes(RBT& other);
+  // install t as the whole tree after a join or split
+  void set_top(node_type* t);
+
+  template <class KeyAt, class ValueAt, class CountAt>
+  node_type* build_range(int lo, int hi, int depth, int red_depth,
+                         KeyAt& key_at, ValueAt& value_at, CountAt& count_at);
 };
 
-  #endif // RBT_H__
\ No newline at end of file
+#include "RBT_impl.h"
+
+// the integer tree is instantiated once, in RBT.cpp
+extern template class RBT<int>;
+
+  #endif // RBT_H__
@@ -0,0 +1,1922 @@
+/*Plese refer to the header file (RBT.h) for documentation of each method. */
+
+// Template definitions for RBT, included from the bottom of RBT.h. Do not
+// include this file directly.
+#ifndef RBT_IMPL_H__
+#define RBT_IMPL_H__
+
+/*==============================================
+This file implements a standard Red–Black tree while
+keeping the same structure and naming style as BST we've implemented before.
+
+1) A red–black tree is a BST with extra coloring rules
+    that keep the tree height ~log2(N) (so it stays fast).
+2) New nodes start Red. The root must be Black.
+3) There can never be two Red nodes in a row (parent+child).
+4) Every path from a node to a NULL leaf has the same number
+    of Black nodes (black height).
+  5) After insert/remove, we "fix up" the tree using rotations
+    and recoloring to restore these properties.*/
+
+
+
+
+template <class Key, class Value, class Compare>
+RBT<Key, Value, Compare>::RBT(const Compare& c, RBDuplicates d)
+    : RBT(make_shared<pool_type>(), c, d) {}
+
+template <class Key, class Value, class Compare>
+RBT<Key, Value, Compare>::RBT(shared_ptr<pool_type> shared, const Compare& c, RBDuplicates d)
+    : pool(std::move(shared)), comp(c), dup(d), track(false), changed_all(false) {
+    // double pointer, same as BST
+    root = new node_type*;
+    *root = NULL;
+    own_root = root;
+}
+
+// dropping the slabs frees every node at once; keys or payloads that own
+// memory (e.g. strings) are destroyed first. A shared pool keeps its slabs
+// for the other trees, so each node goes back on its free list instead.
+template <class Key, class Value, class Compare>
+RBT<Key, Value, Compare>::~RBT() {
+    destroy_nodes();
+    if (pool.use_count() == 1) {
+        pool->release();
+    }
+    delete own_root;
+}
+
+template <class Key, class Value, class Compare>
+void RBT<Key, Value, Compare>::swap(RBT& other) {
+    std::swap(root, other.root);
+    std::swap(own_root, other.own_root);
+    std::swap(pool, other.pool);
+    std::swap(comp, other.comp);
+    std::swap(dup, other.dup);
+    changed.clear();
+    other.changed.clear();
+    changed_all = true;   // neither log describes the tree it now sits next to
+    other.changed_all = true;
+}
+
+template <class Key, class Value, class Compare>
+void RBT<Key, Value, Compare>::destroy_nodes() {
+    if (std::is_trivially_destructible<node_type>::value && pool.use_count() == 1) {
+        if (root != NULL) {
+            *root = NULL;
+        }
+        return;                 // nothing to run, the slabs just go away
+    }
+    // walk the tree without a stack: descend, then destroy leaves on the way up
+    node_type* n = (root != NULL) ? *root : NULL;
+    while (n != NULL) {
+        if (n->left != NULL) {
+            n = n->left;
+        }
+        else if (n->right != NULL) {
+            n = n->right;
+        }
+        else {
+            node_type* p = n->parent;
+            if (p != NULL) {
+                if (p->left == n) p->left = NULL;
+                else p->right = NULL;
+            }
+            pool->destroy(n);
+            n = p;
+        }
+    }
+    if (root != NULL) {
+        *root = NULL;
+    }
+}
+
+template <class Key, class Value, class Compare>
+void RBT<Key, Value, Compare>::clear() {
+    destroy_nodes();
+    if (pool.use_count() == 1) {
+        pool->release();
+    }
+    if (root != NULL){
+        *root = NULL;
+    }
+    changed.clear();
+    changed_all = true;   // the next incremental check looks at everything
+}
+
+template <class Key, class Value, class Compare>
+rb_mem_stats RBT<Key, Value, Compare>::mem_stats() const {
+    rb_mem_stats m;
+    size_t nb = NodePool<node_type>::node_bytes();
+    m.live_nodes = pool->live_nodes();
+    m.peak_nodes = pool->peak_nodes();
+    m.live_bytes = m.live_nodes * nb;
+    m.peak_bytes = m.peak_nodes * nb;
+    m.reserved_bytes = pool->reserved_nodes() * nb;
+    return m;
+}
+
+// --------------------------- helper functions --------------------------
+
+// color_of return the color of a node
+template <class N>
+inline RBColor color_of(const N* n) {
+    if (n != NULL) {
+        return n->color;
+    } 
+    else {
+        return RBColor::Black; // null leaf treated as black
+    }
+}
+
+// rb_is_red returns true if node is red
+template <class N>
+inline bool rb_is_red(const N* n){
+    if (color_of(n) == RBColor::Red) return true;
+    return false;
+}
+
+// rb_is_black returns true if node is black
+template <class N>
+inline bool rb_is_black(const N* n){
+    if (color_of(n) == RBColor::Black) return true;
+    return false;
+}
+
+// set_color sets node color
+template <class N>
+inline void set_color(N* n, RBColor c){
+    if (n != NULL) {
+        n->color = c;
+    }
+}
+
+// rb_size returns the subtree key count of a node (0 for a null leaf)
+template <class N>
+inline int rb_size(const N* n){
+    if (n == NULL) return 0;
+    return n->size;
+}
+
+// rb_update_size recomputes n's subtree count from its children
+template <class N>
+inline void rb_update_size(N* n){
+    if (n != NULL) {
+        n->size = n->count + rb_size(n->left) + rb_size(n->right);
+    }
+}
+
+// rb_minimum returns the minimum (left-most) node in a subtree.
+template <class N>
+N* rb_minimum(N* n) {
+    while (n != NULL && n->left != NULL) {
+        n = n->left;
+    }
+    return n;;
+}
+
+// rb_transplant replaces subtree rooted at u with subtree v (u's parent now points to v).
+// also updates v->parent. If u was the root, updates *root_pp.
+template <class N>
+void rb_transplant(N** root_pp, N* u, N* v) {
+    if (root_pp == NULL || u == NULL) return;
+
+    if (u->parent == NULL) {
+        *root_pp = v;
+    } 
+    else if (u == u->parent->left) {
+        u->parent->left = v;
+    } 
+    else {
+        u->parent->right = v;
+    }
+    if (v != NULL) {
+        v->parent = u->parent;
+    }
+}
+// --------------------------------------------------------------
+
+
+// init_node initializes a RB node with Red color, taking memory from the pool
+template <class Key, class Value, class Compare>
+typename RBT<Key, Value, Compare>::node_type* RBT<Key, Value, Compare>::init_node(const Key& data, const Value& value) {
+  node_type* n = pool->create();
+  n -> data  = data;
+  n -> value = value;
+  n -> color = RBColor::Red;
+  n -> blacks = 1;
+  n -> parent = NULL;
+  n -> left = NULL;
+  n -> right = NULL;
+  n -> size = 1;
+  n -> count = 1;
+  return n;
+}
+
+// get root and set root
+template <class Key, class Value, class Compare>
+typename RBT<Key, Value, Compare>::node_type* RBT<Key, Value, Compare>::get_root() const {
+  if (root == NULL) return NULL;
+  return *root;
+}
+template <class Key, class Value, class Compare>
+void RBT<Key, Value, Compare>::set_root(node_type** new_root) {
+  root = new_root;
+  changed.clear();
+  changed_all = true;
+}
+
+// ----------------------------------------------------------------------------
+// Rotations(Left and Right)
+// ----------------------------------------------------------------------------
+template <class Key, class Value, class Compare>
+void RBT<Key, Value, Compare>::RBTreeRotateLeft(node_type* node){
+    if (node == NULL){                // nothing to rotate
+        return;
+    }
+    node_type* r = node -> right;      // rightchild
+    if (r  == NULL){
+        return;                      // cannot rotate left without right child
+    } 
+
+    // move r->left to node->right
+    node -> right = r -> left;
+    if (r -> left != NULL) {
+        r -> left -> parent = node; //fix parent pointer
+    }
+    // link r to node's old parent
+    r -> parent = node -> parent;
+    if (node->parent == NULL) {
+    // node was root, rightchild now becomes root
+        *root = r;
+    }
+    else if(node == node -> parent -> left){
+        node -> parent -> left = r;
+    }
+    else{
+        node -> parent -> right = r;
+    }
+    // put node under r->left
+    r -> left = node;
+    node -> parent = r;
+
+    // r takes over node's whole subtree, node loses r and r's right side
+    r -> size = node -> size;
+    rb_update_size(node);
+    note_change(node);          // r is its parent now, so r is covered too
+}
+
+// mirroring RBTreeRotateLeft
+template <class Key, class Value, class Compare>
+void RBT<Key, Value, Compare>::RBTreeRotateRight(node_type* node){
+    if (node == NULL){
+        return;
+    }
+    node_type* l = node -> left;         // leftchild
+    if (l == NULL){
+        return;                       // cannot rotate right without left child
+    } 
+    // move l->right to node->left
+    node -> left = l -> right;
+    if (l -> right != NULL) {
+        l -> right -> parent = node; // fix parent pointer of the moved subtree
+    }
+    // link l up to node's old parent
+    l -> parent = node -> parent;
+    if (node -> parent == NULL){
+        *root = l;
+    } 
+    else if (node == node->parent->right) {
+        node -> parent -> right = l;
+    } 
+    else {
+        node -> parent -> left = l;
+    }
+
+    // put node under l->right
+    l -> right = node;
+    node -> parent = l;
+
+    // l takes over node's whole subtree, node loses l and l's left side
+    l -> size = node -> size;
+    rb_update_size(node);
+    note_change(node);
+}
+
+
+// ----------------------------------------------------------------------------
+// insert (BST insert + red–black rebalancing)
+// 1) Do a normal BST insert same as BST to place the new node.
+// 2) New node starts with Red. If this creates violations, we run
+//    the fix-up(rebalancing) loop to repair colors and/or rotate.
+// ----------------------------------------------------------------------------
+template <class Key, class Value, class Compare>
+void RBT<Key, Value, Compare>::insert(node_type* z){
+    if (z == NULL){
+        return;                     // ignore null input
+    }
+    z->size = 1;
+    z->count = 1;
+
+    // regular BST insert(same as BST)
+
+    // empty tree, the first node becomes root
+    if (*root == NULL){
+        *root = z;
+        z->color = RBColor::Black;  // root must be black
+        note_change(z);
+        return;
+    }
+
+    node_type* y = NULL;              // parent of z
+    node_type* x = *root;             // walking cursor
+
+    bool counted = (dup == RBDuplicates::Counted);
+    while (x != NULL){
+        y = x;                      // last non-null
+        x -> size++;                // z will end up below x
+        if (comp(z -> data, x -> data)){
+            x = x -> left;          // go left
+        }
+        else if (counted && !comp(x -> data, z -> data)){
+            // equal key in Counted mode: x takes the copy, z is not needed
+            x -> count++;
+            pool->destroy(z);
+            note_change(x);
+            return;
+        }
+        else{
+            x = x -> right;        // go right
+        }
+    }
+    z -> parent = y;              // attach parent
+    if (comp(z -> data, y -> data)){
+        y -> left = z;            // attach as left child
+    }
+    else{
+        y->right = z;             // attach as right child
+    }
+    note_change(z);               // z and its ancestors: the path whose sizes grew
+
+    insert_fixup(z);
+
+    // check root is black
+    if (*root != NULL) {
+        set_color(*root, RBColor::Black);
+    }
+}
+
+// insert fix-up(rebalance): z is RED and may sit under a RED parent. The
+// loop stops once no red node has a red parent; the caller paints the root
+// black.
+template <class Key, class Value, class Compare>
+void RBT<Key, Value, Compare>::insert_fixup(node_type* z){
+    // for this critical process, I referenced algorithms from GeeksforGeeks 
+    // and adjusted them to align with BST structure
+    // reference: 
+    // https://www.geeksforgeeks.org/cpp/red-black-tree-in-cpp/
+    //..............................................................................
+
+    while (z != *root && z->parent != NULL && rb_is_red(z->parent)) {
+        node_type* parent = z->parent;
+        node_type* grand = NULL;
+        if (parent != NULL) {
+            grand = parent->parent;
+        }
+        if (grand == NULL) {
+            break;               // no grandparent, no fix needed
+        }
+
+        // case: parent is left child of grandparent → uncle is grandparent->right
+        if (parent == grand->left) {
+            node_type* uncle = grand->right;
+            // if uncle is red, recolor parent and uncle to black,
+            // grand parent to red
+            if (rb_is_red(uncle)) {
+                set_color(parent, RBColor::Black);
+                set_color(uncle,  RBColor::Black);
+                set_color(grand,  RBColor::Red);
+                z = grand;       // continue fixing up from grand
+            } 
+            else { // uncle is black
+                // if left-right structure, rotate parent left
+                if (z == parent->right) {
+                    z = parent;         // move z up
+                    RBTreeRotateLeft(z);// rotate z   
+                    parent = z->parent; // reassign parent and grandparent
+                    grand = NULL;
+                        if (parent != NULL) {
+                            grand = parent->parent;
+                        }
+                }
+                // if left-left structure, recolor and rotate grandparent
+                if (parent != NULL && grand != NULL) {
+                    set_color(parent, RBColor::Black);
+                    set_color(grand,  RBColor::Red);
+                    RBTreeRotateRight(grand);
+                }
+            }
+        } 
+        else { // case: parent is right child of grandparent, uncle is the left child
+            node_type* uncle = grand->left;
+
+            if (rb_is_red(uncle)) { // uncle red: recolor and move up
+                set_color(parent, RBColor::Black);
+                set_color(uncle,  RBColor::Black);
+                set_color(grand,  RBColor::Red);
+                z = grand;
+            } 
+            else { // right-left structure, rotate parent
+                if (z == parent->left) {
+                    z = parent;
+                    RBTreeRotateRight(z);
+                    parent = z->parent;
+                    grand = NULL;
+                        if (parent != NULL) {
+                            grand = parent->parent;
+                        }
+                } // right-right structure, recolor and rotate grandparent
+                if (parent != NULL && grand != NULL) {
+                    set_color(parent, RBColor::Black);
+                    set_color(grand,  RBColor::Red);
+                    RBTreeRotateLeft(grand);
+                }
+            }
+        }   
+    }
+}
+
+// same as BST insert_data
+template <class Key, class Value, class Compare>
+void RBT<Key, Value, Compare>::insert_data(const Key& data, const Value& value) {
+  node_type* n = init_node(data, value);
+  insert(n);
+}
+
+// ---------------------------- Remove ------------------------------------
+//
+// I referenced the Zybooks's 6 cases as small helpers named from 
+// RBTreeTryCase1 to RBTreeTryCase6, each returning true if it finishes the fix,
+// or false to allow the main loop to continue.
+//
+//variables in helper functions:
+// root_pp:root pointer pointer (address of the tree's root pointer).
+//         We pass this so rotations inside helpers can update the root.    
+// x:the node that currently carries the "double black".          
+// xp:the parent of x 
+// 
+//
+//   Case1: x is root: stop
+//   Case2: sibling red: rotate parent to make sibling black
+//   Case3: parent black, sibling black, sibling's children black: recolor sibling red; x=parent
+//   Case4: parent red, sibling black, sibling's children black: recolor sibling red + parent black,stop
+//   Case5: sibling black, near child red,  far child black: rotate sibling (to convert to case6)
+//   Case6: sibling black, far child red: rotate parent, recolor, stop
+
+// Case1: x is the root, color it black and stop
+template <class N>
+bool RBTreeTryCase1(N** root_pp, N*& x, N*& xp){
+    N* r = NULL;
+    if (root_pp != NULL){
+        r = *root_pp;
+    }
+    if (x == r) {
+        if (x != NULL){
+            x->color = RBColor::Black;
+        } 
+        return true; // fixed
+    }
+    return false;
+}
+
+// Case2: sibling is red: rotate parent and recolor sibling black
+template <class Tree, class N>
+bool RBTreeTryCase2(Tree* t, N** root_pp, N*& x, N*& xp){
+    (void)root_pp;  // avoid compiler warning
+
+    N* p;
+    if (x != NULL){
+        p = x->parent;
+    } else{
+        p = xp;
+    } 
+    if (p == NULL){
+        return false;
+    }
+
+    bool x_is_left = false;
+    if (x == p->left){
+        x_is_left = true;
+    } 
+
+    N* s; // sibling
+    if (x_is_left){
+        s = p->right;
+    }
+    else{
+        s = p->left;
+    } 
+
+    if (rb_is_red(s)) {
+        set_color(s, RBColor::Black);  // make sibling black
+        set_color(p, RBColor::Red);    // parent becomes red
+        if (x_is_left){
+            t->RBTreeRotateLeft(p);    // rotate to move black sibling up
+        }
+        else{
+            t->RBTreeRotateRight(p);
+        }
+
+        // after rotation, x's parent may change
+        if (x != NULL){
+            xp = x->parent;
+        }
+        else{
+            xp = p;
+        }
+    }
+    return false;                    // continue with later cases
+}
+
+// Case3: parent black, sibling black, both sibling's children black,
+//        color sibling red and move x up to parent.
+template <class N>
+bool RBTreeTryCase3(N*& x, N*& xp){
+    N* p;
+    if (x != NULL){
+        p = x->parent;
+    } 
+    else{
+        p = xp;
+    }
+    if (p == NULL){
+        return false;
+    }
+
+    bool x_is_left = false;
+    if (x == p->left){
+        x_is_left = true;
+    }
+
+    N* s;
+    if (x_is_left){
+        s = p->right;
+    }
+    else{
+        s = p->left;
+    }
+
+    N* nearc = NULL;  // child of s towards x
+    N* farc  = NULL;  // child of s away from x
+    if (x_is_left) {
+        if (s != NULL){
+            nearc = s->left;
+        }
+        if (s != NULL){
+            farc  = s->right;
+        }
+    } 
+    else {
+        if (s != NULL){
+            nearc = s->right;
+        }
+        if (s != NULL){
+            farc  = s->left;
+        }
+    }
+
+    bool cond_parent_black = rb_is_black(p);
+    bool cond_s_black      = rb_is_black(s);
+    bool cond_near_black   = rb_is_black(nearc);
+    bool cond_far_black    = rb_is_black(farc);
+
+    if (cond_parent_black && cond_s_black && cond_near_black && cond_far_black) {
+        if (s != NULL){
+            // give one black to sibling by painting it RED
+            s->color = RBColor::Red; 
+        }
+        x  = p;                 // move double-black up
+        if (x != NULL){
+            xp = x->parent;
+         }
+        else{
+            xp = NULL;
+        }
+        return true;            // continue loop with new x
+    }
+    return false;
+}
+
+// Case4: parent red, sibling black, sibling's children BLACK: 
+//        recolor parent and sibling, and stop
+template <class N>
+bool RBTreeTryCase4(N*& x, N*& xp){
+    N* p;
+    if (x != NULL){
+        p = x->parent;
+    }
+    else{
+        p = xp;
+    }
+    if (p == NULL){
+        return false;
+    }
+
+    bool x_is_left = false;
+    if (x == p->left){
+        x_is_left = true;
+    }
+
+    N* s;
+    if (x_is_left){
+        s = p->right;
+    }
+    else{
+        s = p->left;
+    }           
+
+    N* nearc = NULL;
+    N* farc  = NULL;
+    if (x_is_left) {
+        if (s != NULL){
+            nearc = s->left;
+        }
+        if (s != NULL){
+            farc  = s->right;
+        }
+    }     
+    else {
+        if (s != NULL){
+            nearc = s->right;
+        }
+        if (s != NULL){
+            farc  = s->left;
+        }
+    }
+
+    bool cond_parent_red  = rb_is_red(p);
+    bool cond_s_black     = rb_is_black(s);
+    bool cond_near_black  = rb_is_black(nearc);
+    bool cond_far_black   = rb_is_black(farc);
+
+    if (cond_parent_red && cond_s_black && cond_near_black && cond_far_black) {
+        if (s != NULL){
+            s->color = RBColor::Red;  // sibling becomes red
+        }
+        p->color = RBColor::Black;    // parent becomes black
+        return true;                  // fixed
+    }
+    return false;
+}
+
+// Case5: sibling black, near child red, far child black: 
+//        rotate sibling (prep for case 6)
+template <class Tree, class N>
+bool RBTreeTryCase5(Tree* t, N*& x, N*& xp) {
+    N* p;
+    if (x != NULL){
+        p = x->parent;
+    }
+    else{
+        p = xp;
+    }
+    if (p == NULL){
+        return false;
+    }
+
+    bool x_is_left = false;
+    if (x == p->left){
+        x_is_left = true;
+    }
+
+    N* s;
+    if (x_is_left){
+        s = p->right;
+    }
+    else{
+        s = p->left;
+    }           
+
+    N* nearc = NULL;
+    N* farc  = NULL;
+    if (x_is_left) {
+        if (s != NULL){
+            nearc = s->left;
+        }
+        if (s != NULL){
+            farc  = s->right;
+        }
+    } 
+    else {
+        if (s != NULL){
+            nearc = s->right;
+        }
+        if (s != NULL){
+            farc  = s->left;
+        }
+    }
+
+    if (rb_is_black(s) && rb_is_red(nearc) && rb_is_black(farc)) {
+        set_color(nearc, RBColor::Black);   // move black down
+        set_color(s, RBColor::Red);         // sibling becomes red
+        if (x_is_left){
+            t->RBTreeRotateRight(s);        // rotate sibling
+        }
+        else{
+            t->RBTreeRotateLeft(s);
+        }
+    
+    }
+    return false; // not finished, proceeds to Case6
+}
+
+// Case6: sibling black, far child red: rotate parent toward x and recolor
+template <class Tree, class N>
+bool RBTreeTryCase6(Tree* t, N*& x, N*& xp) {
+    N* p;
+    if (x != NULL){
+        p = x->parent;
+    }
+    else{
+        p = xp;
+    }
+    if (p == NULL){
+        return false;
+    }
+
+    bool x_is_left = false;
+    if (x == p->left){
+        x_is_left = true;
+    }
+
+    N* s;
+    if (x_is_left){
+        s = p->right;
+    }
+    else{
+        s = p->left;
+    }
+
+    N* farc = NULL;
+    if (x_is_left) {
+        if (s != NULL){
+            farc = s->right;
+        }
+    } 
+    else {
+        if (s != NULL){
+            farc = s->left;
+        }
+    }
+
+    if (rb_is_black(s) && rb_is_red(farc)) {
+        if (s != NULL){
+            s->color = p->color;            // sibling takes parent color
+        }
+        p->color = RBColor::Black;          // parent becomes black
+        if (farc != NULL){
+            farc->color = RBColor::Black;   // far child becomes black
+        }
+        if (x_is_left){
+            t->RBTreeRotateLeft(p);         // rotate parent
+        }
+        else{
+            t->RBTreeRotateRight(p);
+        }
+        return true;                        // fixed
+    }
+    return false;
+}
+
+//---------------------------RBTreeRemove-----------------------------
+//standard BST removal to remove z, but track the color of the node
+//actually spliced out (y). If a black node was removed, we may need
+//to fix a "double black" using the cases above.
+template <class Key, class Value, class Compare>
+void RBT<Key, Value, Compare>::RBTreeRemove(node_type* z) {
+    if (z == NULL) return;      // nothing to remove
+
+    // BST remove while tracking the removed color ----
+    node_type* y = z;
+    RBColor y_orig = y->color;  // remember original color
+    node_type* x = NULL;          // child that replaces y 
+    node_type* xp = NULL;         // parent of x 
+
+    // one node leaves the tree: every ancestor of the node that is physically
+    // unlinked (z itself, or its successor when z has two children) loses that
+    // node's keys. When the successor moves up into z's place, the nodes above
+    // z only lose z's own keys.
+    node_type* spliced = z;
+    if (z->left != NULL && z->right != NULL) {
+        spliced = rb_minimum(z->right);
+    }
+    int drop = spliced->count;
+    for (node_type* a = spliced->parent; a != NULL; a = a->parent) {
+        a->size -= drop;
+        if (a == z) {
+            drop = z->count;
+        }
+    }
+
+    if (z->left == NULL) {
+        // only right child or none
+        x  = z->right;
+        xp = z->parent;
+        rb_transplant(root, z, z->right);
+    } 
+    else if (z->right == NULL) {
+        // only left child 
+        x  = z->left;
+        xp = z->parent;
+        rb_transplant(root, z, z->left);
+    } 
+    else {
+        // two children, use successor y = min (z -> right)
+        y = rb_minimum(z->right);
+        y_orig = y->color;       // y's color for fix-up
+        x = y->right;            // x takes place
+        if (y->parent == z) {
+            // successor is direct child
+            xp = y;              // x parent becomes y
+            if (x != NULL){
+                x->parent = y;
+            }
+        } 
+        else {
+            // move y's right subtree up
+            xp = y->parent;
+            rb_transplant(root, y, y->right);
+            // put z -> right under y
+            y->right = z->right;
+                if (y->right != NULL){
+                    y->right->parent = y;
+                }
+        }
+        // put y in z place and take z's color
+        rb_transplant(root, z, y);
+        y->left = z->left;
+        if (y->left != NULL){
+            y->left->parent = y;
+        }
+        y->color = z->color;
+        rb_update_size(y);       // y now roots z's (already shrunk) subtree
+        note_change(y);
+    }
+    if (xp != NULL) {
+        note_change(xp);         // the spliced position and the path above it
+    }
+
+  
+
+  // if we removed a BLACK node, we might have a double-black to repair
+    if (y_orig == RBColor::Black) {
+        while (true) {
+        // r is the current root point
+        node_type* r = NULL;
+        if (root != NULL){
+            r = *root;
+        }
+
+        // break if x is the root
+        if (x == r){
+            break;
+        }
+    
+        if (x != NULL && rb_is_red(x)){
+            break;
+        }
+        // try each case 
+        // Case 1
+        if (RBTreeTryCase1(root, x, xp)){
+            break;
+        }
+
+        // Case 2
+        (void)RBTreeTryCase2(this, root, x, xp);
+
+        // Case 3
+        if (RBTreeTryCase3(x, xp)){
+            continue;
+        }
+
+        // Case 4
+        if (RBTreeTryCase4(x, xp)){
+            break;
+        }
+
+        // Case 5
+        (void)RBTreeTryCase5(this, x, xp);
+
+        // Case 6
+        if (RBTreeTryCase6(this, x, xp)){
+            break;
+        }
+
+        // move upward if nothing matched to avoid loop
+        node_type* p;
+        if (x != NULL){
+            p = x->parent;
+        }
+        else{
+            p = xp;
+        }
+        if (p == NULL){
+            break;
+        }
+        x = p;
+        if (x != NULL){
+            xp = x->parent;
+        }
+        else{
+            xp = NULL;
+        }
+    }
+        // make sure x and root are black when finished
+        if (x != NULL){
+            set_color(x, RBColor::Black);
+        }
+        if (*root != NULL) {
+            set_color(*root, RBColor::Black);
+        }
+    }
+
+    // z is unlinked now; recycle its memory
+    forget_change(z);
+    pool->destroy(z);
+}
+
+// remove by kay(data), same as BST structure
+template <class Key, class Value, class Compare>
+void RBT<Key, Value, Compare>::remove(const Key& data) {
+  node_type* z = get_node(get_root(), data);
+  if (z == NULL){
+    return;
+  }
+  if (z->count > 1) {
+    // Counted mode: drop one copy, the node stays where it is
+    z->count--;
+    for (node_type* a = z; a != NULL; a = a->parent) {
+      a->size--;
+    }
+    note_change(z);
+    return;
+  }
+  RBTreeRemove(z);
+}
+
+// ---------------------------- utility functions --------------------------------
+
+// contains returns true if subtree contains data
+template <class Key, class Value, class Compare>
+bool RBT<Key, Value, Compare>::contains(node_type* subt, const Key& data) const {
+    return get_node(subt, data) != NULL;
+}
+
+// get_node returns pointer to node with given key
+// (neither key orders before the other → equal)
+template <class Key, class Value, class Compare>
+typename RBT<Key, Value, Compare>::node_type* RBT<Key, Value, Compare>::get_node(node_type* subt, const Key& data) const {
+    node_type* c = subt;
+    while (c != NULL) {
+        if (comp(data, c->data)){
+            c = c->left;
+        }
+        else if (comp(c->data, data)){
+            c = c->right;
+        }
+        else{
+            return c;
+        }
+    }
+    return NULL;
+}
+
+// size returns the subtree count kept in the node
+template <class Key, class Value, class Compare>
+int RBT<Key, Value, Compare>::size(node_type* subt) const {
+    return rb_size(subt);
+}
+
+// to_vector implements inorder traversal → push sorted keys into vec.
+// It walks successor links inside subt instead of recursing, so a deep or
+// huge tree needs no call stack; vec grows once to the subtree's key count.
+template <class Key, class Value, class Compare>
+void RBT<Key, Value, Compare>::to_vector(node_type* subt, vector<Key>& vec) const {
+    if (subt == NULL){
+        return;
+    }
+    vec.reserve(vec.size() + (size_t)rb_size(subt));
+    node_type* stop = subt->parent;     // climbing back here means subt is done
+    node_type* n = rb_minimum(subt);
+    while (n != NULL && n != stop) {
+        for (int i = 0; i < n->count; i++) {
+            vec.push_back(n->data);
+        }
+        if (n->right != NULL) {
+            n = rb_minimum(n->right);
+        }
+        else {
+            // climb until we come up from a left child (or leave subt)
+            node_type* p = n->parent;
+            while (p != stop && n == p->right) {
+                n = p;
+                p = p->parent;
+            }
+            n = p;
+        }
+    }
+}
+
+// ------------------------------ validator ----------------------------------
+// Validator checks the two main RBt invariants:
+// 1) No two Red nodes in a row (parent/child).
+// 2) All root-to-NULL paths have the same number of Black nodes.
+template <class N>
+int rb_black_height(N* n) {
+    if (n == NULL){
+        return 1;     // null leaves are black
+    } 
+    if (rb_is_red(n)) {
+        // parent and child cannot both be red
+        if (rb_is_red(n->left)) {
+            return -1;
+        }
+        if (rb_is_red(n->right)){
+            return -1;
+        }
+    }
+
+    // recursively count black height
+    int lh = rb_black_height(n->left);
+    if (lh < 0){
+        return -1; // left side broken
+    }
+    int rh = rb_black_height(n->right);
+    if (rh < 0){
+        return -1; // right side broken
+    }
+    if (lh != rh){ // height not equal
+        return -1;
+    }
+
+    // if the node is Black, increment black
+    if (n->color == RBColor::Black){
+        return lh + 1;
+    }
+    return lh; 
+}
+
+// rb_sizes_ok checks that every subtree count matches its children
+template <class N>
+bool rb_sizes_ok(const N* n) {
+    if (n == NULL){
+        return true;
+    }
+    if (n->count < 1 || n->size != n->count + rb_size(n->left) + rb_size(n->right)){
+        return false;
+    }
+    return rb_sizes_ok(n->left) && rb_sizes_ok(n->right);
+}
+
+// validate returns true if tree is empty or non-negative
+template <class Key, class Value, class Compare>
+bool RBT<Key, Value, Compare>::validate() const {
+  if (root == NULL || *root == NULL){ // empty
+    return true;
+  }
+  if ((*root)->color != RBColor::Black){
+    return false;  // root must be black
+  }
+  if (!rb_sizes_ok(*root)){
+    return false;  // subtree counts out of date
+  }
+  return rb_black_height(*root) > 0; // non-negative
+}
+
+// --------------------------- incremental validation --------------------------
+// An update only changes the nodes it logs (note_change), their ancestors
+// and the colors of a few of their children (an uncle or sibling recolored
+// during a fix-up). Below those children nothing changed, and each node's
+// cached `blacks` (the black height of its children) is still right, even
+// when its own color was flipped.
+
+// rb_local_ok checks the rules that involve only n and its children
+template <class N>
+bool rb_local_ok(const N* n) {
+    if (n->count < 1 || n->size != n->count + rb_size(n->left) + rb_size(n->right)){
+        return false;
+    }
+    if ((n->left != NULL && n->left->parent != n) || (n->right != NULL && n->right->parent != n)){
+        return false;
+    }
+    return !(rb_is_red(n) && (rb_is_red(n->left) || rb_is_red(n->right)));
+}
+
+// while validate_changes runs, the logged nodes and their ancestors (the
+// region) carry this bit in `blacks`; black heights never come near it
+static const unsigned char kRBInRegion = 0x80;
+
+// rb_changed_black_height returns the black height of n (NULL = 1), or -1 if
+// the rules fail. Region nodes are checked, recursed into and get their
+// cache refreshed (which also clears their mark). Any other subtree is
+// unchanged below its top, so only the top is looked at.
+template <class N>
+int rb_changed_black_height(N* n) {
+    if (n == NULL){
+        return 1;
+    }
+    int black = (n->color == RBColor::Black) ? 1 : 0;
+    if ((n->blacks & kRBInRegion) == 0) {
+        if (!black && (rb_is_red(n->left) || rb_is_red(n->right))){
+            return -1;   // a sibling or uncle recolored red over a red child
+        }
+        return n->blacks + black;
+    }
+    if (!rb_local_ok(n)){
+        return -1;
+    }
+    int lh = rb_changed_black_height(n->left);
+    if (lh < 0){
+        return -1;
+    }
+    int rh = rb_changed_black_height(n->right);
+    if (rh < 0 || lh != rh){
+        return -1;
+    }
+    n->blacks = (unsigned char)lh;
+    return lh + black;
+}
+
+// rb_store_black_heights is rb_black_height that also fills every cache
+template <class N>
+int rb_store_black_heights(N* n) {
+    if (n == NULL){
+        return 1;
+    }
+    if (rb_is_red(n) && (rb_is_red(n->left) || rb_is_red(n->right))){
+        return -1;
+    }
+    int lh = rb_store_black_heights(n->left);
+    int rh = rb_store_black_heights(n->right);
+    if (lh < 0 || rh < 0 || lh != rh){
+        return -1;
+    }
+    n->blacks = (unsigned char)lh;
+    return (n->color == RBColor::Black) ? lh + 1 : lh;
+}
+
+template <class Key, class Value, class Compare>
+void RBT<Key, Value, Compare>::track_changes(bool on) {
+    track = on;
+    changed.clear();
+    changed_all = true;   // changes made while off were not logged
+}
+
+template <class Key, class Value, class Compare>
+void RBT<Key, Value, Compare>::note_change(node_type* n) {
+    if (!track || changed_all) {
+        return;
+    }
+    if (changed.size() == kMaxChanged) {
+        changed.clear();
+        changed_all = true;
+        return;
+    }
+    changed.push_back(n);
+}
+
+// a logged node that is freed must not be visited by the next check
+template <class Key, class Value, class Compare>
+void RBT<Key, Value, Compare>::forget_change(node_type* n) {
+    if (!changed.empty()) {
+        changed.erase(std::remove(changed.begin(), changed.end(), n), changed.end());
+    }
+}
+
+template <class Key, class Value, class Compare>
+bool RBT<Key, Value, Compare>::validate_changes() {
+    if (changed_all) {
+        changed_all = false;
+        changed.clear();
+        node_type* top = (root != NULL) ? *root : NULL;
+        if (top == NULL){
+            return true;
+        }
+        return top->color == RBColor::Black && rb_sizes_ok(top) && rb_store_black_heights(top) > 0;
+    }
+    node_type* top = (root != NULL) ? *root : NULL;
+    if (top == NULL){
+        return changed.empty();
+    }
+    // mark the region: every logged node and the path up to the root. Paths
+    // of nearby logged nodes stop where they meet one already marked.
+    vector<node_type*>& region = changed_region;   // reused between calls
+    region.clear();
+    bool linked = true;
+    for (size_t i = 0; i < changed.size(); i++) {
+        node_type* a = changed[i];
+        while (a != NULL && (a->blacks & kRBInRegion) == 0) {
+            a->blacks |= kRBInRegion;
+            region.push_back(a);
+            if (a->parent == NULL && a != top) {
+                linked = false;   // a logged node that no longer hangs off the root
+            }
+            a = a->parent;
+        }
+    }
+    if ((top->blacks & kRBInRegion) == 0) {
+        top->blacks |= kRBInRegion;
+        region.push_back(top);
+    }
+    changed.clear();
+    bool ok = linked && top->color == RBColor::Black && rb_changed_black_height(top) > 0;
+    for (size_t i = 0; i < region.size(); i++) {
+        region[i]->blacks &= (unsigned char)~kRBInRegion;   // left behind by a failed check
+    }
+    if (!ok) {
+        changed_all = true;   // some caches were not refreshed: recheck everything next time
+    }
+    return ok;
+}
+
+// ------------------------------ order statistics -----------------------------
+// Every node knows how many nodes sit below it, so counting the keys on one
+// side of a value is a single root-to-leaf walk: whenever we step right we
+// skip a whole left subtree plus the node itself (count keys in Counted mode).
+
+// rb_count_less counts keys strictly less than data
+template <class N, class K, class Cmp>
+int rb_count_less(const N* c, const K& data, const Cmp& comp) {
+    int acc = 0;
+    while (c != NULL) {
+        if (comp(c->data, data)) {
+            acc += rb_size(c->left) + c->count;
+            c = c->right;
+        }
+        else {
+            c = c->left;
+        }
+    }
+    return acc;
+}
+
+// rb_count_less_equal counts keys less than or equal to data
+template <class N, class K, class Cmp>
+int rb_count_less_equal(const N* c, const K& data, const Cmp& comp) {
+    int acc = 0;
+    while (c != NULL) {
+        if (comp(data, c->data)) {
+            c = c->left;
+        }
+        else {
+            acc += rb_size(c->left) + c->count;
+            c = c->right;
+        }
+    }
+    return acc;
+}
+
+template <class Key, class Value, class Compare>
+template <class K>
+rb_rank RBT<Key, Value, Compare>::rank(const K& data) const {
+    rb_rank r;
+    r.less = 0;
+    r.equal = 0;
+    r.greater = 0;
+    if (root == NULL || *root == NULL){
+        return r;
+    }
+    if (dup == RBDuplicates::Counted && std::is_same<K, Key>::value) {
+        // at most one node holds data: one descent, ties read off its count
+        node_type* c = *root;
+        while (c != NULL) {
+            if (comp(data, c->data)) {
+                c = c->left;
+            }
+            else if (comp(c->data, data)) {
+                r.less += rb_size(c->left) + c->count;
+                c = c->right;
+            }
+            else {
+                r.less += rb_size(c->left);
+                r.equal = c->count;
+                break;
+            }
+        }
+        r.greater = rb_size(*root) - r.less - r.equal;
+        return r;
+    }
+    // duplicates can sit on both sides of an equal node after rotations,
+    // so ties are the difference of two one-sided counts
+    int le = rb_count_less_equal(*root, data, comp);
+    r.less = rb_count_less(*root, data, comp);
+    r.equal = le - r.less;
+    r.greater = rb_size(*root) - le;
+    return r;
+}
+
+template <class Key, class Value, class Compare>
+typename RBT<Key, Value, Compare>::node_type* RBT<Key, Value, Compare>::select(int k) const {
+    if (root == NULL || k < 0 || k >= rb_size(*root)){
+        return NULL;
+    }
+    node_type* c = *root;
+    while (c != NULL) {
+        int ls = rb_size(c->left);
+        if (k < ls) {
+            c = c->left;            // answer is in the left subtree
+        }
+        else if (k < ls + c->count) {
+            return c;               // one of this node's copies
+        }
+        else {
+            k -= ls + c->count;     // skip left subtree and this node
+            c = c->right;
+        }
+    }
+    return NULL;
+}
+
+// ------------------------------ bulk build ----------------------------------
+// A tree built by always taking the middle element as the subtree root has
+// height h = floor(log2 n), and every NULL leaf sits at depth h or h+1.
+// Painting depths 0..h-1 BLACK and depth h RED therefore gives every
+// root-to-NULL path exactly h black nodes, and no red node has a red child.
+
+// build_range builds the subtree for sorted positions [lo, hi] and returns
+// its root. Nodes are created in inorder, so they also sit in key order in
+// the pool's slabs.
+template <class Key, class Value, class Compare>
+template <class KeyAt, class ValueAt, class CountAt>
+typename RBT<Key, Value, Compare>::node_type* RBT<Key, Value, Compare>::build_range(
+        int lo, int hi, int depth, int red_depth, KeyAt& key_at, ValueAt& value_at, CountAt& count_at) {
+    if (lo > hi) {
+        return NULL;
+    }
+    int mid = lo + (hi - lo) / 2;
+    node_type* left = build_range(lo, mid - 1, depth + 1, red_depth, key_at, value_at, count_at);
+    node_type* n = init_node(key_at(mid), value_at(mid));
+    node_type* right = build_range(mid + 1, hi, depth + 1, red_depth, key_at, value_at, count_at);
+
+    n->left = left;
+    n->right = right;
+    if (left != NULL) left->parent = n;
+    if (right != NULL) right->parent = n;
+    n->count = count_at(mid);
+    rb_update_size(n);
+    if (depth == red_depth) {
+        n->color = RBColor::Red;
+    }
+    else {
+        n->color = RBColor::Black;
+    }
+    return n;
+}
+
+template <class Key, class Value, class Compare>
+template <class KeyAt, class ValueAt>
+void RBT<Key, Value, Compare>::build_from_sorted(int n, KeyAt key_at, ValueAt value_at) {
+    clear();
+    if (n <= 0) {
+        return;
+    }
+    vector<int> runs;               // Counted: start of each run of equal keys, then n
+    if (dup == RBDuplicates::Counted) {
+        runs.push_back(0);
+        for (int i = 1; i < n; i++) {
+            if (comp(key_at(i - 1), key_at(i))) {
+                runs.push_back(i);
+            }
+        }
+        runs.push_back(n);
+    }
+    auto one = [](int) { return 1; };
+    auto run_key = [&](int j) { return key_at(runs[(size_t)j]); };
+    auto run_value = [&](int j) { return value_at(runs[(size_t)j]); };
+    auto run_count = [&](int j) { return runs[(size_t)j + 1] - runs[(size_t)j]; };
+    int nodes = runs.empty() ? n : (int)runs.size() - 1;
+
+    int h = 0;                      // floor(log2 nodes): depth of the deepest level
+    while ((2LL << h) <= nodes) {
+        h++;
+    }
+    // a single node is the root and must stay black
+    int red_depth = (h > 0) ? h : -1;
+    if (runs.empty()) {
+        *root = build_range(0, n - 1, 0, red_depth, key_at, value_at, one);
+    }
+    else {
+        *root = build_range(0, nodes - 1, 0, red_depth, run_key, run_value, run_count);
+    }
+    (*root)->parent = NULL;
+}
+
+template <class Key, class Value, class Compare>
+void RBT<Key, Value, Compare>::build_from_sorted(const vector<Key>& sorted_keys) {
+    build_from_sorted((int)sorted_keys.size(),
+                      [&sorted_keys](int i) -> const Key& { return sorted_keys[(size_t)i]; },
+                      [](int) { return Value(); });
+}
+
+// ------------------------------ join and split ------------------------------
+// join_nodes(l, k, r) glues two trees with a middle node k in O(|hl - hr| + 1):
+// k is linked in on the taller tree's spine, where the subtree below it has
+// the shorter tree's black height, and goes RED, so only the red–red rule can
+// break, and insert_fixup repairs that. split_nodes cuts a tree along one
+// root-to-leaf path and joins the pieces on either side back together; the
+// joins' costs telescope to O(log n). Everything else is built from these:
+// the union splits one tree at the other's root key and joins the two halves
+// of the recursion with that root (Blelloch et al., "Just Join for Parallel
+// Ordered Sets").
+
+// rb_spine_black_height counts the black nodes from n down its left spine
+template <class N>
+int rb_spine_black_height(const N* n) {
+    int h = 0;
+    for (; n != NULL; n = n->left) {
+        if (n->color == RBColor::Black) {
+            h++;
+        }
+    }
+    return h;
+}
+
+// rb_maximum returns the maximum (right-most) node in a subtree.
+template <class N>
+N* rb_maximum(N* n) {
+    while (n != NULL && n->right != NULL) {
+        n = n->right;
+    }
+    return n;
+}
+
+// rb_detach cuts n loose from its parent (the parent keeps its stale link)
+template <class N>
+inline N* rb_detach(N* n) {
+    if (n != NULL) {
+        n->parent = NULL;
+    }
+    return n;
+}
+
+template <class Key, class Value, class Compare>
+typename RBT<Key, Value, Compare>::node_type* RBT<Key, Value, Compare>::join_nodes(
+        node_type* l, int hl, node_type* k, node_type* r, int hr, int& h) {
+    // black roots, so k may go red under either tree's spine
+    if (rb_is_red(l)) {
+        l->color = RBColor::Black;
+        hl++;
+    }
+    if (rb_is_red(r)) {
+        r->color = RBColor::Black;
+        hr++;
+    }
+    k->parent = NULL;
+    if (hl == hr) {
+        k->left = l;
+        k->right = r;
+        if (l != NULL) l->parent = k;
+        if (r != NULL) r->parent = k;
+        k->color = RBColor::Black;
+        rb_update_size(k);
+        h = hl + 1;
+        return k;
+    }
+
+    // walk down the taller tree's inner spine to the black node c whose
+    // black height is the shorter tree's (possibly a NULL leaf)
+    bool left_taller = (hl > hr);
+    node_type* c = left_taller ? l : r;
+    node_type* p = NULL;
+    int hc = left_taller ? hl : hr;
+    int target = left_taller ? hr : hl;
+    while (!(rb_is_black(c) && hc == target)) {
+        if (c->color == RBColor::Black) {
+            hc--;
+        }
+        p = c;
+        c = left_taller ? c->right : c->left;
+    }
+
+    // k takes c's place, with c on one side and the shorter tree on the other
+    node_type* other = left_taller ? r : l;
+    k->left = left_taller ? c : other;
+    k->right = left_taller ? other : c;
+    if (k->left != NULL) k->left->parent = k;
+    if (k->right != NULL) k->right->parent = k;
+    k->parent = p;
+    if (left_taller) p->right = k;
+    else p->left = k;
+    k->color = RBColor::Red;
+    rb_update_size(k);
+    int grow = k->count + rb_size(other);
+    for (node_type* a = p; a != NULL; a = a->parent) {
+        a->size += grow;
+    }
+
+    // rotations in the fix-up move *root: point it at the taller tree
+    node_type* top = left_taller ? l : r;
+    node_type** saved = root;
+    root = &top;
+    insert_fixup(k);
+    root = saved;
+    h = left_taller ? hl : hr;
+    if (top->color == RBColor::Red) {
+        top->color = RBColor::Black;
+        h++;
+    }
+    return top;
+}
+
+// join_pair joins without a middle key: l's last node is cut out and used
+template <class Key, class Value, class Compare>
+typename RBT<Key, Value, Compare>::node_type* RBT<Key, Value, Compare>::join_pair(
+        node_type* l, int hl, node_type* r, int hr, int& h) {
+    if (l == NULL) {
+        h = hr;
+        return r;
+    }
+    if (r == NULL) {
+        h = hl;
+        return l;
+    }
+    node_type* rest = NULL;
+    int hrest = 0;
+    node_type* k = split_last(l, hl, rest, hrest);
+    return join_nodes(rest, hrest, k, r, hr, h);
+}
+
+// split_last cuts the last node out of t and returns it; rest is the others
+template <class Key, class Value, class Compare>
+typename RBT<Key, Value, Compare>::node_type* RBT<Key, Value, Compare>::split_last(
+        node_type* t, int h, node_type*& rest, int& hrest) {
+    int hc = (t->color == RBColor::Black) ? h - 1 : h;
+    node_type* a = rb_detach(t->left);
+    node_type* b = rb_detach(t->right);
+    if (b == NULL) {
+        rest = a;
+        hrest = hc;
+        return t;
+    }
+    node_type* b_rest = NULL;
+    int hb_rest = 0;
+    node_type* last = split_last(b, hc, b_rest, hb_rest);
+    rest = join_nodes(a, hc, t, b_rest, hb_rest, hrest);
+    return last;
+}
+
+// split_nodes cuts t into l (the keys goes_left accepts) and r (the rest).
+// goes_left must accept a prefix of the keys in tree order.
+template <class Key, class Value, class Compare>
+template <class Pred>
+void RBT<Key, Value, Compare>::split_nodes(node_type* t, int h, Pred& goes_left,
+                                           node_type*& l, int& hl, node_type*& r, int& hr) {
+    if (t == NULL) {
+        l = NULL;
+        r = NULL;
+        hl = 0;
+        hr = 0;
+        return;
+    }
+    int hc = (t->color == RBColor::Black) ? h - 1 : h;
+    node_type* a = rb_detach(t->left);
+    node_type* b = rb_detach(t->right);
+    if (goes_left(t->data)) {
+        // t and everything left of it stay on the left
+        node_type* bl = NULL;
+        int hbl = 0;
+        split_nodes(b, hc, goes_left, bl, hbl, r, hr);
+        l = join_nodes(a, hc, t, bl, hbl, hl);
+    }
+    else {
+        node_type* ar = NULL;
+        int har = 0;
+        split_nodes(a, hc, goes_left, l, hl, ar, har);
+        r = join_nodes(ar, har, t, b, hc, hr);
+    }
+}
+
+// union_nodes merges two trees of this pool: b's root key splits a, and the
+// halves are merged with b's subtrees on either side of it
+template <class Key, class Value, class Compare>
+typename RBT<Key, Value, Compare>::node_type* RBT<Key, Value, Compare>::union_nodes(
+        node_type* a, int ha, node_type* b, int hb, int& h) {
+    if (a == NULL) {
+        h = hb;
+        return b;
+    }
+    if (b == NULL) {
+        h = ha;
+        return a;
+    }
+    int hc = (b->color == RBColor::Black) ? hb - 1 : hb;
+    node_type* bl = rb_detach(b->left);
+    node_type* br = rb_detach(b->right);
+    const Key& k = b->data;
+
+    node_type* less = NULL;
+    node_type* rest = NULL;
+    int hless = 0;
+    int hrest = 0;
+    auto before = [this, &k](const Key& x) { return comp(x, k); };
+    split_nodes(a, ha, before, less, hless, rest, hrest);
+    if (dup == RBDuplicates::Counted) {
+        // a holds at most one node equal to k: fold its count into b's root
+        node_type* same = NULL;
+        node_type* more = NULL;
+        int hsame = 0;
+        int hmore = 0;
+        auto not_after = [this, &k](const Key& x) { return !comp(k, x); };
+        split_nodes(rest, hrest, not_after, same, hsame, more, hmore);
+        if (same != NULL) {
+            b->count += same->count;
+            pool->destroy(same);
+        }
+        rest = more;
+        hrest = hmore;
+    }
+
+    int hl = 0;
+    int hr = 0;
+    node_type* left = union_nodes(less, hless, bl, hc, hl);
+    node_type* right = union_nodes(rest, hrest, br, hc, hr);
+    return join_nodes(left, hl, b, right, hr, h);
+}
+
+// difference_nodes removes from t every key that other's subtree holds
+template <class Key, class Value, class Compare>
+typename RBT<Key, Value, Compare>::node_type* RBT<Key, Value, Compare>::difference_nodes(
+        node_type* t, int ht, const node_type* other, int& h) {
+    if (t == NULL || other == NULL) {
+        h = ht;
+        return t;
+    }
+    const Key& k = other->data;
+    node_type* less = NULL;
+    node_type* rest = NULL;
+    node_type* same = NULL;
+    node_type* more = NULL;
+    int hless = 0;
+    int hrest = 0;
+    int hsame = 0;
+    int hmore = 0;
+    auto before = [this, &k](const Key& x) { return comp(x, k); };
+    auto not_after = [this, &k](const Key& x) { return !comp(k, x); };
+    split_nodes(t, ht, before, less, hless, rest, hrest);
+    split_nodes(rest, hrest, not_after, same, hsame, more, hmore);
+    destroy_subtree(same);
+
+    int hl = 0;
+    int hr = 0;
+    node_type* left = difference_nodes(less, hless, other->left, hl);
+    node_type* right = difference_nodes(more, hmore, other->right, hr);
+    return join_pair(left, hl, right, hr, h);
+}
+
+template <class Key, class Value, class Compare>
+void RBT<Key, Value, Compare>::destroy_subtree(node_type* n) {
+    if (n == NULL) {
+        return;
+    }
+    destroy_subtree(n->left);
+    destroy_subtree(n->right);
+    pool->destroy(n);
+}
+
+// clone_subtree copies src's shape, colors and counts into this pool; the
+// keys and payloads are moved out, as src is about to be destroyed
+template <class Key, class Value, class Compare>
+typename RBT<Key, Value, Compare>::node_type* RBT<Key, Value, Compare>::clone_subtree(node_type* src) {
+    if (src == NULL) {
+        return NULL;
+    }
+    node_type* n = pool->create();
+    n->data = std::move(src->data);
+    n->value = std::move(src->value);
+    n->color = src->color;
+    n->blacks = src->blacks;
+    n->parent = NULL;
+    n->size = src->size;
+    n->count = src->count;
+    n->left = clone_subtree(src->left);
+    n->right = clone_subtree(src->right);
+    if (n->left != NULL) n->left->parent = n;
+    if (n->right != NULL) n->right->parent = n;
+    return n;
+}
+
+template <class Key, class Value, class Compare>
+void RBT<Key, Value, Compare>::set_top(node_type* t) {
+    if (t != NULL) {
+        t->parent = NULL;
+        t->color = RBColor::Black;
+    }
+    *root = t;
+    changed.clear();
+    changed_all = true;   // cached heights below the seams are out of date
+}
+
+// take_nodes moves other's tree into this tree's pool and returns its root,
+// leaving other empty. On one pool that is just unhooking the root.
+// Otherwise the smaller side pays: a smaller tree is copied in (into cells
+// freed earlier when there are any), a larger one hands over its slabs if
+// no other tree allocates from them. Always adopting would let a pool
+// collect slabs whose nodes were later removed, round after round.
+template <class Key, class Value, class Compare>
+typename RBT<Key, Value, Compare>::node_type* RBT<Key, Value, Compare>::take_nodes(RBT& other) {
+    node_type* t = *other.root;
+    if (other.pool == pool) {
+        other.set_top(NULL);
+        return t;
+    }
+    if (other.pool->live_nodes() <= pool->live_nodes() || other.pool.use_count() > 1) {
+        t = clone_subtree(t);
+        other.clear();
+        return t;
+    }
+    pool->adopt(*other.pool);
+    other.set_top(NULL);
+    return t;
+}
+
+template <class Key, class Value, class Compare>
+void RBT<Key, Value, Compare>::join(const Key& key, RBT& right, const Value& value) {
+    if (&right == this) {
+        return;
+    }
+    node_type* l = *root;
+    node_type* r = *right.root;
+    if (dup == RBDuplicates::Counted &&
+        ((l != NULL && !comp(last()->data, key)) || (r != NULL && !comp(key, right.first()->data)))) {
+        // key is already at the seam: its copies have to add up, not sit side by side
+        unite(right);
+        insert_data(key, value);
+        return;
+    }
+    r = take_nodes(right);
+    node_type* k = init_node(key, value);
+    int h = 0;
+    set_top(join_nodes(l, rb_spine_black_height(l), k, r, rb_spine_black_height(r), h));
+}
+
+template <class Key, class Value, class Compare>
+template <class K>
+void RBT<Key, Value, Compare>::split_at(const K& key, RBT& right) {
+    if (&right == this) {
+        return;
+    }
+    right.clear();
+    node_type* l = NULL;
+    node_type* r = NULL;
+    int hl = 0;
+    int hr = 0;
+    auto before = [this, &key](const Key& x) { return comp(x, key); };
+    split_nodes(*root, rb_spine_black_height(*root), before, l, hl, r, hr);
+
+    // each tree must hold its nodes in its own pool: on one pool there is
+    // nothing to do, else copy the smaller side over
+    if (right.pool == pool) {
+        right.set_top(r);
+        set_top(l);
+    }
+    else if (rb_size(r) <= rb_size(l) || pool.use_count() > 1) {
+        right.set_top(right.clone_subtree(r));
+        destroy_subtree(r);
+        set_top(l);
+    }
+    else {
+        right.pool->adopt(*pool);
+        right.set_top(r);
+        set_top(clone_subtree(l));
+        right.destroy_subtree(l);
+    }
+}
+
+template <class Key, class Value, class Compare>
+void RBT<Key, Value, Compare>::unite(RBT& other) {
+    if (&other == this || *other.root == NULL) {
+        return;
+    }
+    node_type* a = *root;
+    node_type* b = take_nodes(other);
+    if (a != NULL && rb_size(a) < rb_size(b)) {
+        std::swap(a, b);   // split the larger tree at the smaller one's keys
+    }
+    int ha = rb_spine_black_height(a);
+    int hb = rb_spine_black_height(b);
+    int h = 0;
+    if (a == NULL || comp(rb_maximum(b)->data, rb_minimum(a)->data)) {
+        set_top(join_pair(b, hb, a, ha, h));   // disjoint ranges: one join
+    }
+    else if (comp(rb_maximum(a)->data, rb_minimum(b)->data)) {
+        set_top(join_pair(a, ha, b, hb, h));
+    }
+    else {
+        set_top(union_nodes(a, ha, b, hb, h));
+    }
+}
+
+template <class Key, class Value, class Compare>
+void RBT<Key, Value, Compare>::difference(const RBT& other) {
+    if (&other == this) {
+        clear();
+        return;
+    }
+    node_type* t = *root;
+    if (t == NULL || *other.root == NULL) {
+        return;
+    }
+    int h = 0;
+    set_top(difference_nodes(t, rb_spine_black_height(t), *other.root, h));
+}
+
+// ------------------------------ navigation ----------------------------------
+// Inorder neighbours follow the parent pointers, so walking the whole tree
+// from first() with successor() touches every edge twice and needs no stack.
+
+template <class Key, class Value, class Compare>
+typename RBT<Key, Value, Compare>::node_type* RBT<Key, Value, Compare>::first() const {
+    if (root == NULL) return NULL;
+    return rb_minimum(*root);
+}
+
+template <class Key, class Value, class Compare>
+typename RBT<Key, Value, Compare>::node_type* RBT<Key, Value, Compare>::last() const {
+    if (root == NULL) return NULL;
+    node_type* n = *root;
+    while (n != NULL && n->right != NULL) {
+        n = n->right;
+    }
+    return n;
+}
+
+template <class Key, class Value, class Compare>
+typename RBT<Key, Value, Compare>::node_type* RBT<Key, Value, Compare>::successor(node_type* n) {
+    if (n == NULL) return NULL;
+    if (n->right != NULL) {
+        return rb_minimum(n->right);   // leftmost of the right subtree
+    }
+    // otherwise climb until we come up from a left child
+    node_type* p = n->parent;
+    while (p != NULL && n == p->right) {
+        n = p;
+        p = p->parent;
+    }
+    return p;
+}
+
+template <class Key, class Value, class Compare>
+typename RBT<Key, Value, Compare>::node_type* RBT<Key, Value, Compare>::predecessor(node_type* n) {
+    if (n == NULL) return NULL;
+    if (n->left != NULL) {
+        n = n->left;                   // rightmost of the left subtree
+        while (n->right != NULL) {
+            n = n->right;
+        }
+        return n;
+    }
+    node_type* p = n->parent;
+    while (p != NULL && n == p->left) {
+        n = p;
+        p = p->parent;
+    }
+    return p;
+}
+
+// ------------------------------ bounds --------------------------------------
+
+template <class Key, class Value, class Compare>
+template <class K>
+typename RBT<Key, Value, Compare>::const_iterator RBT<Key, Value, Compare>::lower_bound(const K& data) const {
+    node_type* found = NULL;
+    node_type* c = (root != NULL) ? *root : NULL;
+    while (c != NULL) {
+        if (comp(c->data, data)) {
+            c = c->right;       // c is too small
+        }
+        else {
+            found = c;          // candidate; look for an earlier one
+            c = c->left;
+        }
+    }
+    return const_iterator(this, found);
+}
+
+template <class Key, class Value, class Compare>
+template <class K>
+typename RBT<Key, Value, Compare>::const_iterator RBT<Key, Value, Compare>::upper_bound(const K& data) const {
+    node_type* found = NULL;
+    node_type* c = (root != NULL) ? *root : NULL;
+    while (c != NULL) {
+        if (comp(data, c->data)) {
+            found = c;
+            c = c->left;
+        }
+        else {
+            c = c->right;
+        }
+    }
+    return const_iterator(this, found);
+}
+
+#endif // RBT_IMPL_H__
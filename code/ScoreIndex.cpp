@@ -0,0 +1,197 @@
+/* Please refer to the header file (ScoreIndex.h) for documentation of each method. */
+
+#include "ScoreIndex.h"
+
+// RedBlackScoreIndex: the red–black tree; a cursor is the node itself
+class RedBlackScoreIndex : public ScoreIndex {
+public:
+  ScoreIndexKind kind() const override { return ScoreIndexKind::RedBlack; }
+
+  void insert(const ScoreKey& key, int slot) override { tree.insert_data(key, slot); }
+  void remove(const ScoreKey& key) override { tree.remove(key); }
+  void clear() override { tree.clear(); }
+  void build_from_sorted(int n, const function<ScoreKey(int)>& key_at, const function<int(int)>& slot_at) override {
+    tree.build_from_sorted(n, key_at, slot_at);
+  }
+
+  void unite(ScoreIndex& other) override {
+    RedBlackScoreIndex* o = dynamic_cast<RedBlackScoreIndex*>(&other);
+    if (o == NULL) {
+      ScoreIndex::unite(other);
+      return;
+    }
+    tree.unite(o->tree);
+  }
+  void split_at(int score, ScoreIndex& right) override {
+    RedBlackScoreIndex* r = dynamic_cast<RedBlackScoreIndex*>(&right);
+    if (r == NULL) {
+      ScoreIndex::split_at(score, right);
+      return;
+    }
+    tree.split_at(score, r->tree);  // keys before score are the ones above it
+  }
+  void renumber(const vector<int>& to) override {
+    for (ScoreTree::node_type* n = tree.first(); n != NULL; n = ScoreTree::successor(n)) {
+      n->value = to[(size_t)n->value];
+    }
+  }
+
+  int size() const override { return tree.size(tree.get_root()); }
+  int position(const ScoreKey& key) const override { return tree.rank(key).less; }
+
+  ScoreCursor seek(int pos) const override {
+    ScoreCursor c;
+    c.node = tree.select(pos);
+    c.at = 0;
+    return c;
+  }
+  void next(ScoreCursor& c) const override {
+    // successor only reads the links; the tree hands out non-const nodes
+    c.node = ScoreTree::successor(const_cast<ScoreTree::node_type*>(node(c)));
+  }
+  const ScoreKey& key(const ScoreCursor& c) const override { return node(c)->data; }
+  int slot(const ScoreCursor& c) const override { return node(c)->value; }
+
+  bool validate() const override { return tree.validate(); }
+  void track_changes(bool on) override { tree.track_changes(on); }
+  bool validate_changes() override { return tree.validate_changes(); }
+  rb_mem_stats mem_stats() const override { return tree.mem_stats(); }
+
+private:
+  ScoreTree tree;
+
+  static const ScoreTree::node_type* node(const ScoreCursor& c) {
+    return static_cast<const ScoreTree::node_type*>(c.node);
+  }
+};
+
+// BTreeScoreIndex: the B+ tree; a cursor is a leaf and an entry in it
+class BTreeScoreIndex : public ScoreIndex {
+public:
+  ScoreIndexKind kind() const override { return ScoreIndexKind::BTree; }
+
+  void insert(const ScoreKey& key, int slot) override { tree.insert_data(key, slot); }
+  void remove(const ScoreKey& key) override { tree.remove(key); }
+  void clear() override { tree.clear(); }
+  void build_from_sorted(int n, const function<ScoreKey(int)>& key_at, const function<int(int)>& slot_at) override {
+    tree.build_from_sorted(n, key_at, slot_at);
+  }
+
+  int size() const override { return tree.size(); }
+  int position(const ScoreKey& key) const override { return tree.position(key); }
+
+  ScoreCursor seek(int pos) const override {
+    ScoreCursor c;
+    ScoreBTree::const_iterator it = tree.select(pos);
+    c.node = it.node();
+    c.at = it.index();
+    return c;
+  }
+  void next(ScoreCursor& c) const override {
+    const ScoreBTree::leaf_type* l = leaf(c);
+    if (++c.at == l->n) {
+      c.node = l->next;
+      c.at = 0;
+    }
+  }
+  const ScoreKey& key(const ScoreCursor& c) const override { return leaf(c)->keys[c.at]; }
+  int slot(const ScoreCursor& c) const override { return leaf(c)->values[c.at]; }
+
+  bool validate() const override { return tree.validate(); }
+  void track_changes(bool on) override { tree.track_changes(on); }
+  bool validate_changes() override { return tree.validate_changes(); }
+  rb_mem_stats mem_stats() const override { return tree.mem_stats(); }
+
+private:
+  ScoreBTree tree;
+
+  static const ScoreBTree::leaf_type* leaf(const ScoreCursor& c) {
+    return static_cast<const ScoreBTree::leaf_type*>(c.node);
+  }
+};
+
+// CompactScoreIndex: the compact red–black tree; a cursor is the node. Its
+// iterators carry a stack that does not fit a cursor, so next() goes
+// through CompactRBT::successor.
+class CompactScoreIndex : public ScoreIndex {
+public:
+  ScoreIndexKind kind() const override { return ScoreIndexKind::Compact; }
+
+  void insert(const ScoreKey& key, int slot) override { tree.insert_data(key, slot); }
+  void remove(const ScoreKey& key) override { tree.remove(key); }
+  void clear() override { tree.clear(); }
+  void build_from_sorted(int n, const function<ScoreKey(int)>& key_at, const function<int(int)>& slot_at) override {
+    tree.build_from_sorted(n, key_at, slot_at);
+  }
+
+  int size() const override { return tree.size(); }
+  int position(const ScoreKey& key) const override { return tree.rank(key).less; }
+
+  ScoreCursor seek(int pos) const override { return at(tree.select(pos)); }
+  void next(ScoreCursor& c) const override { c.node = tree.successor(node(c)); }
+  const ScoreKey& key(const ScoreCursor& c) const override { return node(c)->data; }
+  int slot(const ScoreCursor& c) const override { return node(c)->value; }
+
+  bool validate() const override { return tree.validate(); }
+  void track_changes(bool on) override { tree.track_changes(on); }
+  bool validate_changes() override { return tree.validate_changes(); }
+  rb_mem_stats mem_stats() const override { return tree.mem_stats(); }
+
+private:
+  ScoreCompactTree tree;
+
+  ScoreCursor at(const ScoreCompactTree::const_iterator& it) const {
+    ScoreCursor c;
+    c.node = (it == tree.end()) ? NULL : &*it;
+    c.at = 0;
+    return c;
+  }
+  static const ScoreCompactTree::node_type* node(const ScoreCursor& c) {
+    return static_cast<const ScoreCompactTree::node_type*>(c.node);
+  }
+};
+
+// the generic moves walk the keys in order; an index with a cheaper way
+// overrides them
+
+void ScoreIndex::unite(ScoreIndex& other) {
+  if (&other == this) return;
+  for (ScoreCursor c = other.seek(0); c.node != NULL; other.next(c)) {
+    insert(other.key(c), other.slot(c));
+  }
+  other.clear();
+}
+
+void ScoreIndex::split_at(int score, ScoreIndex& right) {
+  if (&right == this) return;
+  ScoreKey first;
+  first.score = score;   // "" orders before every name tied on score
+  vector<ScoreKey> keys;
+  vector<int> slots;
+  for (ScoreCursor c = seek(position(first)); c.node != NULL; next(c)) {
+    keys.push_back(key(c));
+    slots.push_back(slot(c));
+  }
+  right.build_from_sorted((int)keys.size(), [&keys](int i) { return keys[(size_t)i]; },
+                          [&slots](int i) { return slots[(size_t)i]; });
+  for (size_t i = 0; i < keys.size(); i++) remove(keys[i]);
+}
+
+void ScoreIndex::renumber(const vector<int>& to) {
+  vector<ScoreKey> keys;
+  vector<int> slots;
+  keys.reserve((size_t)size());
+  slots.reserve((size_t)size());
+  for (ScoreCursor c = seek(0); c.node != NULL; next(c)) {
+    keys.push_back(key(c));
+    slots.push_back(to[(size_t)slot(c)]);
+  }
+  build_from_sorted((int)keys.size(), [&keys](int i) { return keys[(size_t)i]; },
+                    [&slots](int i) { return slots[(size_t)i]; });
+}
+
+unique_ptr<ScoreIndex> ScoreIndex::create(ScoreIndexKind kind) {
+  if (kind == ScoreIndexKind::BTree) return unique_ptr<ScoreIndex>(new BTreeScoreIndex());
+  if (kind == ScoreIndexKind::Compact) return unique_ptr<ScoreIndex>(new CompactScoreIndex());
+  return unique_ptr<ScoreIndex>(new RedBlackScoreIndex());
+}
@@ -0,0 +1,111 @@
+#ifndef SCORE_INDEX_H__
+#define SCORE_INDEX_H__
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "RBT.h"
+#include "BTree.h"
+#include "CompactRBT.h"
+
+using namespace std;
+
+// key of the score index: leaderboard order is higher score first, and
+// players tied on score are listed by name. Every player has exactly one key,
+// so an inorder walk of the index is the leaderboard itself.
+struct ScoreKey {
+  int score;
+  string name;
+};
+
+// ScoreOrder compares ScoreKeys in leaderboard order. It also compares a
+// ScoreKey against a bare score, where every key with that score counts as
+// equal, so RBT::rank(score) returns how many players rank above a score and
+// how many are tied on it.
+struct ScoreOrder {
+  bool operator()(const ScoreKey& a, const ScoreKey& b) const {
+    if (a.score != b.score) return a.score > b.score;
+    return a.name < b.name;
+  }
+  bool operator()(const ScoreKey& a, int score) const { return a.score > score; }
+  bool operator()(int score, const ScoreKey& a) const { return score > a.score; }
+};
+
+// the ways to store (score desc, name) → slot in players
+typedef RBT<ScoreKey, int, ScoreOrder> ScoreTree;
+typedef BTree<ScoreKey, int, ScoreOrder, 64> ScoreBTree;
+typedef CompactRBT<ScoreKey, int, ScoreOrder> ScoreCompactTree;
+
+// which of them a Leaderboard uses
+enum class ScoreIndexKind {
+  RedBlack,   // ScoreTree: one pooled node per player
+  BTree,      // ScoreBTree: up to 64 keys per node, leaves chained for walks
+  Compact     // ScoreCompactTree: red–black nodes in one array, 32-bit links
+};
+
+// ScoreCursor is a position in a walk over a ScoreIndex. What node and
+// which entry in it is up to the index that made it; node is NULL past the
+// last key. Any insert or remove invalidates it.
+struct ScoreCursor {
+  const void* node;
+  int at;
+};
+
+// ScoreIndex is the leaderboard's ordered score index: the players' keys in
+// leaderboard order, each with the player's slot, with positions (rank) and
+// walks from any position. Leaderboard talks only to this interface, so the
+// index behind it is chosen at construction (LeaderboardOptions::scoreIndex).
+// Every operation is O(log n), and next() is O(1) (O(log n) for Compact,
+// whose nodes have no parent link to step through).
+class ScoreIndex {
+public:
+  virtual ~ScoreIndex() {}
+
+  // create returns an empty index of the given kind.
+  static unique_ptr<ScoreIndex> create(ScoreIndexKind kind);
+
+  virtual ScoreIndexKind kind() const = 0;
+
+  virtual void insert(const ScoreKey& key, int slot) = 0;
+  // remove deletes key (nothing happens if it is not there).
+  virtual void remove(const ScoreKey& key) = 0;
+  virtual void clear() = 0;
+  // replace the contents with n keys given in leaderboard order, in O(n).
+  virtual void build_from_sorted(int n, const function<ScoreKey(int)>& key_at,
+                                 const function<int(int)>& slot_at) = 0;
+
+  // whole-index moves, for merging and splitting boards. Keys are unique
+  // across the two indexes and slots move with their keys.
+  // unite moves every key of other into this index; other is left empty.
+  // split_at moves every key scoring at or below score to right (emptied
+  // first); this index keeps the higher ones. Between two RedBlack indexes
+  // these are RBT::unite / RBT::split_at, O(m log(n/m + 1)) and O(log n)
+  // plus the node handover; otherwise the keys are moved one by one.
+  virtual void unite(ScoreIndex& other);
+  virtual void split_at(int score, ScoreIndex& right);
+  // renumber sets every slot s to to[s], in O(n).
+  virtual void renumber(const vector<int>& to);
+
+  // number of keys
+  virtual int size() const = 0;
+  // position of key in leaderboard order: how many keys come before it.
+  virtual int position(const ScoreKey& key) const = 0;
+
+  // walks: seek(pos) is the cursor at 0-based position pos (past the end if
+  // pos >= size()), next moves to the following key
+  virtual ScoreCursor seek(int pos) const = 0;
+  virtual void next(ScoreCursor& c) const = 0;
+  virtual const ScoreKey& key(const ScoreCursor& c) const = 0;
+  virtual int slot(const ScoreCursor& c) const = 0;
+
+  // checks, as RBT::validate / track_changes / validate_changes
+  virtual bool validate() const = 0;
+  virtual void track_changes(bool on) = 0;
+  virtual bool validate_changes() = 0;
+
+  // node memory held by the index
+  virtual rb_mem_stats mem_stats() const = 0;
+};
+
+#endif // SCORE_INDEX_H__
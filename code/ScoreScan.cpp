@@ -0,0 +1,283 @@
+/* Please refer to the header file (ScoreScan.h) for documentation of each method. */
+
+#include "ScoreScan.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define SCORE_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+// ------------------------------------------------------------------ scalar
+
+static size_t greater_scalar(const int32_t* v, size_t n, int32_t x) {
+  size_t c = 0;
+  for (size_t i = 0; i < n; i++) c += (v[i] > x);
+  return c;
+}
+
+static size_t equal_scalar(const int32_t* v, size_t n, int32_t x) {
+  size_t c = 0;
+  for (size_t i = 0; i < n; i++) c += (v[i] == x);
+  return c;
+}
+
+static size_t in_range_scalar(const int32_t* v, size_t n, int32_t lo, int32_t hi) {
+  size_t c = 0;
+  for (size_t i = 0; i < n; i++) c += (v[i] >= lo && v[i] <= hi);
+  return c;
+}
+
+static void min_max_scalar(const int32_t* v, size_t n, int32_t& mn, int32_t& mx) {
+  for (size_t i = 0; i < n; i++) {
+    mn = v[i] < mn ? v[i] : mn;
+    mx = v[i] > mx ? v[i] : mx;
+  }
+}
+
+#ifdef SCORE_SCAN_X86
+
+// Every counting kernel keeps per-lane counters in two accumulators (two
+// loads in flight per step) and subtracts each compare mask from them: a
+// matching lane's mask is -1, so subtracting it adds one. A 32-bit lane
+// only overflows past 2^31 steps. The tail goes through the scalar loop.
+
+// ---------------------------------------------------------------- AVX2
+
+__attribute__((target("avx2")))
+static size_t sum_lanes_avx2(__m256i acc) {
+  uint32_t lanes[8];
+  _mm256_storeu_si256((__m256i*)lanes, acc);
+  size_t s = 0;
+  for (int i = 0; i < 8; i++) s += lanes[i];
+  return s;
+}
+
+__attribute__((target("avx2")))
+static size_t greater_avx2(const int32_t* v, size_t n, int32_t x) {
+  __m256i key = _mm256_set1_epi32(x);
+  __m256i acc0 = _mm256_setzero_si256();
+  __m256i acc1 = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m256i a = _mm256_loadu_si256((const __m256i*)(v + i));
+    __m256i b = _mm256_loadu_si256((const __m256i*)(v + i + 8));
+    acc0 = _mm256_sub_epi32(acc0, _mm256_cmpgt_epi32(a, key));
+    acc1 = _mm256_sub_epi32(acc1, _mm256_cmpgt_epi32(b, key));
+  }
+  return sum_lanes_avx2(_mm256_add_epi32(acc0, acc1)) + greater_scalar(v + i, n - i, x);
+}
+
+__attribute__((target("avx2")))
+static size_t equal_avx2(const int32_t* v, size_t n, int32_t x) {
+  __m256i key = _mm256_set1_epi32(x);
+  __m256i acc0 = _mm256_setzero_si256();
+  __m256i acc1 = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m256i a = _mm256_loadu_si256((const __m256i*)(v + i));
+    __m256i b = _mm256_loadu_si256((const __m256i*)(v + i + 8));
+    acc0 = _mm256_sub_epi32(acc0, _mm256_cmpeq_epi32(a, key));
+    acc1 = _mm256_sub_epi32(acc1, _mm256_cmpeq_epi32(b, key));
+  }
+  return sum_lanes_avx2(_mm256_add_epi32(acc0, acc1)) + equal_scalar(v + i, n - i, x);
+}
+
+// in range = not (below lo or above hi); no lo - 1, so lo = INT_MIN is fine
+__attribute__((target("avx2")))
+static size_t in_range_avx2(const int32_t* v, size_t n, int32_t lo, int32_t hi) {
+  __m256i low = _mm256_set1_epi32(lo);
+  __m256i high = _mm256_set1_epi32(hi);
+  __m256i ones = _mm256_set1_epi32(-1);
+  __m256i acc0 = _mm256_setzero_si256();
+  __m256i acc1 = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m256i a = _mm256_loadu_si256((const __m256i*)(v + i));
+    __m256i b = _mm256_loadu_si256((const __m256i*)(v + i + 8));
+    __m256i outA = _mm256_or_si256(_mm256_cmpgt_epi32(low, a), _mm256_cmpgt_epi32(a, high));
+    __m256i outB = _mm256_or_si256(_mm256_cmpgt_epi32(low, b), _mm256_cmpgt_epi32(b, high));
+    acc0 = _mm256_sub_epi32(acc0, _mm256_andnot_si256(outA, ones));
+    acc1 = _mm256_sub_epi32(acc1, _mm256_andnot_si256(outB, ones));
+  }
+  return sum_lanes_avx2(_mm256_add_epi32(acc0, acc1)) + in_range_scalar(v + i, n - i, lo, hi);
+}
+
+__attribute__((target("avx2")))
+static void min_max_avx2(const int32_t* v, size_t n, int32_t& mn, int32_t& mx) {
+  size_t i = 0;
+  if (n >= 8) {
+    __m256i lo = _mm256_loadu_si256((const __m256i*)v);
+    __m256i hi = lo;
+    for (i = 8; i + 8 <= n; i += 8) {
+      __m256i a = _mm256_loadu_si256((const __m256i*)(v + i));
+      lo = _mm256_min_epi32(lo, a);
+      hi = _mm256_max_epi32(hi, a);
+    }
+    int32_t los[8];
+    int32_t his[8];
+    _mm256_storeu_si256((__m256i*)los, lo);
+    _mm256_storeu_si256((__m256i*)his, hi);
+    min_max_scalar(los, 8, mn, mx);
+    min_max_scalar(his, 8, mn, mx);
+  }
+  min_max_scalar(v + i, n - i, mn, mx);
+}
+
+// ---------------------------------------------------------------- SSE4.1
+
+__attribute__((target("sse4.1")))
+static size_t sum_lanes_sse4(__m128i acc) {
+  uint32_t lanes[4];
+  _mm_storeu_si128((__m128i*)lanes, acc);
+  return (size_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+__attribute__((target("sse4.1")))
+static size_t greater_sse4(const int32_t* v, size_t n, int32_t x) {
+  __m128i key = _mm_set1_epi32(x);
+  __m128i acc0 = _mm_setzero_si128();
+  __m128i acc1 = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i a = _mm_loadu_si128((const __m128i*)(v + i));
+    __m128i b = _mm_loadu_si128((const __m128i*)(v + i + 4));
+    acc0 = _mm_sub_epi32(acc0, _mm_cmpgt_epi32(a, key));
+    acc1 = _mm_sub_epi32(acc1, _mm_cmpgt_epi32(b, key));
+  }
+  return sum_lanes_sse4(_mm_add_epi32(acc0, acc1)) + greater_scalar(v + i, n - i, x);
+}
+
+__attribute__((target("sse4.1")))
+static size_t equal_sse4(const int32_t* v, size_t n, int32_t x) {
+  __m128i key = _mm_set1_epi32(x);
+  __m128i acc0 = _mm_setzero_si128();
+  __m128i acc1 = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i a = _mm_loadu_si128((const __m128i*)(v + i));
+    __m128i b = _mm_loadu_si128((const __m128i*)(v + i + 4));
+    acc0 = _mm_sub_epi32(acc0, _mm_cmpeq_epi32(a, key));
+    acc1 = _mm_sub_epi32(acc1, _mm_cmpeq_epi32(b, key));
+  }
+  return sum_lanes_sse4(_mm_add_epi32(acc0, acc1)) + equal_scalar(v + i, n - i, x);
+}
+
+__attribute__((target("sse4.1")))
+static size_t in_range_sse4(const int32_t* v, size_t n, int32_t lo, int32_t hi) {
+  __m128i low = _mm_set1_epi32(lo);
+  __m128i high = _mm_set1_epi32(hi);
+  __m128i ones = _mm_set1_epi32(-1);
+  __m128i acc0 = _mm_setzero_si128();
+  __m128i acc1 = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i a = _mm_loadu_si128((const __m128i*)(v + i));
+    __m128i b = _mm_loadu_si128((const __m128i*)(v + i + 4));
+    __m128i outA = _mm_or_si128(_mm_cmpgt_epi32(low, a), _mm_cmpgt_epi32(a, high));
+    __m128i outB = _mm_or_si128(_mm_cmpgt_epi32(low, b), _mm_cmpgt_epi32(b, high));
+    acc0 = _mm_sub_epi32(acc0, _mm_andnot_si128(outA, ones));
+    acc1 = _mm_sub_epi32(acc1, _mm_andnot_si128(outB, ones));
+  }
+  return sum_lanes_sse4(_mm_add_epi32(acc0, acc1)) + in_range_scalar(v + i, n - i, lo, hi);
+}
+
+__attribute__((target("sse4.1")))
+static void min_max_sse4(const int32_t* v, size_t n, int32_t& mn, int32_t& mx) {
+  size_t i = 0;
+  if (n >= 4) {
+    __m128i lo = _mm_loadu_si128((const __m128i*)v);
+    __m128i hi = lo;
+    for (i = 4; i + 4 <= n; i += 4) {
+      __m128i a = _mm_loadu_si128((const __m128i*)(v + i));
+      lo = _mm_min_epi32(lo, a);
+      hi = _mm_max_epi32(hi, a);
+    }
+    int32_t los[4];
+    int32_t his[4];
+    _mm_storeu_si128((__m128i*)los, lo);
+    _mm_storeu_si128((__m128i*)his, hi);
+    min_max_scalar(los, 4, mn, mx);
+    min_max_scalar(his, 4, mn, mx);
+  }
+  min_max_scalar(v + i, n - i, mn, mx);
+}
+
+#endif // SCORE_SCAN_X86
+
+// -------------------------------------------------------------- dispatch
+
+bool scan_kernel_supported(ScanKernel k) {
+#ifdef SCORE_SCAN_X86
+  if (k == ScanKernel::AVX2) return __builtin_cpu_supports("avx2");
+  if (k == ScanKernel::SSE4) return __builtin_cpu_supports("sse4.1");
+#endif
+  return k == ScanKernel::Scalar;
+}
+
+ScanKernel best_scan_kernel() {
+  static const ScanKernel best = scan_kernel_supported(ScanKernel::AVX2) ? ScanKernel::AVX2
+                               : scan_kernel_supported(ScanKernel::SSE4) ? ScanKernel::SSE4
+                               : ScanKernel::Scalar;
+  return best;
+}
+
+size_t scan_count_greater(const int32_t* v, size_t n, int32_t x, ScanKernel k) {
+#ifdef SCORE_SCAN_X86
+  if (k == ScanKernel::AVX2) return greater_avx2(v, n, x);
+  if (k == ScanKernel::SSE4) return greater_sse4(v, n, x);
+#endif
+  (void)k;
+  return greater_scalar(v, n, x);
+}
+
+size_t scan_count_equal(const int32_t* v, size_t n, int32_t x, ScanKernel k) {
+#ifdef SCORE_SCAN_X86
+  if (k == ScanKernel::AVX2) return equal_avx2(v, n, x);
+  if (k == ScanKernel::SSE4) return equal_sse4(v, n, x);
+#endif
+  (void)k;
+  return equal_scalar(v, n, x);
+}
+
+size_t scan_count_in_range(const int32_t* v, size_t n, int32_t lo, int32_t hi, ScanKernel k) {
+  if (lo > hi) return 0;
+#ifdef SCORE_SCAN_X86
+  if (k == ScanKernel::AVX2) return in_range_avx2(v, n, lo, hi);
+  if (k == ScanKernel::SSE4) return in_range_sse4(v, n, lo, hi);
+#endif
+  (void)k;
+  return in_range_scalar(v, n, lo, hi);
+}
+
+bool scan_min_max(const int32_t* v, size_t n, int32_t& outMin, int32_t& outMax, ScanKernel k) {
+  if (n == 0) return false;
+  int32_t mn = v[0];
+  int32_t mx = v[0];
+#ifdef SCORE_SCAN_X86
+  if (k == ScanKernel::AVX2) min_max_avx2(v, n, mn, mx);
+  else if (k == ScanKernel::SSE4) min_max_sse4(v, n, mn, mx);
+  else min_max_scalar(v, n, mn, mx);
+#else
+  (void)k;
+  min_max_scalar(v, n, mn, mx);
+#endif
+  outMin = mn;
+  outMax = mx;
+  return true;
+}
+
+size_t scan_count_greater(const int32_t* v, size_t n, int32_t x) {
+  return scan_count_greater(v, n, x, best_scan_kernel());
+}
+
+size_t scan_count_equal(const int32_t* v, size_t n, int32_t x) {
+  return scan_count_equal(v, n, x, best_scan_kernel());
+}
+
+size_t scan_count_in_range(const int32_t* v, size_t n, int32_t lo, int32_t hi) {
+  return scan_count_in_range(v, n, lo, hi, best_scan_kernel());
+}
+
+bool scan_min_max(const int32_t* v, size_t n, int32_t& outMin, int32_t& outMax) {
+  return scan_min_max(v, n, outMin, outMax, best_scan_kernel());
+}
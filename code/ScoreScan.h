@@ -0,0 +1,43 @@
+#ifndef SCORE_SCAN_H__
+#define SCORE_SCAN_H__
+
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+// Scan kernels over a contiguous array of int32 scores (Leaderboard keeps
+// one next to its player array). Each kernel reads the array once, front
+// to back, so a scan runs at close to memory bandwidth once it is
+// vectorized.
+//
+// There are three implementations of every kernel: AVX2 (8 scores per
+// instruction), SSE4.1 (4) and plain C++. Calls without a kernel use the
+// fastest the CPU supports, detected once at run time, so one binary runs
+// everywhere. Other architectures, and compilers without GCC/Clang
+// target attributes, get the scalar code.
+
+enum class ScanKernel { Scalar, SSE4, AVX2 };
+
+// the fastest kernel this CPU runs
+ScanKernel best_scan_kernel();
+
+// true if this CPU can run kernel k
+bool scan_kernel_supported(ScanKernel k);
+
+// how many of v[0..n) are > x / == x / in [lo, hi] (0 if lo > hi)
+size_t scan_count_greater(const int32_t* v, size_t n, int32_t x);
+size_t scan_count_equal(const int32_t* v, size_t n, int32_t x);
+size_t scan_count_in_range(const int32_t* v, size_t n, int32_t lo, int32_t hi);
+
+// smallest and largest of v[0..n); false (and no change) if n == 0
+bool scan_min_max(const int32_t* v, size_t n, int32_t& outMin, int32_t& outMax);
+
+// the same with the kernel chosen by the caller, for tests and benchmarks.
+// k must be supported (scan_kernel_supported).
+size_t scan_count_greater(const int32_t* v, size_t n, int32_t x, ScanKernel k);
+size_t scan_count_equal(const int32_t* v, size_t n, int32_t x, ScanKernel k);
+size_t scan_count_in_range(const int32_t* v, size_t n, int32_t lo, int32_t hi, ScanKernel k);
+bool scan_min_max(const int32_t* v, size_t n, int32_t& outMin, int32_t& outMax, ScanKernel k);
+
+#endif // SCORE_SCAN_H__
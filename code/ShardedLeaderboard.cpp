@@ -0,0 +1,139 @@
+/* Please refer to the header file (ShardedLeaderboard.h) for documentation of each method. */
+
+#include "ShardedLeaderboard.h"
+#include <algorithm>  // heap operations for the merge
+#include <iostream>
+using namespace std;
+
+// rows pulled from a shard at a time while merging
+static const int kMergePage = 256;
+
+ShardedLeaderboard::ShardedLeaderboard(int shardCount, const LeaderboardOptions& options) : shards() {
+  for (int i = 0; i < shardCount; i++) shards.push_back(make_unique<Leaderboard>(options));
+}
+
+void ShardedLeaderboard::addOrUpdate(int s, const string& name, int score) {
+  shards[(size_t)s]->addOrUpdate(name, score);
+}
+
+int ShardedLeaderboard::size() const {
+  int total = 0;
+  for (size_t i = 0; i < shards.size(); i++) total += shards[i]->size();
+  return total;
+}
+
+int ShardedLeaderboard::shardOf(const string& name) const {
+  int score = 0;
+  for (size_t i = 0; i < shards.size(); i++) {
+    if (shards[i]->getScore(name, score)) return (int)i;
+  }
+  return -1;
+}
+
+bool ShardedLeaderboard::computeGlobalRank(const string& name, RankInfo& outInfo) const {
+  int s = shardOf(name);
+  int score = 0;
+  if (s < 0 || !shards[(size_t)s]->getScore(name, score)) return false;
+  // players above the score and tied on it, shard by shard
+  int above = 0;
+  int tied = 0;
+  int total = 0;
+  for (size_t i = 0; i < shards.size(); i++) {
+    int a = 0;
+    int t = 0;
+    shards[i]->countAround(score, a, t);
+    above += a;
+    tied += t;
+    total += shards[i]->size();
+  }
+  outInfo.score = score;
+  outInfo.rank = above + 1;
+  outInfo.sameScoreCount = tied;
+  outInfo.totalPlayers = total;
+  return true;
+}
+
+// ShardRows streams one shard's rows in leaderboard order, a page at a time.
+// The first page comes from topK, which is the shard's materialized list
+// when it keeps one long enough; later ones from Leaderboard::rows.
+struct ShardRows {
+  const Leaderboard* board;
+  int pageRows;
+  TopKView page;
+  size_t at;     // next row in page
+  int next;      // board position of the row after page
+
+  ShardRows(const Leaderboard* b, int rows) : board(b), pageRows(rows), page(), at(0), next(0) {
+    page = board->topK(pageRows);
+    next = (int)page.size();
+  }
+
+  // the current row, or NULL once the shard is used up
+  const Player* row() const { return at < page.size() ? &page[at] : NULL; }
+
+  void advance() {
+    if (++at < page.size() || (int)page.size() < pageRows) return;
+    // the page was full: there may be more rows
+    vector<Player> rows = board->rows(next, pageRows);
+    next += (int)rows.size();
+    size_t n = rows.size();
+    page = TopKView(make_shared<vector<Player> >(std::move(rows)), n);
+    at = 0;
+  }
+};
+
+// merge keeps one cursor per shard on a heap ordered by each cursor's
+// current row; the best row is always on top. Names are unique across
+// shards, so rows never tie.
+template <class Visit>
+void ShardedLeaderboard::merge(int limit, Visit visit) const {
+  int pageRows = (limit >= 0 && limit < kMergePage) ? max(limit, 1) : kMergePage;
+  vector<ShardRows> cursors;
+  cursors.reserve(shards.size());
+  for (size_t i = 0; i < shards.size(); i++) cursors.push_back(ShardRows(shards[i].get(), pageRows));
+
+  // heap of cursor numbers; std heaps put the largest on top, so "larger"
+  // here means later in leaderboard order is smaller
+  auto after = [&cursors](size_t a, size_t b) {
+    const Player* x = cursors[a].row();
+    const Player* y = cursors[b].row();
+    if (x->score != y->score) return x->score < y->score;
+    return x->name > y->name;
+  };
+  vector<size_t> heap;
+  for (size_t i = 0; i < cursors.size(); i++) {
+    if (cursors[i].row() != NULL) heap.push_back(i);
+  }
+  make_heap(heap.begin(), heap.end(), after);
+  for (int emitted = 0; !heap.empty() && (limit < 0 || emitted < limit); emitted++) {
+    pop_heap(heap.begin(), heap.end(), after);
+    ShardRows& c = cursors[heap.back()];
+    visit(*c.row());
+    c.advance();
+    if (c.row() != NULL) push_heap(heap.begin(), heap.end(), after);
+    else heap.pop_back();
+  }
+}
+
+vector<Player> ShardedLeaderboard::topK(int k) const {
+  vector<Player> out;
+  if (k <= 0) return out;
+  merge(k, [&out](const Player& p) { out.push_back(p); });
+  return out;
+}
+
+void ShardedLeaderboard::printAll() const {
+  cout << "=== Leaderboard (highest first) ===\n";
+  int pos = 1;
+  merge(-1, [&pos](const Player& p) {
+    cout << pos << ". " << p.name << " : " << p.score << "\n";
+    pos++;
+  });
+}
+
+bool ShardedLeaderboard::validateTree() const {
+  for (size_t i = 0; i < shards.size(); i++) {
+    if (!shards[i]->validateTree()) return false;
+  }
+  return true;
+}
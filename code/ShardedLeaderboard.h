@@ -0,0 +1,70 @@
+#ifndef SHARDED_LEADERBOARD_H__
+#define SHARDED_LEADERBOARD_H__
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "Leaderboard.h"
+
+using namespace std;
+
+// ShardedLeaderboard splits the players between N Leaderboard shards, e.g.
+// one per region. Each shard is a complete board, so regional ranks, top-K,
+// ranges and percentiles come straight from shard(i). Global answers are put
+// together from the shards without copying or sorting the whole population:
+//  - global rank: each shard counts the players above the score and tied on
+//    it (Leaderboard::countAround, O(log n)) and the counts are added up,
+//    O(N log n) in all.
+//  - global topK and printAll: a streaming k-way merge over the shards'
+//    rows in leaderboard order. A shard's rows are pulled a page at a time,
+//    only once the merge reaches them, so topK(k) reads about k rows per
+//    shard (from the shard's materialized list when topRows >= k).
+//
+// A player belongs to one shard: the caller sends all of a player's updates
+// to the same one. Shards share nothing, so different threads may update
+// different shards at the same time. With options.concurrent every shard
+// also locks itself and any call may come from any thread; a global answer
+// then reads the shards one after another rather than as one frozen view.
+class ShardedLeaderboard {
+public:
+  // shardCount boards, each built with options
+  explicit ShardedLeaderboard(int shardCount, const LeaderboardOptions& options = LeaderboardOptions());
+
+  int shardCount() const { return (int)shards.size(); }
+
+  // the board of one shard, for regional queries
+  Leaderboard& shard(int i) { return *shards[(size_t)i]; }
+  const Leaderboard& shard(int i) const { return *shards[(size_t)i]; }
+
+  // add or update name on shard s
+  void addOrUpdate(int s, const string& name, int score);
+
+  // players over all shards
+  int size() const;
+
+  // the shard name is on, or -1. Probes each shard's name index.
+  int shardOf(const string& name) const;
+
+  // rank info across all shards, as Leaderboard::computeRank; false if name
+  // is on no shard.
+  bool computeGlobalRank(const string& name, RankInfo& outInfo) const;
+
+  // the first k rows across all shards, highest first
+  vector<Player> topK(int k) const;
+
+  // print every player across all shards, highest first
+  void printAll() const;
+
+  // every shard's validateTree
+  bool validateTree() const;
+
+private:
+  vector<unique_ptr<Leaderboard> > shards;
+
+  // the k-way merge: visit(row) for the first limit rows across the
+  // shards in leaderboard order (limit < 0: all of them)
+  template <class Visit>
+  void merge(int limit, Visit visit) const;
+};
+
+#endif // SHARDED_LEADERBOARD_H__
@@ -0,0 +1,339 @@
+#include "SnapshotFile.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+using namespace std;
+
+// ------------------------------------------------------------- file layout
+
+static const char kMagic[8] = {'R', 'B', 'T', 'L', 'B', 'S', 'N', 'P'};
+static const uint32_t kEndian = 0x01020304;
+
+struct snap_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t endian;        // kEndian as written by this machine
+  uint64_t players;
+  uint64_t runs;          // distinct scores
+  uint64_t rows_off;
+  uint64_t table_off;
+  uint64_t table_cap;     // power of two, always more than players
+  uint64_t runs_off;
+  uint64_t names_off;
+  uint64_t names_bytes;
+  uint64_t file_bytes;
+  uint64_t payload_sum;   // snap_sum of bytes [sizeof(snap_header), file_bytes)
+  uint64_t header_sum;    // snap_sum of the header bytes before this field
+};
+
+struct snap_row {
+  int32_t score;
+  uint32_t name_len;
+  uint64_t name_off;      // from the start of the names section
+};
+
+struct snap_slot {
+  uint32_t tag;           // hash of the name, 0 = empty bucket
+  uint32_t row;
+};
+
+struct snap_run {
+  int32_t score;
+  uint32_t first_row;     // first row holding this score
+};
+
+static_assert(sizeof(snap_header) == 104, "snapshot header layout");
+static_assert(sizeof(snap_row) == 16 && sizeof(snap_slot) == 8 && sizeof(snap_run) == 8,
+              "snapshot record layout");
+
+// checksum: 64-bit FNV-1a taken over 8-byte words (bytes in file order, read
+// as native integers), then over the 0-7 bytes left at the end. Word steps
+// make it about eight times faster than byte steps, which matters when a
+// multi-GB snapshot is verified. It can be fed in pieces of any size.
+struct snap_sum {
+  uint64_t h = 1469598103934665603ULL;
+  unsigned char tail[8];
+  size_t ntail = 0;
+  void mix(uint64_t w) {
+    h ^= w;
+    h *= 1099511628211ULL;
+  }
+  void add(const void* p, size_t n) {
+    const unsigned char* b = (const unsigned char*)p;
+    while (ntail > 0 && ntail < 8 && n > 0) {  // finish a word begun earlier
+      tail[ntail++] = *b++;
+      n--;
+    }
+    if (ntail == 8) {
+      uint64_t w;
+      memcpy(&w, tail, 8);
+      mix(w);
+      ntail = 0;
+    }
+    for (; n >= 8; b += 8, n -= 8) {
+      uint64_t w;
+      memcpy(&w, b, 8);
+      mix(w);
+    }
+    while (n > 0) {
+      tail[ntail++] = *b++;
+      n--;
+    }
+  }
+  uint64_t value() const {
+    snap_sum s = *this;
+    for (size_t i = 0; i < s.ntail; i++) s.mix(s.tail[i]);
+    return s.h;
+  }
+};
+
+// name hash stored in the table. It is part of the format, so it must not
+// depend on the standard library (std::hash may change between builds).
+static uint32_t snap_hash(const char* p, size_t n) {
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < n; i++) {
+    h ^= (unsigned char)p[i];
+    h *= 16777619u;
+  }
+  return h == 0 ? 1 : h;
+}
+
+static uint64_t header_checksum(const snap_header& h) {
+  snap_sum f;
+  f.add(&h, offsetof(snap_header, header_sum));
+  return f.value();
+}
+
+static uint64_t align8(uint64_t x) { return (x + 7) & ~(uint64_t)7; }
+
+// ------------------------------------------------------------------ write
+
+// out writes through a large buffer and checksums everything after the header
+struct snap_out {
+  FILE* f;
+  snap_sum sum;
+  uint64_t pos;
+  bool ok;
+  void put(const void* p, size_t n) {
+    sum.add(p, n);
+    if (fwrite(p, 1, n, f) != n) ok = false;
+    pos += n;
+  }
+  void pad_to(uint64_t off) {
+    static const char zeros[8] = {0};
+    while (pos < off) put(zeros, (size_t)(off - pos < 8 ? off - pos : 8));
+  }
+};
+
+bool SnapshotFile::write(const string& path, size_t n, const function<SnapshotRow(size_t)>& row_at) {
+  snap_header h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, kMagic, sizeof(kMagic));
+  h.version = kVersion;
+  h.endian = kEndian;
+  h.players = n;
+
+  // one pass over the rows (row_at may be walking a tree): copy them into
+  // the row and name sections, and build the runs and the name table
+  size_t cap = 16;
+  while (cap * 7 < n * 10 + 10) cap *= 2;   // load factor below 0.7
+  vector<snap_slot> slots(cap);
+  memset(slots.data(), 0, cap * sizeof(snap_slot));
+  vector<snap_row> rowList(n);
+  vector<snap_run> runList;
+  vector<char> nameList;
+  for (size_t i = 0; i < n; i++) {
+    SnapshotRow r = row_at(i);
+    if (runList.empty() || runList.back().score != r.score) {
+      snap_run run;
+      run.score = r.score;
+      run.first_row = (uint32_t)i;
+      runList.push_back(run);
+    }
+    uint32_t tag = snap_hash(r.name, r.nameLen);
+    size_t j = tag & (cap - 1);
+    while (slots[j].tag != 0) j = (j + 1) & (cap - 1);
+    slots[j].tag = tag;
+    slots[j].row = (uint32_t)i;
+    rowList[i].score = r.score;
+    rowList[i].name_len = r.nameLen;
+    rowList[i].name_off = nameList.size();
+    nameList.insert(nameList.end(), r.name, r.name + r.nameLen);
+  }
+
+  h.runs = runList.size();
+  h.rows_off = align8(sizeof(snap_header));
+  h.table_off = h.rows_off + n * sizeof(snap_row);
+  h.table_cap = cap;
+  h.runs_off = h.table_off + cap * sizeof(snap_slot);
+  h.names_off = h.runs_off + runList.size() * sizeof(snap_run);
+  h.names_bytes = nameList.size();
+  h.file_bytes = h.names_off + nameList.size();
+
+  string tmp = path + ".tmp";
+  FILE* f = fopen(tmp.c_str(), "wb");
+  if (f == NULL) return false;
+
+  snap_out out;
+  out.f = f;
+  out.pos = 0;
+  out.ok = fwrite(&h, 1, sizeof(h), f) == sizeof(h);  // rewritten with the sums
+  out.pos = sizeof(h);
+  out.pad_to(h.rows_off);
+  if (n > 0) out.put(rowList.data(), n * sizeof(snap_row));
+  out.put(slots.data(), cap * sizeof(snap_slot));
+  if (!runList.empty()) out.put(runList.data(), runList.size() * sizeof(snap_run));
+  if (!nameList.empty()) out.put(nameList.data(), nameList.size());
+
+  h.payload_sum = out.sum.value();
+  h.header_sum = header_checksum(h);
+  bool ok = out.ok && fseek(f, 0, SEEK_SET) == 0 && fwrite(&h, 1, sizeof(h), f) == sizeof(h);
+  ok = (fflush(f) == 0) && ok;
+  ok = ok && fsync(fileno(f)) == 0;
+  ok = (fclose(f) == 0) && ok;
+  if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+    remove(tmp.c_str());
+    return false;
+  }
+  // make the rename itself durable (a checkpoint may replace a journal)
+  size_t slash = path.rfind('/');
+  string dir = (slash == string::npos) ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+  int dfd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+  if (dfd >= 0) {
+    fsync(dfd);
+    close(dfd);
+  }
+  return true;
+}
+
+// ------------------------------------------------------------------- open
+
+SnapshotFile::SnapshotFile()
+  : base(NULL), bytes(0), players(0), runs(0), tableCap(0), namesBytes(0),
+    rowsAt(NULL), table(NULL), runsAt(NULL), names(NULL) {}
+
+SnapshotFile::~SnapshotFile() {
+  if (base != NULL) munmap((void*)base, bytes);
+}
+
+// section_ok: [off, off + count * size) lies inside a file of len bytes
+static bool section_ok(uint64_t off, uint64_t count, uint64_t size, uint64_t len) {
+  if (off > len || (off & 7) != 0) return false;
+  return count <= (len - off) / size;
+}
+
+unique_ptr<SnapshotFile> SnapshotFile::open(const string& path, bool verify) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) return NULL;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(snap_header)) {
+    close(fd);
+    return NULL;
+  }
+  size_t len = (size_t)st.st_size;
+  void* m = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);  // the mapping keeps the file alive
+  if (m == MAP_FAILED) return NULL;
+
+  unique_ptr<SnapshotFile> s(new SnapshotFile());
+  s->base = (const unsigned char*)m;
+  s->bytes = len;
+
+  // header only: the rest of the file is paged in by the queries that need it
+  const snap_header& h = *(const snap_header*)m;
+  if (memcmp(h.magic, kMagic, sizeof(kMagic)) != 0 || h.version != kVersion ||
+      h.endian != kEndian || h.header_sum != header_checksum(h) || h.file_bytes != len) {
+    return NULL;
+  }
+  if (h.table_cap == 0 || (h.table_cap & (h.table_cap - 1)) != 0 || h.table_cap <= h.players ||
+      h.players > 0xffffffffULL ||
+      !section_ok(h.rows_off, h.players, sizeof(snap_row), len) ||
+      !section_ok(h.table_off, h.table_cap, sizeof(snap_slot), len) ||
+      !section_ok(h.runs_off, h.runs, sizeof(snap_run), len) ||
+      h.names_off > len || h.names_bytes > len - h.names_off) {
+    return NULL;
+  }
+  s->players = (size_t)h.players;
+  s->runs = (size_t)h.runs;
+  s->tableCap = (size_t)h.table_cap;
+  s->namesBytes = (size_t)h.names_bytes;
+  s->rowsAt = (const snap_row*)(s->base + h.rows_off);
+  s->table = (const snap_slot*)(s->base + h.table_off);
+  s->runsAt = (const snap_run*)(s->base + h.runs_off);
+  s->names = (const char*)(s->base + h.names_off);
+
+  // lookups jump around the file; read-ahead would only page in unused data
+  madvise(m, len, MADV_RANDOM);
+  if (verify && !s->verify()) return NULL;
+  return s;
+}
+
+// ---------------------------------------------------------------- queries
+
+string_view SnapshotFile::nameAt(size_t row) const {
+  const snap_row& r = rowsAt[row];
+  // a damaged row must not point outside the mapping
+  if (r.name_off > namesBytes || r.name_len > namesBytes - r.name_off) return string_view();
+  return string_view(names + r.name_off, r.name_len);
+}
+
+int SnapshotFile::scoreAt(size_t row) const {
+  return rowsAt[row].score;
+}
+
+long SnapshotFile::find(const string& name) const {
+  if (players == 0) return -1;
+  uint32_t tag = snap_hash(name.data(), name.size());
+  size_t mask = tableCap - 1;
+  // the table is never full, but a damaged one might be: stop after one lap
+  for (size_t i = tag & mask, probes = 0; table[i].tag != 0 && probes < tableCap;
+       i = (i + 1) & mask, probes++) {
+    if (table[i].tag == tag && table[i].row < players && nameAt(table[i].row) == name) {
+      return (long)table[i].row;
+    }
+  }
+  return -1;
+}
+
+void SnapshotFile::rankOf(int score, int& above, int& tied) const {
+  // first run whose score is not higher than score (runs are descending)
+  size_t lo = 0;
+  size_t hi = runs;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (runsAt[mid].score > score) lo = mid + 1;
+    else hi = mid;
+  }
+  above = (lo < runs) ? (int)runsAt[lo].first_row : (int)players;
+  tied = 0;
+  if (lo < runs && runsAt[lo].score == score) {
+    size_t next = (lo + 1 < runs) ? runsAt[lo + 1].first_row : players;
+    tied = (int)(next - runsAt[lo].first_row);
+  }
+}
+
+bool SnapshotFile::verify() const {
+  const snap_header& h = *(const snap_header*)base;
+  snap_sum f;
+  f.add(base + sizeof(snap_header), bytes - sizeof(snap_header));
+  if (f.value() != h.payload_sum) return false;
+
+  // rows in leaderboard order, and one run per distinct score
+  size_t run = 0;
+  for (size_t i = 0; i < players; i++) {
+    if (i > 0) {
+      int a = scoreAt(i - 1);
+      int b = scoreAt(i);
+      if (a < b || (a == b && !(nameAt(i - 1) < nameAt(i)))) return false;
+    }
+    if (i == 0 || scoreAt(i) != scoreAt(i - 1)) {
+      if (run >= runs || runsAt[run].first_row != i || runsAt[run].score != scoreAt(i)) return false;
+      run++;
+    }
+  }
+  return run == runs;
+}
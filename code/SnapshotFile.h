@@ -0,0 +1,95 @@
+#ifndef SNAPSHOT_FILE_H__
+#define SNAPSHOT_FILE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+// SnapshotFile is the leaderboard's on-disk snapshot: a versioned,
+// checksummed binary file that is used in place through mmap.
+//
+// Every section is addressed by a byte offset from the start of the file, so
+// the mapping can land anywhere in memory and nothing is rebuilt on open:
+//
+//   header    snap_header (fixed size, checksummed on every open)
+//   rows      snap_row[players]      players in leaderboard order (row = position)
+//   table     snap_slot[table_cap]   name -> row, open addressing, linear probing
+//   runs      snap_run[runs]         one per distinct score, highest first
+//   names     name bytes, not terminated, referenced by rows
+//
+// A name lookup is one probe sequence in the table plus one row, and a rank
+// is a binary search over the runs, so a query only faults in the few pages
+// it touches. Opening a 10M-player file costs the mmap call and the header.
+//
+// Integers are stored in the writing machine's byte order; the header records
+// it and a file from a machine of the other order is rejected.
+
+// one player handed to SnapshotFile::write (name is not copied)
+struct SnapshotRow {
+  int score;
+  const char* name;
+  uint32_t nameLen;
+};
+
+// on-disk records, defined in SnapshotFile.cpp
+struct snap_row;
+struct snap_slot;
+struct snap_run;
+
+class SnapshotFile {
+public:
+  static const uint32_t kVersion = 1;
+
+  // write stores n rows, given in leaderboard order by row_at(i), at path.
+  // row_at is called once per row with i = 0, 1, ..., n-1, so the caller may
+  // stream rows from an inorder walk instead of indexing them.
+  // The file is written next to path and renamed over it once complete, so a
+  // crash never leaves a half-written snapshot behind. Returns false on I/O
+  // errors.
+  static bool write(const string& path, size_t n, const function<SnapshotRow(size_t)>& row_at);
+
+  // open maps path read-only. Returns NULL if the file is missing, too
+  // short, from another format version or byte order, or fails the header
+  // checksum. verify also checks the payload checksum, which reads the
+  // whole file.
+  static unique_ptr<SnapshotFile> open(const string& path, bool verify);
+
+  ~SnapshotFile();
+  SnapshotFile(const SnapshotFile&) = delete;
+  SnapshotFile& operator=(const SnapshotFile&) = delete;
+
+  size_t size() const { return players; }
+
+  // find returns the row (leaderboard position, 0-based) of name, or -1.
+  long find(const string& name) const;
+
+  int scoreAt(size_t row) const;
+  string_view nameAt(size_t row) const;
+
+  // rankOf reports how many players score above score and how many hold it.
+  void rankOf(int score, int& above, int& tied) const;
+
+  // verify re-reads the whole file: payload checksum, row order and runs.
+  bool verify() const;
+
+private:
+  SnapshotFile();
+
+  const unsigned char* base;   // start of the mapping
+  size_t bytes;                // mapped length
+  size_t players;
+  size_t runs;
+  size_t tableCap;
+  size_t namesBytes;
+  const snap_row* rowsAt;
+  const snap_slot* table;
+  const snap_run* runsAt;
+  const char* names;
+};
+
+#endif // SNAPSHOT_FILE_H__
@@ -0,0 +1,130 @@
+/* Please refer to the header file (WindowedLeaderboard.h) for documentation of each method. */
+
+#include "WindowedLeaderboard.h"
+#include <iostream>
+using namespace std;
+
+WindowedLeaderboard::WindowedLeaderboard() : names(), index() {
+  for (int w = 0; w < kLeaderboardWindows; w++) {
+    windows[w].generation = 1;   // stamps start at 0: nobody is in a new window
+    resetWindow(windows[w]);
+  }
+}
+
+// the new index is built first and swapped in; the old one goes when its
+// unique_ptr is overwritten. WindowKeys own nothing, so ~RBT skips the node
+// walk and just frees the slabs.
+void WindowedLeaderboard::resetWindow(Window& win) {
+  WindowOrder order;
+  order.names = &names;
+  win.tree = make_unique<WindowTree>(order);
+  win.scores = make_unique<ScoreCounts>(greater<int>(), RBDuplicates::Counted);
+}
+
+void WindowedLeaderboard::rollover(LeaderboardWindow w) {
+  Window& win = windows[(int)w];
+  resetWindow(win);
+  // every stamp now belongs to an older generation, so every per-slot score
+  // is stale without touching the arrays
+  win.generation++;
+}
+
+int WindowedLeaderboard::slotIn(const Window& win, const string& name) const {
+  int slot = index.find(name, [this](int s) -> const string& { return names[(size_t)s]; });
+  if (slot < 0 || win.stamp[(size_t)slot] != win.generation) return -1;
+  return slot;
+}
+
+void WindowedLeaderboard::addOrUpdate(const string& name, int score) {
+  int slot = index.find_or_insert(name, (int)names.size(), [this](int s) -> const string& {
+    return names[(size_t)s];
+  });
+  if (slot < 0) {
+    // new name: one copy of it, and an empty entry in every window
+    slot = (int)names.size();
+    names.push_back(name);
+    for (int w = 0; w < kLeaderboardWindows; w++) {
+      windows[w].score.push_back(0);
+      windows[w].stamp.push_back(0);
+    }
+  }
+  WindowKey key;
+  key.slot = slot;
+  for (int w = 0; w < kLeaderboardWindows; w++) {
+    Window& win = windows[w];
+    if (win.stamp[(size_t)slot] == win.generation) {
+      int old = win.score[(size_t)slot];
+      if (old == score) continue;
+      key.score = old;
+      win.tree->remove(key);
+      win.scores->remove(old);
+    } else {
+      win.stamp[(size_t)slot] = win.generation;   // first score in this window
+    }
+    win.score[(size_t)slot] = score;
+    key.score = score;
+    win.tree->insert_data(key);
+    win.scores->insert_data(score);
+  }
+}
+
+int WindowedLeaderboard::size(LeaderboardWindow w) const {
+  const WindowTree& t = *window(w).tree;
+  return t.size(t.get_root());
+}
+
+bool WindowedLeaderboard::getScore(LeaderboardWindow w, const string& name, int& outScore) const {
+  const Window& win = window(w);
+  int slot = slotIn(win, name);
+  if (slot < 0) return false;
+  outScore = win.score[(size_t)slot];
+  return true;
+}
+
+bool WindowedLeaderboard::computeRank(LeaderboardWindow w, const string& name, RankInfo& outInfo) const {
+  const Window& win = window(w);
+  int slot = slotIn(win, name);
+  if (slot < 0) return false;
+  int sc = win.score[(size_t)slot];
+  rb_rank r = win.scores->rank(sc);
+  outInfo.score = sc;
+  outInfo.rank = r.less + 1;
+  outInfo.sameScoreCount = r.equal;
+  outInfo.totalPlayers = size(w);
+  return true;
+}
+
+vector<Player> WindowedLeaderboard::topK(LeaderboardWindow w, int k) const {
+  vector<Player> out;
+  const WindowTree& t = *window(w).tree;
+  for (WindowTree::const_iterator it = t.begin(); it != t.end() && (int)out.size() < k; ++it) {
+    Player p;
+    p.name = names[(size_t)it->data.slot];
+    p.score = it->data.score;
+    out.push_back(p);
+  }
+  return out;
+}
+
+void WindowedLeaderboard::printAll(LeaderboardWindow w) const {
+  static const char* const titles[kLeaderboardWindows] = {"Daily", "Weekly", "All-time"};
+  cout << "=== " << titles[(int)w] << " leaderboard (highest first) ===\n";
+  int pos = 1;
+  for (const WindowTree::node_type& n : *window(w).tree) {
+    cout << pos << ". " << names[(size_t)n.data.slot] << " : " << n.data.score << "\n";
+    pos++;
+  }
+}
+
+bool WindowedLeaderboard::validate() const {
+  for (int w = 0; w < kLeaderboardWindows; w++) {
+    const Window& win = windows[w];
+    if (!win.tree->validate() || !win.scores->validate()) return false;
+    if (win.scores->size(win.scores->get_root()) != win.tree->size(win.tree->get_root())) return false;
+  }
+  return true;
+}
+
+rb_mem_stats WindowedLeaderboard::treeMemory(LeaderboardWindow w) const {
+  return window(w).tree->mem_stats();
+}
@@ -0,0 +1,115 @@
+#ifndef WINDOWED_LEADERBOARD_H__
+#define WINDOWED_LEADERBOARD_H__
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "RBT.h"
+#include "NameIndex.h"
+#include "Leaderboard.h"   // Player, RankInfo, ScoreCounts
+
+using namespace std;
+
+// the time windows a WindowedLeaderboard ranks players over
+enum class LeaderboardWindow { Daily, Weekly, AllTime };
+static const int kLeaderboardWindows = 3;
+
+// key of a window's score index: the player's score in that window and their
+// slot in the shared name table. No string is copied into the index, so its
+// nodes are trivially destructible and a whole index is freed by releasing
+// its slabs, without visiting a node.
+struct WindowKey {
+  int score;
+  int slot;
+};
+
+// WindowOrder is ScoreOrder (score descending, then name) on WindowKeys,
+// reading the names from the shared table. Like ScoreOrder it also compares
+// against a bare score.
+struct WindowOrder {
+  const vector<string>* names;
+
+  bool operator()(const WindowKey& a, const WindowKey& b) const {
+    if (a.score != b.score) return a.score > b.score;
+    if (a.slot == b.slot) return false;
+    return (*names)[(size_t)a.slot] < (*names)[(size_t)b.slot];
+  }
+  bool operator()(const WindowKey& a, int score) const { return a.score > score; }
+  bool operator()(int score, const WindowKey& a) const { return score > a.score; }
+};
+
+typedef RBT<WindowKey, rb_no_value, WindowOrder> WindowTree;
+
+// WindowedLeaderboard keeps daily, weekly and all-time boards over one set of
+// players. Each name is stored and hashed once, in a table the windows
+// share; every window has its own score index and score counts. One
+// addOrUpdate updates all three windows.
+//
+// A window lists the players who posted a score since it last rolled over,
+// each with the latest score they posted in it (addOrUpdate semantics, per
+// window). rollover(w) starts window w empty in O(1) in the number of
+// players: a fresh index is swapped in and the old one is freed in bulk, and
+// per-player window scores are dropped by bumping the window's generation
+// rather than by visiting them. The caller decides when a day or week ends.
+//
+// Not for sharing between threads.
+class WindowedLeaderboard {
+public:
+  WindowedLeaderboard();
+
+  // the windows' comparators point at this board's name table
+  WindowedLeaderboard(const WindowedLeaderboard&) = delete;
+  WindowedLeaderboard& operator=(const WindowedLeaderboard&) = delete;
+
+  // set name's score in every window; a name new to a window joins it.
+  // O(log n) per window whose score changes.
+  void addOrUpdate(const string& name, int score);
+
+  // empty window w. O(1) in the number of players (the old index's slabs
+  // are returned to the system in one go).
+  void rollover(LeaderboardWindow w);
+
+  // players on window w's board
+  int size(LeaderboardWindow w) const;
+
+  // name's score in window w; false if they have not posted in it
+  bool getScore(LeaderboardWindow w, const string& name, int& outScore) const;
+
+  // rank info within window w, as Leaderboard::computeRank. O(log n).
+  bool computeRank(LeaderboardWindow w, const string& name, RankInfo& outInfo) const;
+
+  // the first k rows of window w, highest first. O(log n + k).
+  vector<Player> topK(LeaderboardWindow w, int k) const;
+
+  // print window w's board, highest first.
+  void printAll(LeaderboardWindow w) const;
+
+  // every window's red–black invariants, and its counts agree with its index
+  bool validate() const;
+
+  // node memory of window w's score index
+  rb_mem_stats treeMemory(LeaderboardWindow w) const;
+
+private:
+  // one time window
+  struct Window {
+    unique_ptr<WindowTree> tree;      // players in the window, in leaderboard order
+    unique_ptr<ScoreCounts> scores;   // score -> players on it, for ranks
+    vector<int> score;                // per slot: score in this window ...
+    vector<uint32_t> stamp;           // ... valid only when stamp == generation
+    uint32_t generation;              // bumped by each rollover
+  };
+
+  vector<string> names;   // slot -> name, shared by all windows
+  NameIndex index;        // name -> slot
+  Window windows[kLeaderboardWindows];
+
+  const Window& window(LeaderboardWindow w) const { return windows[(int)w]; }
+  // a fresh, empty index and counts for win
+  void resetWindow(Window& win);
+  // slot of name in win, or -1 if the name is unknown or not in the window
+  int slotIn(const Window& win, const string& name) const;
+};
+
+#endif // WINDOWED_LEADERBOARD_H__
@@ -1,7 +1,17 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <climits>
+#include <csignal>
+#include <sys/resource.h>
 #include "Leaderboard.h"
+#include "WindowedLeaderboard.h"
+#include "ShardedLeaderboard.h"
 using namespace std;
 
 // if cond is false, print "[FAIL] <msg>" and exit with code 1 so CTest marks
@@ -35,6 +45,18 @@ int main() {
 
   expect(lb.computeRank("bob", r), "bob present");
   expect(r.score == 140, "bob score");
+  expect(r.rank == 2, "bob rank");
+  expect(lb.computeRank("carl", r) && r.rank == 1, "carl rank");
+  expect(r.totalPlayers == 4, "total players");
+
+  lb.addOrUpdate("alice", 80);  // tie with dina
+  expect(lb.computeRank("dina", r), "dina present");
+  expect(r.rank == 3 && r.sameScoreCount == 2, "tied rank and count");
+
+  // ties are listed by name, so the window below bob is alice then dina
+  vector<Player> win = lb.neighborsAround("dina", 1);
+  expect(win.size() == 2, "window clipped at the bottom");
+  expect(win[0].name == "alice" && win[1].name == "dina", "window order");
 
   // validateTree() calls RBT::validate() (root black, no red-red, equal black height).
   expect(lb.validateTree(), "RBT validate()");
@@ -42,6 +64,765 @@ int main() {
   vector<Player> near = lb.neighborsAround("bob", 1);
   expect(!near.empty(), "neighbors non-empty");
 
+  // bulk load: sorted input, then unsorted input with a repeated name
+  vector<Player> rows;
+  const char* names[] = {"zed", "amy", "bo", "cy", "di"};
+  int scores[] = {500, 400, 400, 300, 100};
+  for (int i = 0; i < 5; i++) {
+    Player p;
+    p.name = names[i];
+    p.score = scores[i];
+    rows.push_back(p);
+  }
+  Leaderboard bulk;
+  bulk.bulkLoad(rows);
+  expect(bulk.validateTree(), "bulk tree valid");
+  expect(bulk.computeRank("bo", r) && r.rank == 2 && r.sameScoreCount == 2, "bulk rank with tie");
+
+  rows[0].score = 50;          // zed now belongs at the bottom
+  rows.push_back(rows[1]);
+  rows.back().score = 600;     // amy repeated: last row wins
+  bulk.bulkLoad(rows);
+  expect(bulk.validateTree(), "unsorted bulk tree valid");
+  expect(bulk.computeRank("amy", r) && r.rank == 1 && r.totalPlayers == 5, "last row wins");
+  expect(bulk.computeRank("zed", r) && r.rank == 5, "unsorted input sorted");
+  bulk.addOrUpdate("zed", 1000);
+  expect(bulk.computeRank("zed", r) && r.rank == 1 && bulk.validateTree(), "update after bulk load");
+
+  // batch: repeated names keep the last write, unchanged scores are skipped
+  vector<pair<string, int> > batch;
+  batch.push_back(make_pair(string("bo"), 10));
+  batch.push_back(make_pair(string("cy"), 300));   // no-op
+  batch.push_back(make_pair(string("eve"), 700));  // new player
+  batch.push_back(make_pair(string("bo"), 900));   // wins over 10
+  int changed = bulk.applyBatch(batch);
+  expect(changed == 2, "batch coalesced and skipped no-ops");
+  expect(bulk.validateTree(), "valid after batch");
+  expect(bulk.computeRank("bo", r) && r.rank == 2 && r.score == 900, "last write wins in batch");
+  expect(bulk.computeRank("eve", r) && r.rank == 3 && r.totalPlayers == 6, "batch adds new player");
+
+  // concurrent mode: writers and readers share one board
+  LeaderboardOptions opts;
+  opts.concurrent = true;
+  opts.topRows = 5;
+  Leaderboard shared(opts);
+  vector<thread> workers;
+  for (int t = 0; t < 2; t++) {
+    workers.push_back(thread([&shared, t]() {
+      for (int i = 0; i < 2000; i++) {
+        shared.addOrUpdate("p" + to_string((i * 7 + t) % 500), i % 300);
+      }
+    }));
+    workers.push_back(thread([&shared]() {
+      RankInfo ri;
+      for (int i = 0; i < 2000; i++) {
+        if (shared.computeRank("p" + to_string(i % 500), ri)) {
+          expect(ri.rank >= 1 && ri.rank <= ri.totalPlayers, "concurrent rank in range");
+        }
+        shared.neighborsAround("p" + to_string(i % 500), 2);
+        TopKView best = shared.topK(5);
+        for (size_t j = 1; j < best.size(); j++) {
+          expect(best[j - 1].score >= best[j].score, "concurrent top-K in order");
+        }
+      }
+    }));
+  }
+  for (size_t i = 0; i < workers.size(); i++) workers[i].join();
+  expect(shared.validateTree(), "valid after concurrent updates");
+  expect(shared.computeRank("p1", r) && r.totalPlayers == 500, "all concurrent players present");
+
+  // many players tied on one score share one score-count node
+  Leaderboard tied;
+  for (int i = 0; i < 300; i++) tied.addOrUpdate("t" + to_string(i), (i % 3) * 100);
+  expect(tied.computeRank("t1", r) && r.rank == 101 && r.sameScoreCount == 100, "tied rank from counts");
+  tied.addOrUpdate("t1", 50);
+  expect(tied.computeRank("t4", r) && r.sameScoreCount == 99, "tie count after update");
+  expect(tied.computeRank("t1", r) && r.rank == 200 && r.sameScoreCount == 1, "moved between ties");
+  expect(tied.validateTree(), "score counts agree with the tree");
+
+  // score ranges: count from the score counts, rows from one descent
+  expect(tied.countInRange(50, 100) == 100 && tied.countInRange(0, 300) == 300, "count in range");
+  expect(tied.countInRange(101, 199) == 0 && tied.countInRange(200, 100) == 0, "empty ranges");
+  vector<Player> inRange = tied.playersInRange(50, 100);
+  expect(inRange.size() == 100 && inRange[0].score == 100 && inRange.back().name == "t1",
+         "players in range, highest first");
+  vector<Player> firstFew = tied.playersInRange(50, 100, 3);
+  expect(firstFew.size() == 3 && firstFew[2].name == inRange[2].name, "range limit");
+  expect(tied.playersInRange(-1000, 1000, 0).empty(), "zero limit");
+
+  // percentiles and histograms from the score counts
+  double pct = 0;
+  expect(tied.percentileOf("t1", pct) && pct > 33.49 && pct < 33.51, "percentile with one player");
+  expect(tied.percentileOf("t0", pct) && pct > 16.66 && pct < 16.67, "percentile counts half the ties");
+  expect(!tied.percentileOf("nobody", pct), "percentile of a missing player");
+  int atPct = -1;
+  expect(tied.scoreAtPercentile(50, atPct) && atPct == 100, "median score");
+  expect(tied.scoreAtPercentile(33.4, atPct) && atPct == 50, "nearest rank");
+  expect(tied.scoreAtPercentile(0, atPct) && atPct == 0, "lowest score");
+  expect(tied.scoreAtPercentile(100, atPct) && atPct == 200, "highest score");
+  expect(!Leaderboard().scoreAtPercentile(50, atPct), "no percentile on an empty board");
+  vector<int> edges = {0, 50, 100, 200, 201};
+  vector<int> hist = tied.histogram(edges);
+  expect(hist.size() == 4 && hist[0] == 100 && hist[1] == 1 && hist[2] == 99 && hist[3] == 100,
+         "histogram buckets");
+
+  // top-K view: the materialized list follows every kind of write
+  LeaderboardOptions topOpts;
+  topOpts.topRows = 10;
+  Leaderboard ranked(topOpts);
+  expect(ranked.topK(10).empty(), "empty board has no top rows");
+  TopKView early;
+  for (int i = 0; i < 4000; i++) {
+    ranked.addOrUpdate("k" + to_string((i * 7) % 300), (i * 37) % 120);
+    if (i == 50) early = ranked.topK(5);
+    if (i % 13 == 0 || i < 40) {
+      TopKView view = ranked.topK(10);
+      vector<Player> want = ranked.playersInRange(-1000000, 1000000, 10);
+      expect(view.size() == want.size(), "top-K size");
+      for (size_t j = 0; j < view.size(); j++) {
+        expect(view[j].name == want[j].name && view[j].score == want[j].score, "top-K rows");
+      }
+    }
+  }
+  expect(early.size() == 5 && early[0].score >= early[4].score, "earlier view unchanged by writes");
+  for (int i = 0; i < 600; i++) {
+    // small batches, most of them below the listed rows
+    vector<pair<string, int> > small;
+    small.push_back(make_pair("k" + to_string((i * 11) % 320), (i * 53) % 130));
+    small.push_back(make_pair("k" + to_string((i * 17) % 320), (i * 29) % 125));
+    ranked.applyBatch(small);
+    TopKView view = ranked.topK(10);
+    vector<Player> want = ranked.playersInRange(-1000000, 1000000, 10);
+    expect(view.size() == want.size(), "top-K size after a small batch");
+    for (size_t j = 0; j < view.size(); j++) {
+      expect(view[j].name == want[j].name && view[j].score == want[j].score, "top-K rows after a small batch");
+    }
+  }
+  ranked.applyBatch(batch);
+  ranked.addOrUpdate("zz", 5000);
+  TopKView afterBatch = ranked.topK(3);
+  expect(afterBatch.size() == 3 && afterBatch[0].name == "zz", "top-K after update");
+  TopKView wide = ranked.topK(50);  // beyond topRows: walked from the tree
+  expect(wide.size() == 50 && wide[2].name == afterBatch[2].name, "top-K beyond the list");
+  int topCount = 0;
+  for (const Player& p : ranked.topK(10)) topCount += p.score >= wide[9].score;
+  expect(topCount == 10, "top-K iteration");
+  expect(tied.topK(3).size() == 3 && tied.topK(3)[0].score == 200, "top-K without the option");
+
+  // checked updates: every write re-checks the nodes it changed
+  LeaderboardOptions checkedOpts;
+  checkedOpts.checkUpdates = true;
+  Leaderboard checked(checkedOpts);
+  for (int i = 0; i < 3000; i++) {
+    checked.addOrUpdate("c" + to_string((i * 13) % 700), (i * 31) % 250);
+    expect(checked.updatesValid(), "incremental check after update");
+  }
+  checked.applyBatch(batch);
+  checked.bulkLoad(vector<Player>(1, Player{"solo", 1}));
+  checked.addOrUpdate("duo", 2);
+  expect(checked.updatesValid() && checked.validateTree(), "checked board stays valid");
+
+  // snapshots: a frozen version is unaffected by later writes
+  LeaderboardOptions sopts;
+  sopts.snapshots = true;
+  Leaderboard snapped(sopts);
+  snapped.addOrUpdate("ann", 30);
+  snapped.addOrUpdate("ben", 20);
+  snapped.addOrUpdate("cat", 10);
+  LeaderboardSnapshot before = snapped.snapshot();
+  snapped.addOrUpdate("cat", 40);
+  snapped.addOrUpdate("dan", 5);
+  expect(before.size() == 3, "snapshot size frozen");
+  vector<Player> frozen = before.rows(0, 10);
+  expect(frozen.size() == 3 && frozen[0].name == "ann" && frozen[2].name == "cat" &&
+         frozen[2].score == 10, "snapshot rows frozen");
+  LeaderboardSnapshot after = snapped.snapshot();
+  expect(after.size() == 4 && after.begin()->data.name == "cat", "new snapshot sees writes");
+  vector<Player> window = snapped.neighborsAround("ann", 1);
+  expect(window.size() == 3 && window[0].name == "cat" && window[2].name == "ben", "neighbors from snapshot");
+  vector<Player> snapRange = snapped.playersInRange(10, 35);
+  expect(snapRange.size() == 2 && snapRange[0].name == "ann" && snapRange[1].name == "ben" &&
+         snapped.countInRange(10, 35) == 2, "range from snapshot");
+  LeaderboardSnapshot copied = lb.snapshot();  // board without snapshots: built on demand
+  expect(copied.size() == lb.snapshot().size() && copied.size() > 0, "snapshot without the option");
+
+  // binary snapshot: save, map, query from the file, then write through it
+  const char* snapPath = "test_rank_snapshot.lbs";
+  expect(tied.saveSnapshot(snapPath), "save snapshot");
+  Leaderboard restored;
+  restored.addOrUpdate("stale", 1);
+  expect(restored.openSnapshot(snapPath, true), "open snapshot");
+  RankInfo want;
+  for (int i = 0; i < 300; i += 7) {
+    string who = "t" + to_string(i);
+    expect(tied.computeRank(who, want) && restored.computeRank(who, r), "mapped player found");
+    expect(r.rank == want.rank && r.score == want.score && r.sameScoreCount == want.sameScoreCount &&
+           r.totalPlayers == want.totalPlayers, "mapped rank matches the saved board");
+  }
+  int mappedScore = 0;
+  expect(!restored.getScore("stale", mappedScore), "open replaces the board");
+  expect(restored.getScore("t1", mappedScore) && mappedScore == 50, "mapped getScore");
+  vector<Player> mappedWindow = restored.neighborsAround("t1", 1);
+  vector<Player> liveWindow = tied.neighborsAround("t1", 1);
+  expect(mappedWindow.size() == 3 && mappedWindow[0].name == liveWindow[0].name &&
+         mappedWindow[2].name == liveWindow[2].name, "mapped neighbors");
+  vector<Player> mappedRange = restored.playersInRange(50, 100, 10);
+  expect(restored.countInRange(50, 100) == 100 && mappedRange.size() == 10 &&
+         mappedRange[0].name == inRange[0].name && mappedRange[9].name == inRange[9].name,
+         "mapped range");
+  expect(restored.validateTree(), "mapped snapshot verifies");
+  expect(restored.topK(2).size() == 2 && restored.topK(2)[1].name == tied.topK(2)[1].name, "mapped top-K");
+  vector<int> mappedHist = restored.histogram(edges);
+  expect(mappedHist == hist && restored.scoreAtPercentile(33.4, atPct) && atPct == 50 &&
+         restored.percentileOf("t1", pct) && pct > 33.49 && pct < 33.51, "mapped percentiles");
+  int lowScore = 0, highScore = 0;
+  expect(restored.scanCountInRange(50, 100) == 100 && restored.scanCountTied(50) == 1 &&
+         restored.scanCountAbove(100) == tied.scanCountAbove(100) && restored.scanMinMax(lowScore, highScore) &&
+         lowScore == 0 && highScore == 200, "mapped scans from the score runs");
+  Leaderboard listed(topOpts);
+  expect(listed.openSnapshot(snapPath) && listed.topK(10).size() == 10 &&
+         listed.topK(10)[9].name == tied.topK(10)[9].name, "top-K list from a mapped file");
+  listed.addOrUpdate("t2", 1000);  // loads the rows, then moves t2 to the top
+  expect(listed.topK(10)[0].name == "t2" && listed.topK(10)[9].name == tied.topK(9)[8].name,
+         "top-K after loading the mapped rows");
+  restored.addOrUpdate("t1", 500);  // first write loads the rows
+  expect(restored.computeRank("t1", r) && r.rank == 1 && r.totalPlayers == 300, "write after open");
+  expect(restored.validateTree(), "valid after loading the snapshot");
+
+  // a damaged file is refused and the board is left as it was
+  FILE* f = fopen(snapPath, "r+b");
+  expect(f != NULL, "reopen snapshot file");
+  fseek(f, 40, SEEK_SET);
+  fputc('x', f);
+  fclose(f);
+  expect(!restored.openSnapshot(snapPath), "corrupt header rejected");
+  expect(restored.computeRank("t1", r) && r.rank == 1, "board unchanged after failed open");
+  expect(!restored.openSnapshot("no_such_snapshot.lbs"), "missing file rejected");
+  remove(snapPath);
+
+  // B-tree score index: the same writes give the same answers as the
+  // red-black board, and its per-update check stays clean
+  LeaderboardOptions btOpts;
+  btOpts.scoreIndex = ScoreIndexKind::BTree;
+  btOpts.checkUpdates = true;
+  btOpts.topRows = 8;
+  Leaderboard bt(btOpts);
+  Leaderboard rb;
+  for (int i = 0; i < 5000; i++) {
+    string who = "b" + to_string((i * 11) % 900);
+    int score = (i * 53) % 400;
+    bt.addOrUpdate(who, score);
+    rb.addOrUpdate(who, score);
+    expect(bt.updatesValid(), "btree board incremental check");
+    if (i % 250 == 249) {
+      RankInfo a;
+      RankInfo b;
+      expect(bt.computeRank(who, a) && rb.computeRank(who, b) && a.rank == b.rank, "btree rank");
+      vector<Player> wa = bt.neighborsAround(who, 3);
+      vector<Player> wb = rb.neighborsAround(who, 3);
+      expect(wa.size() == wb.size() && wa.back().name == wb.back().name, "btree neighbors");
+      vector<Player> ra = bt.playersInRange(100, 200, 40);
+      vector<Player> rr = rb.playersInRange(100, 200, 40);
+      expect(ra.size() == rr.size() && ra.back().name == rr.back().name, "btree range");
+      expect(bt.topK(8)[7].name == rb.topK(8)[7].name, "btree top-K");
+    }
+  }
+  bt.applyBatch(batch);
+  rb.applyBatch(batch);
+  expect(bt.validateTree() && bt.updatesValid(), "btree board valid");
+  LeaderboardSnapshot sa = bt.snapshot();
+  LeaderboardSnapshot sb = rb.snapshot();
+  expect(sa.size() == sb.size() && sa.rows(400, 1)[0].name == sb.rows(400, 1)[0].name, "btree snapshot");
+  const char* btPath = "test_rank_btree.lbs";
+  expect(bt.saveSnapshot(btPath) && rb.openSnapshot(btPath), "btree board saved");
+  RankInfo fromFile;
+  RankInfo fromTree;
+  expect(rb.validateTree() && rb.computeRank("b5", fromFile) && bt.computeRank("b5", fromTree) &&
+         fromFile.rank == fromTree.rank, "btree board written in order");
+  bt.bulkLoad(vector<Player>(1, Player{"solo", 1}));
+  expect(bt.validateTree() && bt.updatesValid() && bt.topK(8).size() == 1, "btree bulk load");
+  remove(btPath);
+
+  // compact score index: same answers as the red-black board, incremental
+  // check included
+  {
+    LeaderboardOptions cpOpts;
+    cpOpts.scoreIndex = ScoreIndexKind::Compact;
+    cpOpts.checkUpdates = true;
+    cpOpts.topRows = 8;
+    Leaderboard cp(cpOpts);
+    Leaderboard plain;
+    for (int i = 0; i < 5000; i++) {
+      string who = "c" + to_string((i * 13) % 700);
+      int score = (i * 47) % 300;
+      cp.addOrUpdate(who, score);
+      plain.addOrUpdate(who, score);
+      expect(cp.updatesValid(), "compact board incremental check");
+      if (i % 250 == 249) {
+        RankInfo a;
+        RankInfo b;
+        expect(cp.computeRank(who, a) && plain.computeRank(who, b) && a.rank == b.rank, "compact rank");
+        vector<Player> wa = cp.neighborsAround(who, 3);
+        vector<Player> wb = plain.neighborsAround(who, 3);
+        expect(wa.size() == wb.size() && wa.back().name == wb.back().name, "compact neighbors");
+        vector<Player> ra = cp.playersInRange(100, 200, 40);
+        vector<Player> rr = plain.playersInRange(100, 200, 40);
+        expect(ra.size() == rr.size() && ra.back().name == rr.back().name, "compact range");
+        expect(cp.topK(8)[7].name == plain.topK(8)[7].name, "compact top-K");
+      }
+    }
+    cp.applyBatch(batch);
+    plain.applyBatch(batch);
+    expect(cp.validateTree() && cp.updatesValid() && cp.topK(20)[19].name == plain.topK(20)[19].name,
+           "compact board after a batch");
+    cp.bulkLoad(vector<Player>(1, Player{"solo", 1}));
+    expect(cp.validateTree() && cp.updatesValid() && cp.topK(8).size() == 1, "compact bulk load");
+  }
+
+  // journal: log updates, replay them into a fresh board, survive a torn
+  // tail, and compact into a checkpoint
+  const char* walPath = "test_rank_journal.wal";
+  const char* ckptPath = "test_rank_checkpoint.lbs";
+  remove(walPath);
+  remove(ckptPath);
+  Leaderboard reference;
+  {
+    JournalOptions jo;
+    jo.commitWindow = chrono::microseconds(200);
+    jo.waitDurable = true;
+    Journal wal(walPath, jo);
+    expect(wal.isOpen(), "journal opens");
+    LeaderboardOptions co;
+    co.concurrent = true;
+    Leaderboard logged(co);
+    logged.attachJournal(&wal);
+    vector<thread> writers;
+    for (int t = 0; t < 4; t++) {
+      writers.push_back(thread([&logged, t]() {
+        for (int i = 0; i < 100; i++) logged.addOrUpdate("w" + to_string(t) + "_" + to_string(i % 25), i + 1);
+      }));
+    }
+    for (size_t i = 0; i < writers.size(); i++) writers[i].join();
+    JournalStats st = wal.stats();
+    expect(st.records == 400, "every change logged");
+    expect(st.frames < st.records, "records share group commits");
+    expect(st.bytes < st.records * 20, "compact records");
+    for (int t = 0; t < 4; t++) {
+      for (int i = 75; i < 100; i++) reference.addOrUpdate("w" + to_string(t) + "_" + to_string(i % 25), i + 1);
+    }
+  }
+  FILE* torn = fopen(walPath, "ab");
+  expect(torn != NULL, "append to journal file");
+  fputs("\x30\x00\x00\x00garbage", torn);  // half a frame, as after a crash
+  fclose(torn);
+  {
+    Journal wal(walPath);
+    Leaderboard recovered;
+    expect(recovered.replayJournal(wal) == 400, "replay skips the torn tail");
+    expect(recovered.computeRank("w2_7", r) && reference.computeRank("w2_7", want) &&
+           r.rank == want.rank && r.score == want.score && r.totalPlayers == 100, "replayed board matches");
+
+    recovered.attachJournal(&wal);
+    expect(recovered.compactJournal(ckptPath), "compact into checkpoint");
+    expect(wal.replay(NULL) == 0, "journal empty after compaction");
+    recovered.addOrUpdate("w0_0", 1000);
+    recovered.addOrUpdate("late", 5);
+    recovered.attachJournal(NULL);
+  }
+  {
+    Leaderboard restarted;
+    Journal wal(walPath);
+    expect(restarted.openSnapshot(ckptPath), "open checkpoint");
+    expect(restarted.replayJournal(wal) == 2, "replay the records after the checkpoint");
+    expect(restarted.computeRank("w0_0", r) && r.rank == 1 && r.totalPlayers == 101, "checkpoint plus journal");
+    expect(restarted.validateTree(), "valid after recovery");
+  }
+  {
+    // replaying into a logged concurrent board: the replayed records are not
+    // logged again, a writer racing the replay is
+    const char* otherPath = "test_rank_journal2.wal";
+    remove(otherPath);
+    Journal wal(walPath);
+    Journal other(otherPath);
+    LeaderboardOptions co;
+    co.concurrent = true;
+    Leaderboard live(co);
+    live.attachJournal(&other);
+    thread racer([&live]() { live.addOrUpdate("racer", 9); });
+    expect(live.replayJournal(wal) == 2, "replay into a logged board");
+    racer.join();
+    expect(other.stats().records == 1 && live.getScore("racer", r.score), "only the racing write logged");
+    // compactions from two threads take turns on the one checkpoint file
+    vector<thread> compactors;
+    bool compacted[2] = {false, false};
+    for (int t = 0; t < 2; t++) {
+      compactors.push_back(thread([&live, &compacted, ckptPath, t]() {
+        bool ok = true;
+        for (int i = 0; i < 20; i++) ok = live.compactJournal(ckptPath) && ok;
+        compacted[t] = ok;
+      }));
+    }
+    for (size_t i = 0; i < compactors.size(); i++) compactors[i].join();
+    Leaderboard fromCheckpoint;
+    expect(compacted[0] && compacted[1] && fromCheckpoint.openSnapshot(ckptPath, true) &&
+           fromCheckpoint.computeRank("racer", r) && r.totalPlayers == 3, "concurrent compactions");
+    live.attachJournal(NULL);
+    remove(otherPath);
+  }
+  remove(walPath);
+  remove(ckptPath);
+
+  // a frame that fails to write (file size limit) is cut off again: later
+  // frames still replay, but nothing counts as durable until a truncate
+  {
+    JournalOptions jo;
+    jo.commitWindow = chrono::microseconds(0);
+    jo.sync = false;
+    // append one record while the file may only grow by a few bytes
+    auto failedAppend = [walPath](Journal& wal) {
+      FILE* f = fopen(walPath, "rb");
+      fseek(f, 0, SEEK_END);
+      long size = ftell(f);
+      fclose(f);
+      signal(SIGXFSZ, SIG_IGN);
+      struct rlimit old;
+      getrlimit(RLIMIT_FSIZE, &old);
+      struct rlimit capped = old;
+      capped.rlim_cur = (rlim_t)size + 12;  // room for part of the frame only
+      setrlimit(RLIMIT_FSIZE, &capped);
+      bool durable = wal.waitDurable(wal.appendUpdate(string(64, 'x'), 2));
+      setrlimit(RLIMIT_FSIZE, &old);
+      signal(SIGXFSZ, SIG_DFL);
+      return !durable && wal.failed();
+    };
+    {
+      Journal wal(walPath, jo);
+      wal.appendUpdate("before", 1);
+      expect(wal.flush() && !wal.failed(), "journal flush");
+      expect(failedAppend(wal), "failed write reported");
+      wal.appendUpdate("after", 3);
+      expect(!wal.flush() && wal.failed(), "failure is sticky");
+    }
+    {
+      Journal wal(walPath, jo);
+      Leaderboard replayed;
+      expect(replayed.replayJournal(wal) == 2, "records after a failed frame replay");
+      int got = 0;
+      expect(replayed.getScore("before", got) && replayed.getScore("after", got) && got == 3 &&
+             !replayed.getScore(string(64, 'x'), got), "failed frame dropped");
+      expect(failedAppend(wal), "failed write reported again");
+      expect(wal.truncate() && !wal.failed(), "truncate clears the failure");
+      wal.appendUpdate("next", 4);
+      expect(wal.flush() && wal.replay(NULL) == 1, "durable again after truncate");
+    }
+    remove(walPath);
+  }
+
+  // windowed boards against one plain board per window, rebuilt on rollover
+  {
+    WindowedLeaderboard win;
+    const LeaderboardWindow ws[] = {LeaderboardWindow::Daily, LeaderboardWindow::Weekly,
+                                    LeaderboardWindow::AllTime};
+    unique_ptr<Leaderboard> plain[3];
+    for (int w = 0; w < 3; w++) plain[w] = make_unique<Leaderboard>();
+    srand(21);
+    for (int i = 0; i < 3000; i++) {
+      string name = "p" + to_string(rand() % 200);
+      int score = rand() % 50;
+      win.addOrUpdate(name, score);
+      for (int w = 0; w < 3; w++) plain[w]->addOrUpdate(name, score);
+      if (i % 300 == 299) {
+        win.rollover(LeaderboardWindow::Daily);
+        plain[0] = make_unique<Leaderboard>();
+        expect(win.size(LeaderboardWindow::Daily) == 0 && win.treeMemory(LeaderboardWindow::Daily).reserved_bytes == 0,
+               "rollover empties the window and frees its index");
+      }
+      if (i % 1000 == 999) {
+        win.rollover(LeaderboardWindow::Weekly);
+        plain[1] = make_unique<Leaderboard>();
+      }
+      if (i % 97 != 0) continue;
+      expect(win.validate(), "windowed boards valid");
+      for (int w = 0; w < 3; w++) {
+        TopKView want = plain[w]->topK(1000);
+        vector<Player> got = win.topK(ws[w], 1000);
+        expect(got.size() == want.size() && (int)got.size() == win.size(ws[w]), "window size");
+        for (size_t k = 0; k < got.size(); k++) {
+          expect(got[k].name == want[k].name && got[k].score == want[k].score, "window rows match");
+        }
+        for (int n = 0; n < 200; n += 13) {
+          string probe = "p" + to_string(n);
+          RankInfo a, b;
+          bool has = plain[w]->computeRank(probe, b);
+          expect(win.computeRank(ws[w], probe, a) == has, "window membership");
+          expect(!has || (a.rank == b.rank && a.score == b.score && a.sameScoreCount == b.sameScoreCount &&
+                          a.totalPlayers == b.totalPlayers), "window rank");
+        }
+      }
+    }
+  }
+
+  // sharded boards: one writer thread per shard, global answers checked
+  // against a single board holding everyone
+  {
+    LeaderboardOptions shardOpts;
+    shardOpts.concurrent = true;
+    shardOpts.topRows = 20;
+    ShardedLeaderboard regions(4, shardOpts);
+    vector<thread> writers;
+    for (int s = 0; s < 4; s++) {
+      writers.push_back(thread([&regions, s]() {
+        for (int i = 0; i < 3000; i++) {
+          regions.addOrUpdate(s, "r" + to_string(s) + "_" + to_string((i * 13) % 600), (i * 31 + s) % 400);
+        }
+      }));
+    }
+    for (size_t i = 0; i < writers.size(); i++) writers[i].join();
+    Leaderboard everyone;
+    for (int s = 0; s < 4; s++) {
+      for (int i = 0; i < 3000; i++) {
+        everyone.addOrUpdate("r" + to_string(s) + "_" + to_string((i * 13) % 600), (i * 31 + s) % 400);
+      }
+    }
+    expect(regions.validateTree() && regions.size() == 2400, "sharded size");
+    expect(regions.shardOf("r2_5") == 2 && regions.shardOf("nobody") == -1, "shard of a name");
+    for (int i = 0; i < 2400; i += 37) {
+      string name = "r" + to_string(i % 4) + "_" + to_string(i / 4);
+      RankInfo a, b;
+      expect(regions.computeGlobalRank(name, a) && everyone.computeRank(name, b), "global rank found");
+      expect(a.rank == b.rank && a.score == b.score && a.sameScoreCount == b.sameScoreCount &&
+             a.totalPlayers == b.totalPlayers, "global rank matches one board");
+    }
+    expect(!regions.computeGlobalRank("nobody", r), "no global rank for a missing name");
+    const int ks[] = {1, 10, 20, 300, 2400, 3000};
+    for (int k : ks) {
+      vector<Player> got = regions.topK(k);
+      vector<Player> want = everyone.rows(0, k);
+      expect(got.size() == want.size(), "global top-K size");
+      for (size_t j = 0; j < got.size(); j++) {
+        expect(got[j].name == want[j].name && got[j].score == want[j].score, "global top-K merge order");
+      }
+    }
+    vector<Player> page = everyone.rows(2390, 20);
+    expect(page.size() == 10 && page[0].name == regions.topK(2391).back().name, "rows clipped at the end");
+  }
+
+  // approximate ranks stay within the error bound through every kind of write
+  {
+    LeaderboardOptions approxOpts;
+    approxOpts.approxRankError = 0.01;
+    Leaderboard est(approxOpts);
+    Leaderboard exact;
+    srand(33);
+    for (int i = 0; i < 20000; i++) {
+      string name = "a" + to_string(rand() % 8000);
+      int score = (i % 5 == 0) ? 777 : rand() % 100000;   // plus one heavily tied score
+      est.addOrUpdate(name, score);
+      exact.addOrUpdate(name, score);
+      if (i == 12000) {
+        vector<pair<string, int> > burst;
+        for (int j = 0; j < 500; j++) burst.push_back(make_pair("a" + to_string(j), j * 3));
+        est.applyBatch(burst);
+        exact.applyBatch(burst);
+      }
+      if (i % 100 == 50) {
+        // small batches keep the histogram in step without a rebuild
+        vector<pair<string, int> > few;
+        for (int j = 0; j < 3; j++) few.push_back(make_pair("a" + to_string(rand() % 8000), rand() % 100000));
+        est.applyBatch(few);
+        exact.applyBatch(few);
+      }
+      if (i % 2000 != 1999) continue;
+      for (int n = 0; n < 8000; n += 61) {
+        string probe = "a" + to_string(n);
+        RankInfo want;
+        int got = 0;
+        double pctGot = 0;
+        double pctWant = 0;
+        if (!exact.computeRank(probe, want)) {
+          expect(!est.approxRankOf(probe, got), "approximate rank of a missing player");
+          continue;
+        }
+        int bound = max(1, (int)(0.01 * want.totalPlayers));
+        expect(est.approxRankOf(probe, got) && abs(got - want.rank) <= bound, "approximate rank within bound");
+        expect(est.approxPercentileOf(probe, pctGot) && exact.percentileOf(probe, pctWant) &&
+               fabs(pctGot - pctWant) <= 1.0 + 1e-9, "approximate percentile within bound");
+        if (want.score == 777) expect(got == want.rank, "a tied score is its own exact bucket");
+      }
+    }
+    int fallback = 0;
+    RankInfo exactRank;
+    expect(exact.approxRankOf("a5", fallback) && exact.computeRank("a5", exactRank) && fallback == exactRank.rank,
+           "without the option the rank is exact");
+
+    ApproxRank small(0.01);
+    for (int i = 0; i < 100000; i++) small.add(i);
+    expect(small.memoryBytes() < 8 * 1024 && small.size() == 100000, "histogram stays a few KB");
+  }
+
+  // season merge and score tiers: the boards end up as if built from the
+  // same rows, on every index kind and with every kept structure
+  {
+    srand(45);
+    const ScoreIndexKind kinds[] = {ScoreIndexKind::RedBlack, ScoreIndexKind::BTree, ScoreIndexKind::Compact};
+    auto same_rows = [](const Leaderboard& a, const vector<Player>& want) {
+      vector<Player> got = a.rows(0, a.size());
+      if (got.size() != want.size()) return false;
+      for (size_t i = 0; i < got.size(); i++) {
+        if (got[i].name != want[i].name || got[i].score != want[i].score) return false;
+      }
+      return true;
+    };
+    for (ScoreIndexKind kind : kinds) {
+      LeaderboardOptions o;
+      o.scoreIndex = kind;
+      o.snapshots = true;
+      o.checkUpdates = true;
+      o.topRows = 10;
+      o.approxRankError = 0.01;
+      Leaderboard season1(o);
+      Leaderboard season2(o);
+      Leaderboard expected;
+      for (int i = 0; i < 2000; i++) season1.addOrUpdate("m" + to_string(rand() % 1500), rand() % 400);
+      for (int i = 0; i < 800; i++) season2.addOrUpdate("m" + to_string(1000 + rand() % 1500), rand() % 600);
+      vector<Player> all = season1.rows(0, season1.size());
+      vector<Player> more = season2.rows(0, season2.size());
+      for (const Player& p : all) expected.addOrUpdate(p.name, p.score);
+      int raised = 0;
+      for (const Player& p : more) {
+        int had = 0;
+        if (!expected.getScore(p.name, had) || p.score > had) {
+          expected.addOrUpdate(p.name, p.score);
+          raised++;
+        }
+      }
+      vector<Player> want = expected.rows(0, expected.size());
+
+      expect(season1.mergeFrom(season2) == raised, "merge counts the players added or raised");
+      expect(same_rows(season1, want) && season2.size() == 0, "merge keeps each player's best score");
+      expect(season1.validateTree() && season1.updatesValid() && season2.validateTree(), "merged boards valid");
+      RankInfo info;
+      expect(season1.computeRank(want[want.size() / 2].name, info) && info.rank <= (int)want.size() / 2 + 1 &&
+             info.totalPlayers == (int)want.size(), "merged board ranks");
+      expect(season1.snapshot().size() == (int)want.size() && season1.topK(10)[0].name == want[0].name,
+             "merge keeps the snapshot version and top list");
+      expect(season1.countInRange(0, 1000) == (int)want.size(), "merge adds up the score counts");
+      season2.addOrUpdate("late", 5);
+      expect(season2.size() == 1 && season2.validateTree(), "emptied board stays usable");
+
+      // tiers: 300 and up move, ties on 300 included, into a board with
+      // other settings that held players before
+      LeaderboardOptions t;
+      t.scoreIndex = (kind == ScoreIndexKind::BTree) ? ScoreIndexKind::RedBlack : ScoreIndexKind::BTree;
+      t.topRows = 5;
+      Leaderboard tier(t);
+      tier.addOrUpdate("stale", 999);
+      vector<Player> upper, lower;
+      for (const Player& p : want) (p.score >= 300 ? upper : lower).push_back(p);
+      expect(season1.splitTier(300, tier) == (int)upper.size(), "split counts the players moved");
+      expect(same_rows(tier, upper) && same_rows(season1, lower), "split at a score, ties on the tier side");
+      expect(tier.validateTree() && season1.validateTree() && season1.updatesValid(), "split boards valid");
+      int score = 0;
+      expect(!tier.getScore("stale", score) && tier.getScore(upper.back().name, score) && score == upper.back().score &&
+             !season1.getScore(upper.back().name, score), "names follow their players");
+      expect(season1.snapshot().size() == (int)lower.size() && tier.topK(5)[0].name == upper[0].name,
+             "split rebuilds the snapshot version and top lists");
+      season1.addOrUpdate(lower[0].name, 1000);
+      tier.addOrUpdate(upper[0].name, -1);
+      expect(season1.validateTree() && tier.validateTree() && season1.topK(1)[0].name == lower[0].name,
+             "split boards stay usable");
+
+      // and back: the tier merges into what is left
+      season1.mergeFrom(tier);
+      expect(season1.size() == (int)want.size() && season1.validateTree() && season1.updatesValid(), "merge back");
+      Leaderboard none;
+      expect(season1.splitTier(INT_MIN, none) == (int)want.size() && season1.size() == 0, "split at INT_MIN moves all");
+    }
+
+    // journals: each board logs what it became
+    const string j1 = "/tmp/test_rank_merge1.journal";
+    const string j2 = "/tmp/test_rank_merge2.journal";
+    remove(j1.c_str());
+    remove(j2.c_str());
+    {
+      JournalOptions jo;
+      jo.sync = false;
+      Journal a(j1, jo);
+      Journal b(j2, jo);
+      Leaderboard one;
+      Leaderboard two;
+      one.attachJournal(&a);
+      two.attachJournal(&b);
+      for (int i = 0; i < 50; i++) one.addOrUpdate("j" + to_string(i), i);
+      for (int i = 25; i < 75; i++) two.addOrUpdate("j" + to_string(i), 100 - i);
+      one.mergeFrom(two);
+      Leaderboard high;
+      one.splitTier(40, high);
+      two.mergeFrom(high);
+      expect(a.flush() && b.flush(), "merge and split journals written");
+      Leaderboard again1;
+      Leaderboard again2;
+      again1.replayJournal(a);
+      again2.replayJournal(b);
+      expect(same_rows(again1, one.rows(0, one.size())) && same_rows(again2, two.rows(0, two.size())),
+             "journals replay to the merged and split boards");
+    }
+    remove(j1.c_str());
+    remove(j2.c_str());
+  }
+
+  // every scan kernel the CPU has agrees with the scalar one, tails and extremes included
+  {
+    srand(44);
+    const ScanKernel kernels[] = {ScanKernel::SSE4, ScanKernel::AVX2};
+    for (size_t n = 0; n < 300; n += (n < 40 ? 1 : 37)) {
+      vector<int32_t> v(n);
+      for (size_t i = 0; i < n; i++) {
+        int r = rand() % 10;
+        v[i] = (r == 0) ? INT_MIN : (r == 1) ? INT_MAX : rand() % 21 - 10;
+      }
+      const int32_t probes[][2] = {{-3, 4}, {INT_MIN, 0}, {0, INT_MAX}, {INT_MIN, INT_MAX}, {5, -5}, {7, 7}};
+      for (ScanKernel k : kernels) {
+        if (!scan_kernel_supported(k)) continue;
+        for (const int32_t* p : probes) {
+          expect(scan_count_greater(v.data(), n, p[0], k) == scan_count_greater(v.data(), n, p[0], ScanKernel::Scalar),
+                 "scan kernel: count greater");
+          expect(scan_count_equal(v.data(), n, p[1], k) == scan_count_equal(v.data(), n, p[1], ScanKernel::Scalar),
+                 "scan kernel: count equal");
+          expect(scan_count_in_range(v.data(), n, p[0], p[1], k) ==
+                 scan_count_in_range(v.data(), n, p[0], p[1], ScanKernel::Scalar), "scan kernel: count in range");
+        }
+        int32_t mn = 1, mx = 2, wantMin = 3, wantMax = 4;
+        bool any = scan_min_max(v.data(), n, mn, mx, k);
+        expect(any == scan_min_max(v.data(), n, wantMin, wantMax, ScanKernel::Scalar) && any == (n > 0),
+               "scan kernel: min/max on empty input");
+        if (any) expect(mn == wantMin && mx == wantMax, "scan kernel: min/max");
+      }
+    }
+
+    // the board's scans match its tree answers through updates, batches and loads
+    Leaderboard col;
+    int lowest = 0, highest = 0;
+    expect(!col.scanMinMax(lowest, highest), "no min/max on an empty board");
+    for (int i = 0; i < 3000; i++) col.addOrUpdate("s" + to_string(rand() % 1000), rand() % 500);
+    vector<pair<string, int> > burst;
+    for (int j = 0; j < 300; j++) burst.push_back(make_pair("s" + to_string(j * 7), 1000 + j));
+    col.applyBatch(burst);
+    for (int round = 0; round < 2; round++) {
+      for (int s = -10; s < 1400; s += 13) {
+        int above = 0, tied = 0;
+        col.countAround(s, above, tied);
+        expect(col.scanCountAbove(s) == above && col.scanCountTied(s) == tied, "scan counts match the trees");
+        expect(col.scanCountInRange(s, s + 90) == col.countInRange(s, s + 90), "scan range matches countInRange");
+      }
+      TopKView first = col.topK(1);
+      vector<Player> last = col.rows(col.size() - 1, 1);
+      expect(col.scanMinMax(lowest, highest) && highest == first[0].score && lowest == last[0].score,
+             "scan min/max match the ends of the ranking");
+      col.bulkLoad(col.rows(0, col.size()));
+    }
+  }
+
   cout << "[PASS] rank tests\n";
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,554 @@
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <algorithm>
+#include <string>
+#include <memory>
+#include <ranges>
+#include "RBT.h"
+#include "PRBT.h"
+#include "BTree.h"
+#include "CompactRBT.h"
+using namespace std;
+
+// if cond is false, print "[FAIL] <msg>" and exit with code 1 so CTest marks
+// the test as failed.
+static void expect(bool cond, const char* msg) {
+  if (!cond) {
+    cout << "[FAIL] " << msg << "\n";
+    exit(1);
+  }
+}
+
+// check rank/select of the tree against a sorted copy of the same keys
+typedef RBT<int> IntTree;
+
+static void expect_order_stats(const IntTree& t, vector<int> keys) {
+  sort(keys.begin(), keys.end());
+  for (int k = 0; k < (int)keys.size(); k++) {
+    IntTree::node_type* n = t.select(k);
+    expect(n != NULL && n->data == keys[(size_t)k], "select matches sorted order");
+  }
+  expect(t.select((int)keys.size()) == NULL, "select past the end is NULL");
+  for (int probe = -1; probe <= 60; probe++) {
+    int less = (int)(lower_bound(keys.begin(), keys.end(), probe) - keys.begin());
+    int le = (int)(upper_bound(keys.begin(), keys.end(), probe) - keys.begin());
+    rb_rank r = t.rank(probe);
+    expect(r.less == less, "rank.less");
+    expect(r.equal == le - less, "rank.equal");
+    expect(r.greater == (int)keys.size() - le, "rank.greater");
+  }
+}
+
+int main() {
+  IntTree t;
+  vector<int> keys;
+
+  // random inserts with plenty of duplicates
+  srand(7);
+  for (int i = 0; i < 400; i++) {
+    int v = rand() % 50;
+    t.insert_data(v);
+    keys.push_back(v);
+  }
+  expect(t.validate(), "valid after inserts");
+  expect(t.size(t.get_root()) == 400, "size after inserts");
+  expect_order_stats(t, keys);
+
+  // random removes (including keys that are not present)
+  for (int i = 0; i < 300; i++) {
+    int v = rand() % 55;
+    t.remove(v);
+    vector<int>::iterator it = find(keys.begin(), keys.end(), v);
+    if (it != keys.end()) keys.erase(it);
+    expect(t.validate(), "valid after remove");
+  }
+  expect(t.size(t.get_root()) == (int)keys.size(), "size after removes");
+  expect_order_stats(t, keys);
+
+  // iterators: forward, backward and bounds agree with the sorted keys
+  static_assert(std::ranges::bidirectional_range<const IntTree>, "RBT is a bidirectional range");
+  vector<int> sorted = keys;
+  sort(sorted.begin(), sorted.end());
+  vector<int> walked;
+  for (const IntTree::node_type& n : t) walked.push_back(n.data);
+  expect(walked == sorted, "range-for visits keys in order");
+  vector<int> back;
+  for (IntTree::const_reverse_iterator it = t.rbegin(); it != t.rend(); ++it) back.push_back(it->data);
+  reverse(back.begin(), back.end());
+  expect(back == sorted, "reverse iteration");
+  IntTree::const_iterator last = t.end();
+  --last;
+  expect(last->data == sorted.back(), "--end() is the last key");
+  for (int v = -1; v <= 56; v++) {
+    IntTree::const_iterator lo = t.lower_bound(v);
+    IntTree::const_iterator hi = t.upper_bound(v);
+    long want_lo = lower_bound(sorted.begin(), sorted.end(), v) - sorted.begin();
+    long want_hi = upper_bound(sorted.begin(), sorted.end(), v) - sorted.begin();
+    expect(std::ranges::distance(t.begin(), lo) == want_lo, "lower_bound position");
+    expect(std::ranges::distance(lo, hi) == want_hi - want_lo, "upper_bound - lower_bound = copies");
+  }
+  IntTree::const_iterator found = std::ranges::find_if(t, [](const IntTree::node_type& n) { return n.data > 20; });
+  expect(found == t.upper_bound(20), "ranges::find_if stops at the first match");
+  vector<int> sub;
+  t.to_vector(t.get_root()->left, sub);
+  expect(sub.size() == (size_t)t.size(t.get_root()->left) && is_sorted(sub.begin(), sub.end()) &&
+         (sub.empty() || sub.back() <= t.get_root()->data), "to_vector of a subtree stays inside it");
+
+  // removed nodes go back to the pool and are reused, so churn at a fixed
+  // size does not grow the slabs
+  rb_mem_stats before = t.mem_stats();
+  expect(before.live_nodes == keys.size(), "live nodes match tree size");
+  expect(before.peak_nodes == 400, "peak nodes");
+  for (int i = 0; i < 1000; i++) {
+    int v = keys[(size_t)(i % keys.size())];
+    t.remove(v);
+    t.insert_data(v + 1);
+    keys[(size_t)(i % keys.size())] = v + 1;
+  }
+  rb_mem_stats after = t.mem_stats();
+  expect(after.live_nodes == keys.size(), "live nodes after churn");
+  expect(after.reserved_bytes == before.reserved_bytes, "churn reuses freed nodes");
+  expect(t.validate(), "valid after churn");
+
+  t.clear();
+  expect(t.get_root() == NULL && t.mem_stats().reserved_bytes == 0, "clear releases slabs");
+
+  // bulk build from sorted keys: every size must come out as a valid tree
+  for (int n = 0; n <= 130; n++) {
+    vector<int> sorted;
+    for (int i = 0; i < n; i++) sorted.push_back(i / 3);  // with duplicates
+    IntTree b;
+    b.build_from_sorted(sorted);
+    expect(b.validate(), "build_from_sorted is a valid red-black tree");
+    expect(b.size(b.get_root()) == n, "build_from_sorted size");
+    expect_order_stats(b, sorted);
+    b.insert_data(n);  // and stays usable for normal updates
+    b.remove(0);
+    expect(b.validate(), "valid after updates on a built tree");
+  }
+
+  // keys that own memory, a payload and a custom order (descending)
+  RBT<string, int, greater<string> > words;
+  const char* w[] = {"pear", "apple", "fig", "kiwi", "apple", "plum", "date"};
+  for (int i = 0; i < 7; i++) words.insert_data(w[i], i);
+  expect(words.validate(), "string tree valid");
+  expect(words.first()->data == "plum" && words.last()->data == "apple", "descending order");
+  expect(words.get_node(words.get_root(), "fig")->value == 2, "payload kept with key");
+  expect(words.rank(string("apple")).equal == 2, "duplicate string keys");
+  words.remove("kiwi");
+  vector<string> order;
+  words.to_vector(words.get_root(), order);
+  expect(order.size() == 6 && order[1] == "pear" && order[2] == "fig", "inorder after remove");
+
+  // counted duplicates: one node per distinct key, same answers as a multiset
+  IntTree counted(less<int>(), RBDuplicates::Counted);
+  keys.clear();
+  for (int i = 0; i < 2000; i++) {
+    int v = rand() % 40;
+    if (rand() % 3 == 0) {
+      counted.remove(v);
+      vector<int>::iterator it = find(keys.begin(), keys.end(), v);
+      if (it != keys.end()) keys.erase(it);
+    } else {
+      counted.insert_data(v);
+      keys.push_back(v);
+    }
+    expect(counted.validate(), "counted tree valid");
+  }
+  expect(counted.size(counted.get_root()) == (int)keys.size(), "counted size is number of keys");
+  expect(counted.mem_stats().live_nodes <= 40, "one node per distinct key");
+  expect_order_stats(counted, keys);
+  vector<int> copies;
+  counted.to_vector(counted.get_root(), copies);
+  sort(keys.begin(), keys.end());
+  expect(copies == keys, "to_vector repeats counted keys");
+  IntTree runs(less<int>(), RBDuplicates::Counted);
+  runs.build_from_sorted(keys);
+  expect(runs.validate() && runs.size(runs.get_root()) == (int)keys.size(), "counted bulk build");
+  expect_order_stats(runs, keys);
+
+  // incremental checks: after every update validate_changes agrees with the
+  // full validate, and a broken color next to the last change is caught
+  for (int mode = 0; mode < 2; mode++) {
+    IntTree inc(less<int>(), mode == 0 ? RBDuplicates::Nodes : RBDuplicates::Counted);
+    inc.track_changes(true);
+    for (int i = 0; i < 3000; i++) {
+      int v = rand() % 300;
+      if (rand() % 3 == 0) inc.remove(v);
+      else inc.insert_data(v);
+      if (i % 7 == 0) inc.insert_data(v + 1);  // sometimes two updates per check
+      expect(inc.validate_changes(), "incremental check after update");
+    }
+    expect(inc.validate(), "full check agrees");
+    for (int i = 0; i < 50; i++) {
+      int v = 1000 + i;
+      inc.insert_data(v);
+      IntTree::node_type* n = inc.get_node(inc.get_root(), v);
+      n->color = (n->color == RBColor::Red) ? RBColor::Black : RBColor::Red;
+      expect(!inc.validate_changes(), "incremental check catches a flipped color");
+      n->color = (n->color == RBColor::Red) ? RBColor::Black : RBColor::Red;
+    }
+    expect(inc.validate(), "valid once the colors are restored");
+  }
+  IntTree rebuilt;
+  rebuilt.track_changes(true);
+  rebuilt.build_from_sorted(vector<int>(100, 7));
+  rebuilt.get_root()->color = RBColor::Red;
+  expect(!rebuilt.validate_changes(), "a rebuilt tree gets a full check");
+
+  // persistent tree: every older version keeps its keys while newer
+  // versions change, and every version is a valid red-black tree
+  typedef PRBT<int, int> IntVersion;
+  IntVersion pv;
+  vector<IntVersion> versions;
+  vector<vector<int> > expected;   // sorted keys of versions[i]
+  vector<int> live;
+  for (int i = 0; i < 600; i++) {
+    int v = rand() % 120;
+    if (rand() % 3 == 0) {
+      bool had = find(live.begin(), live.end(), v) != live.end();
+      expect(pv.remove(v) == had, "persistent remove reports presence");
+      if (had) live.erase(find(live.begin(), live.end(), v));
+    } else {
+      pv.insert(v, i);
+      if (find(live.begin(), live.end(), v) == live.end()) live.push_back(v);
+    }
+    expect(pv.validate(), "persistent tree valid after update");
+    if (i % 50 == 0) {
+      versions.push_back(pv);   // O(1) snapshot
+      expected.push_back(live);
+      sort(expected.back().begin(), expected.back().end());
+    }
+  }
+  for (size_t k = 0; k < versions.size(); k++) {
+    vector<int> got;
+    for (IntVersion::const_iterator it = versions[k].begin(); it != versions[k].end(); ++it) {
+      got.push_back(it->data);
+    }
+    expect(got == expected[k], "old version unchanged by later updates");
+    expect(versions[k].validate(), "old version still valid");
+    for (int j = 0; j < (int)got.size(); j++) {
+      expect(versions[k].select(j)->data == got[(size_t)j], "persistent select");
+      expect(versions[k].iterator_at(j)->data == got[(size_t)j], "iterator_at position");
+      expect(versions[k].rank(got[(size_t)j]).less == j, "persistent rank");
+    }
+  }
+  IntVersion pb;
+  for (int n = 0; n <= 70; n++) {
+    pb.build_from_sorted(n, [](int i) { return i * 2; }, [](int i) { return i; });
+    expect(pb.validate() && pb.size() == n, "persistent build_from_sorted");
+    pb.insert(-1, 0);
+    expect(pb.validate() && pb.begin()->data == -1, "built version stays usable");
+  }
+
+  // B+ tree: narrow nodes so splits, borrows and merges happen constantly;
+  // after every update it must hold the same multiset as a sorted vector
+  typedef BTree<int, int, std::less<int>, 4> SmallBTree;
+  SmallBTree bt;
+  bt.track_changes(true);
+  vector<int> bkeys;
+  for (int i = 0; i < 4000; i++) {
+    int v = rand() % 300;
+    if (i < 1500 || rand() % 2 == 0) {
+      bt.insert_data(v, i);
+      bkeys.insert(upper_bound(bkeys.begin(), bkeys.end(), v), v);
+    } else {
+      vector<int>::iterator at = lower_bound(bkeys.begin(), bkeys.end(), v);
+      bool had = at != bkeys.end() && *at == v;
+      expect(bt.remove(v) == had, "btree remove reports presence");
+      if (had) bkeys.erase(at);
+    }
+    expect(bt.validate_changes(), "btree incremental check after update");
+    if (i % 97 == 0) {
+      expect(bt.validate() && bt.size() == (int)bkeys.size(), "btree valid");
+      vector<int> got;
+      for (SmallBTree::const_iterator it = bt.begin(); it != bt.end(); ++it) got.push_back(it.key());
+      expect(got == bkeys, "btree walk is sorted");
+      for (int k = 0; k < (int)bkeys.size(); k += 7) {
+        expect(bt.select(k).key() == bkeys[(size_t)k], "btree select");
+      }
+      for (int probe = -1; probe <= 301; probe += 5) {
+        int less = (int)(lower_bound(bkeys.begin(), bkeys.end(), probe) - bkeys.begin());
+        int le = (int)(upper_bound(bkeys.begin(), bkeys.end(), probe) - bkeys.begin());
+        rb_rank r = bt.rank(probe);
+        expect(r.less == less && r.equal == le - less && r.greater == (int)bkeys.size() - le,
+               "btree rank");
+        SmallBTree::const_iterator lb = bt.lower_bound(probe);
+        SmallBTree::const_iterator ub = bt.upper_bound(probe);
+        expect(less == (int)bkeys.size() ? lb == bt.end() : lb.key() == bkeys[(size_t)less],
+               "btree lower_bound");
+        expect(le == (int)bkeys.size() ? ub == bt.end() : ub.key() == bkeys[(size_t)le],
+               "btree upper_bound");
+      }
+    }
+  }
+  while (!bkeys.empty()) {
+    expect(bt.remove(bkeys.back()), "btree drain");
+    bkeys.pop_back();
+  }
+  expect(bt.validate() && bt.size() == 0 && bt.begin() == bt.end() && bt.mem_stats().live_nodes == 0,
+         "drained btree frees its nodes");
+  BTree<int> wide;
+  for (int n = 0; n <= 200; n += 7) {
+    wide.build_from_sorted(n, [](int i) { return i * 2; }, [](int) { return rb_no_value(); });
+    expect(wide.validate() && wide.size() == n, "btree build_from_sorted");
+    wide.insert_data(-1);
+    expect(wide.validate() && wide.begin().key() == -1 && wide.remove(-1), "built btree stays usable");
+  }
+
+  // compact layout: same multiset checks, after every update
+  static_assert(sizeof(CompactRBT<int>::node_type) * 2 < sizeof(IntTree::node_type),
+                "compact int nodes are under half an rb_node");
+  static_assert(std::ranges::forward_range<const CompactRBT<int, int> >, "CompactRBT is a forward range");
+  CompactRBT<int, int> ct;
+  ct.track_changes(true);
+  vector<int> ckeys;
+  for (int i = 0; i < 4000; i++) {
+    int v = rand() % 300;
+    if (i < 1500 || rand() % 2 == 0) {
+      ct.insert_data(v, i);
+      ckeys.insert(upper_bound(ckeys.begin(), ckeys.end(), v), v);
+    } else {
+      vector<int>::iterator at = lower_bound(ckeys.begin(), ckeys.end(), v);
+      bool had = at != ckeys.end() && *at == v;
+      expect(ct.remove(v) == had, "compact remove reports presence");
+      if (had) ckeys.erase(at);
+    }
+    expect(ct.validate() && ct.validate_changes() && ct.size() == (int)ckeys.size(), "compact tree valid after update");
+    if (i % 97 == 0) {
+      vector<int> got;
+      for (CompactRBT<int, int>::const_iterator it = ct.begin(); it != ct.end(); ++it) got.push_back(it.key());
+      expect(got == ckeys, "compact walk is sorted");
+      got.clear();
+      for (const auto& n : ct) got.push_back(n.data);
+      expect(got == ckeys && std::ranges::is_sorted(ct, {}, [](const auto& n) { return n.data; }),
+             "compact range-for and ranges");
+      for (int k = 0; k < (int)ckeys.size(); k += 7) {
+        expect(ct.select(k).key() == ckeys[(size_t)k], "compact select");
+      }
+      for (int probe = -1; probe <= 301; probe += 5) {
+        int less = (int)(lower_bound(ckeys.begin(), ckeys.end(), probe) - ckeys.begin());
+        int le = (int)(upper_bound(ckeys.begin(), ckeys.end(), probe) - ckeys.begin());
+        rb_rank r = ct.rank(probe);
+        expect(r.less == less && r.equal == le - less && r.greater == (int)ckeys.size() - le,
+               "compact rank");
+        CompactRBT<int, int>::const_iterator lb = ct.lower_bound(probe);
+        CompactRBT<int, int>::const_iterator ub = ct.upper_bound(probe);
+        expect(less == (int)ckeys.size() ? lb == ct.end() : lb.key() == ckeys[(size_t)less],
+               "compact lower_bound");
+        expect(le == (int)ckeys.size() ? ub == ct.end() : ub.key() == ckeys[(size_t)le],
+               "compact upper_bound");
+      }
+    }
+  }
+  size_t slots = ct.mem_stats().peak_nodes;
+  while (!ckeys.empty()) {
+    expect(ct.remove(ckeys[ckeys.size() / 2]), "compact drain");
+    ckeys.erase(ckeys.begin() + (ptrdiff_t)(ckeys.size() / 2));
+    expect(ct.validate(), "compact tree valid while draining");
+  }
+  for (int i = 0; i < (int)slots; i++) ct.insert_data(i, i);
+  expect(ct.validate() && ct.mem_stats().reserved_bytes < (slots + 1) * 2 * CompactRBT<int, int>::node_bytes(),
+         "freed compact slots are reused");
+  CompactRBT<int> cbuilt;
+  for (int n = 0; n <= 200; n += 7) {
+    cbuilt.build_from_sorted(n, [](int i) { return i * 2; }, [](int) { return rb_no_value(); });
+    expect(cbuilt.validate() && cbuilt.size() == n, "compact build_from_sorted");
+    int steps = 0;
+    for (const CompactRBT<int>::node_type* c = n ? &*cbuilt.begin() : NULL; c != NULL; c = cbuilt.successor(c)) {
+      expect(c->data == steps++ * 2, "compact successor");
+    }
+    expect(steps == n, "compact successor reaches every key");
+    cbuilt.insert_data(-1);
+    expect(cbuilt.validate() && cbuilt.begin().key() == -1 && cbuilt.remove(-1), "built compact tree stays usable");
+  }
+
+  // join / split / unite / difference: same keys as a sorted vector, every
+  // result a valid tree, and nodes handed over stay usable after the giver dies
+  auto keys_of = [](const IntTree& tr) {
+    vector<int> v;
+    tr.to_vector(tr.get_root(), v);
+    return v;
+  };
+  for (int n = 0; n <= 260; n += 13) {
+    for (int m = 0; m <= n; m += (m < 4 ? 1 : 29)) {
+      vector<int> big;
+      vector<int> small;
+      IntTree a;
+      {
+        IntTree b;
+        for (int i = 0; i < n; i++) {
+          big.push_back(rand() % 300);
+          a.insert_data(big.back());
+        }
+        for (int i = 0; i < m; i++) {
+          small.push_back(rand() % 300);
+          b.insert_data(small.back());
+        }
+        vector<int> both = big;
+        both.insert(both.end(), small.begin(), small.end());
+        sort(both.begin(), both.end());
+        if (m % 2 == 0) a.unite(b);
+        else {
+          b.unite(a);   // the other way round, then everything back
+          a.unite(b);
+        }
+        expect(a.validate() && b.validate() && b.get_root() == NULL, "unite valid, other emptied");
+        expect(keys_of(a) == both, "unite keeps every copy");
+        expect((int)a.mem_stats().live_nodes == n + m, "every node lives in one tree");
+      }
+      a.insert_data(150);   // the adopted slabs outlive the tree they came from
+      a.remove(150);
+      expect(a.validate(), "united tree stays usable");
+
+      IntTree cut;
+      for (int i = 0; i < m; i++) cut.insert_data(small[(size_t)i] + 1);
+      vector<int> left;
+      for (int v : keys_of(a)) {
+        if (find(small.begin(), small.end(), v - 1) == small.end()) left.push_back(v);
+      }
+      a.difference(cut);
+      expect(a.validate() && keys_of(a) == left, "difference removes every copy of other's keys");
+
+      int at = rand() % 320 - 10;
+      IntTree high;
+      high.insert_data(-5);   // emptied first
+      a.split_at(at, high);
+      vector<int> lo;
+      vector<int> hi;
+      for (int v : left) (v < at ? lo : hi).push_back(v);
+      expect(a.validate() && high.validate() && keys_of(a) == lo && keys_of(high) == hi, "split_at");
+      expect(high.rank(at - 1).less == 0 && a.rank(at).greater + a.rank(at).equal == 0, "split_at sides");
+
+      if (!lo.empty() && !hi.empty()) {
+        int mid = lo.back();
+        a.join(mid, high);
+        lo.push_back(mid);
+        lo.insert(lo.end(), hi.begin(), hi.end());
+        expect(a.validate() && high.validate() && keys_of(a) == lo && high.get_root() == NULL, "join");
+        expect_order_stats(a, lo);
+      }
+    }
+  }
+
+  // joins between trees of very different heights, on both sides
+  for (int n = 0; n <= 500; n += 50) {
+    IntTree lower;
+    IntTree upper;
+    vector<int> all;
+    for (int i = 0; i < n; i++) lower.insert_data(i);
+    for (int i = 0; i < 500 - n; i++) upper.insert_data(1000 + i);
+    for (int i = 0; i < n; i++) all.push_back(i);
+    all.push_back(777);
+    for (int i = 0; i < 500 - n; i++) all.push_back(1000 + i);
+    lower.join(777, upper);
+    expect(lower.validate() && keys_of(lower) == all, "join of uneven trees");
+    IntTree below;
+    for (int i = 0; i < n / 3; i++) below.insert_data(-1 - i);
+    lower.unite(below);   // ranges do not overlap: one join
+    all.insert(all.begin(), (size_t)(n / 3), 0);
+    for (int i = 0; i < n / 3; i++) all[(size_t)i] = i - n / 3;
+    expect(lower.validate() && keys_of(lower) == all, "unite of disjoint ranges");
+  }
+
+  // counted trees: equal keys add up their counts across unite and join
+  IntTree ca(less<int>(), RBDuplicates::Counted);
+  IntTree cb(less<int>(), RBDuplicates::Counted);
+  vector<int> tally;
+  for (int i = 0; i < 500; i++) {
+    int v = rand() % 60;
+    (i % 3 == 0 ? cb : ca).insert_data(v);
+    tally.push_back(v);
+  }
+  ca.unite(cb);
+  sort(tally.begin(), tally.end());
+  expect(ca.validate() && keys_of(ca) == tally && ca.mem_stats().live_nodes <= 60, "counted unite merges counts");
+  ca.split_at(30, cb);
+  cb.insert_data(29);
+  ca.join(29, cb);    // 29 is already ca's last key: its copies add up
+  tally.insert(upper_bound(tally.begin(), tally.end(), 29), 2, 29);
+  expect(ca.validate() && keys_of(ca) == tally && ca.rank(29).equal == (int)count(tally.begin(), tally.end(), 29),
+         "counted join at an equal key");
+  IntTree gone(less<int>(), RBDuplicates::Counted);
+  gone.insert_data(29);
+  gone.insert_data(5);
+  ca.difference(gone);
+  tally.erase(remove_if(tally.begin(), tally.end(), [](int v) { return v == 29 || v == 5; }), tally.end());
+  expect(ca.validate() && keys_of(ca) == tally, "counted difference drops every copy");
+
+  // trees on one pool: split_at and join relink the nodes in place, so the
+  // node holding a key is the same one before and after the handover
+  {
+    shared_ptr<IntTree::pool_type> pool = make_shared<IntTree::pool_type>();
+    IntTree whole(pool);
+    vector<int> all;
+    for (int i = 0; i < 3000; i++) {
+      whole.insert_data(i * 2);
+      all.push_back(i * 2);
+    }
+    const IntTree::node_type* at4000 = &*whole.lower_bound(4000);
+    const IntTree::node_type* at10 = &*whole.lower_bound(10);
+    for (int round = 0; round < 50; round++) {
+      IntTree high(whole.node_pool());
+      whole.split_at(4000, high);
+      expect(whole.validate() && high.validate() && &*high.begin() == at4000 && &*whole.lower_bound(10) == at10,
+             "shared-pool split_at moves no node");
+      expect(pool->live_nodes() == 3000 && high.mem_stats().live_nodes == 3000, "shared pool counts every tree");
+      whole.join(3999, high);   // one new node for the seam key, then dropped again
+      whole.remove(3999);
+      expect(whole.validate() && high.get_root() == NULL && keys_of(whole) == all, "shared-pool join");
+      expect(&*whole.lower_bound(4000) == at4000, "shared-pool join moves no node");
+    }
+    expect(pool->reserved_nodes() < 2 * 3000, "no slabs pile up across shared-pool rounds");
+
+    // a tree on the pool dies or clears: only its own nodes go back
+    {
+      IntTree part(pool);
+      whole.split_at(5000, part);
+      IntTree more(pool);
+      more.insert_data(-1);
+      more.clear();
+      expect(pool->live_nodes() == 3000, "clear on a shared pool frees only its nodes");
+    }
+    expect(pool->live_nodes() == 2500 && whole.validate() && whole.size(whole.get_root()) == 2500,
+           "a shared-pool tree frees its own nodes");
+
+    // a tree on another pool never takes over the shared slabs
+    IntTree own;
+    for (int i = 0; i < 10; i++) own.insert_data(-10 - i);
+    own.unite(whole);
+    expect(own.validate() && own.size(own.get_root()) == 2510 && whole.get_root() == NULL, "unite across pools");
+    whole.insert_data(1);
+    expect(whole.validate() && pool->live_nodes() == 1, "shared pool still usable after a copy out");
+    own.swap(whole);
+    expect(own.size(own.get_root()) == 1 && own.node_pool() == pool && whole.size(whole.get_root()) == 2510,
+           "swap exchanges contents and pools");
+
+    // keys that own memory are destroyed node by node on a shared pool
+    shared_ptr<RBT<string, int>::pool_type> names = make_shared<RBT<string, int>::pool_type>();
+    RBT<string, int> left(names);
+    {
+      RBT<string, int> right(names);
+      for (int i = 0; i < 100; i++) left.insert_data("name_with_a_long_tail_" + to_string(i), i);
+      left.split_at(string("name_with_a_long_tail_5"), right);
+      expect(left.validate() && right.validate() && names->live_nodes() == 100, "string split on one pool");
+    }
+    expect(names->live_nodes() == (size_t)left.size(left.get_root()), "string nodes freed with their tree");
+  }
+
+  // keys that own memory: split, unite and difference move them around
+  RBT<string, int, greater<string> > names;
+  RBT<string, int, greater<string> > more;
+  for (int i = 0; i < 200; i++) names.insert_data("player_" + to_string(i), i);
+  names.split_at(string("player_5"), more);   // descending: "player_5" and below move
+  expect(names.validate() && more.validate() && names.size(names.get_root()) + more.size(more.get_root()) == 200,
+         "string split_at");
+  expect(more.first()->data == "player_5" && names.last()->data == "player_50", "string split point");
+  names.unite(more);
+  names.difference(names);
+  expect(names.get_root() == NULL && names.validate(), "difference with itself empties the tree");
+
+  cout << "[PASS] rbt tests\n";
+  return 0;
+}